@@ -134,6 +134,15 @@ void block_print_stats(void) {
   }
 }
 
+/* Stores the number of sectors read from and written to BLOCK
+   in *READ_CNT and *WRITE_CNT.  BLOCK may be a null pointer, in
+   which case both counts are 0. */
+void block_get_stats(struct block* block, unsigned long long* read_cnt,
+                     unsigned long long* write_cnt) {
+  *read_cnt = block != NULL ? block->read_cnt : 0;
+  *write_cnt = block != NULL ? block->write_cnt : 0;
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
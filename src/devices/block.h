@@ -57,6 +57,8 @@ enum block_type block_type(struct block*);
 
 /* Statistics. */
 void block_print_stats(void);
+void block_get_stats(struct block*, unsigned long long* read_cnt,
+                     unsigned long long* write_cnt);
 
 /* Lower-level interface to block device drivers. */
 
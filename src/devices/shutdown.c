@@ -5,13 +5,26 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/large.h"
+#include "vm/merge.h"
+#include "vm/page.h"
+#include "vm/prefetch.h"
+#include "vm/share.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "filesys/readahead.h"
 #endif
 
 /* Keyboard control register port. */
@@ -116,12 +129,25 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
   timer_print_stats();
   thread_print_stats();
+  palloc_print_stats();
 #ifdef FILESYS
   block_print_stats();
+  cache_print_stats();
+  readahead_print_stats();
 #endif
   console_print_stats();
   kbd_print_stats();
 #ifdef USERPROG
   exception_print_stats();
 #endif
+#ifdef VM
+  page_print_stats();
+  frame_print_stats();
+  swap_print_stats();
+  share_print_stats();
+  shm_print_stats();
+  prefetch_print_stats();
+  merge_print_stats();
+  large_print_stats();
+#endif
 }
@@ -0,0 +1,287 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <ohash.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Buffer cache.
+
+   Every sector of the file system device that inode.c reads or
+   writes goes through a fixed set of slots, each holding one
+   sector.  A hash table maps sector numbers to the slots that
+   hold them, and a slot that must be reused is chosen with the
+   CLOCK algorithm.  Writes only mark a slot dirty; the sector is
+   written back when its slot is reused and by cache_flush().
+   The read-ahead thread brings sectors in early with
+   cache_prefetch(); such a slot counts as a prefetch hit when a
+   read or write first uses it, and as a wasted prefetch if it is
+   reused before that.
+
+   cache_lock protects the hash table, the clock hand, and each
+   slot's SECTOR and USER_CNT.  Each slot's LOCK protects its
+   data, and is held for the duration of a single read or write
+   of that sector, including any disk I/O, so accesses to
+   different sectors proceed in parallel.
+
+   A slot with a nonzero USER_CNT is never reused.  A thread
+   raises USER_CNT under cache_lock before it waits for the slot
+   lock, and lowers it only after releasing the slot lock, so
+   a slot whose USER_CNT is 0 is unlocked and cache_lock holders
+   may take its lock without blocking. */
+
+/* A cached sector. */
+struct slot {
+  struct ohash_elem elem; /* Element in the sector table. */
+  block_sector_t sector;  /* Sector held, if IN_USE. */
+  bool in_use;            /* Holds a sector? */
+  bool valid;             /* Data has been read or written? */
+  bool dirty;             /* Data differs from the disk? */
+  bool accessed;          /* Used since the clock hand passed? */
+  bool prefetched;        /* Read ahead and not used since? */
+  unsigned user_cnt;      /* Threads using or waiting for the slot. */
+  struct lock lock;       /* Protects the fields below. */
+  uint8_t* data;          /* BLOCK_SECTOR_SIZE bytes. */
+};
+
+static struct block* cache_device; /* Device whose sectors are cached. */
+static struct slot* slots;         /* Array of SLOT_CNT slots. */
+static size_t slot_cnt;            /* Number of slots. */
+static size_t hand;                /* Clock hand, an index into SLOTS. */
+static struct ohash sector_table;  /* Slots in use, keyed by sector. */
+static struct lock cache_lock;     /* See comment at top of file. */
+
+/* Statistics. */
+static long long hit_cnt;       /* Accesses that found their sector. */
+static long long miss_cnt;      /* Accesses that had to take a slot. */
+static long long writeback_cnt; /* Dirty sectors written to disk. */
+static long long prefetch_cnt;  /* Sectors read ahead. */
+static long long used_cnt;      /* Sectors read ahead and then used. */
+static long long wasted_cnt;    /* Sectors read ahead and reused unused. */
+
+/* Returns a hash value for slot E. */
+static unsigned slot_hash(const struct ohash_elem* e, void* aux UNUSED) {
+  return ohash_int(ohash_entry(e, struct slot, elem)->sector);
+}
+
+/* Returns true if slots A and B hold the same sector. */
+static bool slot_equal(const struct ohash_elem* a, const struct ohash_elem* b, void* aux UNUSED) {
+  return ohash_entry(a, struct slot, elem)->sector == ohash_entry(b, struct slot, elem)->sector;
+}
+
+/* Initializes the buffer cache to hold SLOT_CNT sectors of
+   DEVICE. */
+void cache_init(struct block* device, size_t slot_cnt_) {
+  uint8_t* data;
+  size_t i;
+
+  ASSERT(slot_cnt_ > 0);
+
+  slot_cnt = slot_cnt_;
+  slots = calloc(slot_cnt, sizeof *slots);
+  data = malloc(slot_cnt * BLOCK_SECTOR_SIZE);
+  if (slots == NULL || data == NULL)
+    PANIC("not enough memory for a %zu-sector buffer cache", slot_cnt);
+
+  ohash_init(&sector_table, slot_hash, slot_equal, NULL);
+  if (!ohash_reserve(&sector_table, slot_cnt))
+    PANIC("not enough memory for a %zu-sector buffer cache", slot_cnt);
+  for (i = 0; i < slot_cnt; i++) {
+    lock_init(&slots[i].lock);
+    slots[i].data = data + i * BLOCK_SECTOR_SIZE;
+  }
+  lock_init(&cache_lock);
+  cache_device = device;
+}
+
+/* Writes slot S back to disk if it is dirty.
+   S's lock must be held. */
+static void write_back(struct slot* s) {
+  ASSERT(lock_held_by_current_thread(&s->lock));
+
+  if (s->dirty) {
+    block_write(cache_device, s->sector, s->data);
+    s->dirty = false;
+    writeback_cnt++;
+  }
+}
+
+/* Stops using slot S, whose lock the caller holds. */
+static void put_slot(struct slot* s) {
+  lock_release(&s->lock);
+  lock_acquire(&cache_lock);
+  s->user_cnt--;
+  lock_release(&cache_lock);
+}
+
+/* Advances the clock hand to a clean slot that may be reused
+   and returns it with its lock held.  A dirty victim is written
+   back first, with cache_lock released, so that its sector stays
+   visible to other threads until it is clean on disk; if every
+   slot is in use, yields with cache_lock released.  Either way,
+   returns a null pointer once cache_lock has been reacquired,
+   because the sector table may have changed meanwhile.
+   cache_lock must be held. */
+static struct slot* pick_victim(void) {
+  size_t i;
+
+  ASSERT(lock_held_by_current_thread(&cache_lock));
+
+  /* Two sweeps clear every accessed bit on the way. */
+  for (i = 0; i < 2 * slot_cnt; i++) {
+    struct slot* s = &slots[hand];
+    hand = (hand + 1) % slot_cnt;
+
+    if (s->user_cnt > 0)
+      continue;
+    if (s->accessed) {
+      s->accessed = false;
+      continue;
+    }
+
+    lock_acquire(&s->lock);
+    if (!s->dirty)
+      return s;
+
+    s->user_cnt++;
+    lock_release(&cache_lock);
+    write_back(s);
+    put_slot(s);
+    lock_acquire(&cache_lock);
+    return NULL;
+  }
+
+  lock_release(&cache_lock);
+  thread_yield();
+  lock_acquire(&cache_lock);
+  return NULL;
+}
+
+/* Returns the slot that holds SECTOR, with its lock held,
+   taking a slot for it if it is not cached.  If LOAD is true,
+   the slot's data is read from disk if it is not valid yet;
+   otherwise the caller will overwrite all of it.
+
+   If PREFETCH is true, the caller is reading ahead: a cached
+   SECTOR is left alone and a null pointer returned, and the
+   access is not counted as a hit or a miss. */
+static struct slot* get_slot(block_sector_t sector, bool load, bool prefetch) {
+  struct ohash_elem* e;
+  struct slot key;
+  struct slot* s;
+
+  lock_acquire(&cache_lock);
+  key.sector = sector;
+  for (;;) {
+    e = ohash_find(&sector_table, &key.elem);
+    if (e != NULL) {
+      if (prefetch) {
+        lock_release(&cache_lock);
+        return NULL;
+      }
+      s = ohash_entry(e, struct slot, elem);
+      s->user_cnt++;
+      hit_cnt++;
+      lock_release(&cache_lock);
+      lock_acquire(&s->lock);
+      if (s->prefetched) {
+        s->prefetched = false;
+        used_cnt++;
+      }
+      break;
+    }
+
+    s = pick_victim();
+    if (s != NULL) {
+      if (s->in_use)
+        ohash_delete(&sector_table, &s->elem);
+      if (s->prefetched)
+        wasted_cnt++;
+      s->sector = sector;
+      s->in_use = true;
+      s->valid = false;
+      s->prefetched = prefetch;
+      s->user_cnt++;
+      ohash_insert(&sector_table, &s->elem);
+      if (prefetch)
+        prefetch_cnt++;
+      else
+        miss_cnt++;
+      lock_release(&cache_lock);
+      break;
+    }
+  }
+
+  if (load && !s->valid) {
+    block_read(cache_device, sector, s->data);
+    s->valid = true;
+  }
+  s->accessed = true;
+  return s;
+}
+
+/* Reads SIZE bytes starting at offset OFS within SECTOR into
+   BUFFER, which must be kernel memory that cannot fault: the
+   copy is made with the slot lock held. */
+void cache_read(block_sector_t sector, void* buffer, size_t ofs, size_t size) {
+  struct slot* s;
+
+  ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+  s = get_slot(sector, true, false);
+  memcpy(buffer, s->data + ofs, size);
+  put_slot(s);
+}
+
+/* Writes SIZE bytes from BUFFER to offset OFS within SECTOR.
+   BUFFER must be kernel memory; see cache_read().
+   The sector reaches the disk when its slot is reused or the
+   cache is flushed. */
+void cache_write(block_sector_t sector, const void* buffer, size_t ofs, size_t size) {
+  struct slot* s;
+
+  ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+  s = get_slot(sector, size < BLOCK_SECTOR_SIZE, false);
+  memcpy(s->data + ofs, buffer, size);
+  s->valid = true;
+  s->dirty = true;
+  put_slot(s);
+}
+
+/* Reads SECTOR into the cache in advance of an expected
+   cache_read(), unless it is cached already. */
+void cache_prefetch(block_sector_t sector) {
+  struct slot* s = get_slot(sector, true, true);
+
+  if (s != NULL)
+    put_slot(s);
+}
+
+/* Writes every dirty sector back to disk. */
+void cache_flush(void) {
+  size_t i;
+
+  for (i = 0; i < slot_cnt; i++) {
+    struct slot* s = &slots[i];
+
+    lock_acquire(&cache_lock);
+    s->user_cnt++;
+    lock_release(&cache_lock);
+
+    lock_acquire(&s->lock);
+    if (s->in_use)
+      write_back(s);
+    put_slot(s);
+  }
+}
+
+/* Prints buffer cache statistics. */
+void cache_print_stats(void) {
+  printf("Cache: %zu sectors, %lld hits, %lld misses, %lld writebacks\n", slot_cnt, hit_cnt,
+         miss_cnt, writeback_cnt);
+  printf("Cache: %lld sectors read ahead, %lld prefetch hits, %lld wasted prefetches\n",
+         prefetch_cnt, used_cnt, wasted_cnt);
+}
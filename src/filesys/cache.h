@@ -0,0 +1,17 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Default number of sectors held in the buffer cache. */
+#define CACHE_DEFAULT_SLOTS 64
+
+void cache_init(struct block*, size_t slot_cnt);
+void cache_read(block_sector_t, void* buffer, size_t ofs, size_t size);
+void cache_write(block_sector_t, const void* buffer, size_t ofs, size_t size);
+void cache_prefetch(block_sector_t);
+void cache_flush(void);
+void cache_print_stats(void);
+
+#endif /* filesys/cache.h */
@@ -1,6 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/readahead.h"
 #include "threads/malloc.h"
 
 /* An open file. */
@@ -8,8 +9,18 @@ struct file {
   struct inode* inode; /* File's inode. */
   off_t pos;           /* Current position. */
   bool deny_write;     /* Has file_deny_write() been called? */
+
+  /* Read-ahead state.  file_read() calls that each start where the
+     previous one ended form a streak; once the streak is long
+     enough, the sectors past the reader are read ahead. */
+  off_t next_pos;   /* Where a sequential file_read() would start. */
+  unsigned streak;  /* Sequential file_read() calls in a row. */
+  size_t window;    /* Read-ahead window in sectors, 0 if none. */
+  off_t ahead_end;  /* End of the range already read ahead. */
 };
 
+static void read_ahead(struct file*, bool sequential);
+
 /*
  * Opens a file for the given INODE, of which it takes ownership,
  *  and returns the new file.  Returns a null pointer if an
@@ -40,6 +51,8 @@ struct file* file_reopen(struct file* file) {
 /* Closes FILE. */
 void file_close(struct file* file) {
   if (file != NULL) {
+    if (file->window > 0)
+      readahead_cancel(file);
     file_allow_write(file);
     inode_close(file->inode);
     free(file);
@@ -55,13 +68,51 @@ struct inode* file_get_inode(struct file* file) {
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   Sequential reads start reading ahead of the position. */
 off_t file_read(struct file* file, void* buffer, off_t size) {
+  bool sequential = file->pos == file->next_pos;
   off_t bytes_read = inode_read_at(file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
+  read_ahead(file, sequential);
   return bytes_read;
 }
 
+/* Updates FILE's streak after a file_read() that ended at FILE's
+   position and was SEQUENTIAL or not, and queues read-ahead as
+   needed.  The window starts at READAHEAD_MIN_WINDOW sectors and
+   doubles each time the reader reaches the second half of what
+   was read ahead; a read elsewhere cancels read-ahead and starts
+   over. */
+static void read_ahead(struct file* file, bool sequential) {
+  off_t start;
+
+  file->next_pos = file->pos;
+  if (!sequential) {
+    if (file->window > 0)
+      readahead_cancel(file);
+    file->streak = 0;
+    file->window = 0;
+    file->ahead_end = 0;
+    return;
+  }
+
+  if (++file->streak < READAHEAD_STREAK)
+    return;
+  if (file->window == 0)
+    file->window = READAHEAD_MIN_WINDOW;
+  else if (file->pos + (off_t)file->window * BLOCK_SECTOR_SIZE / 2 < file->ahead_end)
+    return;
+  else if (file->window * 2 <= readahead_max_window())
+    file->window *= 2;
+
+  start = file->pos > file->ahead_end ? file->pos : file->ahead_end;
+  if (start >= inode_length(file->inode))
+    return;
+  file->ahead_end = start + file->window * BLOCK_SECTOR_SIZE;
+  inode_read_ahead(file->inode, file, start, file->window);
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
@@ -2,9 +2,11 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/readahead.h"
 #include "filesys/directory.h"
 #include "userprog/filesys_lock.h"
 /*
@@ -80,13 +82,16 @@ struct block* fs_device;
 
 static void do_format(void);
 
-/* Initializes the file system module.
+/* Initializes the file system module, with a buffer cache of
+   CACHE_SLOTS sectors.
    If FORMAT is true, reformats the file system. */
-void filesys_init(bool format) {
+void filesys_init(bool format, size_t cache_slots) {
   fs_device = block_get_role(BLOCK_FILESYS);
   if (fs_device == NULL)
     PANIC("No file system device found, can't initialize file system.");
 
+  cache_init(fs_device, cache_slots);
+  readahead_init(cache_slots / 2);
   inode_init();
   free_map_init();
 
@@ -98,7 +103,10 @@ void filesys_init(bool format) {
 
 /* Shuts down the file system module, writing any unwritten data
    to disk. */
-void filesys_done(void) { free_map_close(); }
+void filesys_done(void) {
+  free_map_close();
+  cache_flush();
+}
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
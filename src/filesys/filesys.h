@@ -2,6 +2,7 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 
 /* Sectors of system file inodes. */
@@ -11,7 +12,7 @@
 /* Block device that contains the file system. */
 extern struct block* fs_device;
 
-void filesys_init(bool format);
+void filesys_init(bool format, size_t cache_slots);
 void filesys_done(void);
 bool filesys_create(const char* name, off_t initial_size);
 struct file* filesys_open(const char* name);
@@ -1,10 +1,12 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <ohash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/readahead.h"
 #include "threads/malloc.h"
 
 /* Identifies an inode. */
@@ -25,7 +27,7 @@ static inline size_t bytes_to_sectors(off_t size) { return DIV_ROUND_UP(size, BL
 
 /* In-memory inode. */
 struct inode {
-  struct list_elem elem;  /* Element in inode list. */
+  struct ohash_elem elem; /* Element in open inode table. */
   block_sector_t sector;  /* Sector number of disk location. */
   int open_cnt;           /* Number of openers. */
   bool removed;           /* True if deleted, false otherwise. */
@@ -45,12 +47,22 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
     return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Table of open inodes keyed by sector, so that opening a single
+   inode twice returns the same `struct inode'. */
+static struct ohash open_inodes;
+
+/* Returns a hash value for inode E. */
+static unsigned inode_hash(const struct ohash_elem* e, void* aux UNUSED) {
+  return ohash_int(ohash_entry(e, struct inode, elem)->sector);
+}
+
+/* Returns true if inodes A and B live in the same sector. */
+static bool inode_equal(const struct ohash_elem* a, const struct ohash_elem* b, void* aux UNUSED) {
+  return ohash_entry(a, struct inode, elem)->sector == ohash_entry(b, struct inode, elem)->sector;
+}
 
 /* Initializes the inode module. */
-void inode_init(void) { list_init(&open_inodes); }
+void inode_init(void) { ohash_init(&open_inodes, inode_hash, inode_equal, NULL); }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
@@ -73,13 +85,13 @@ bool inode_create(block_sector_t sector, off_t length) {
     disk_inode->length = length;
     disk_inode->magic = INODE_MAGIC;
     if (free_map_allocate(sectors, &disk_inode->start)) {
-      block_write(fs_device, sector, disk_inode);
+      cache_write(sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
       if (sectors > 0) {
         static char zeros[BLOCK_SECTOR_SIZE];
         size_t i;
 
         for (i = 0; i < sectors; i++)
-          block_write(fs_device, disk_inode->start + i, zeros);
+          cache_write(disk_inode->start + i, zeros, 0, BLOCK_SECTOR_SIZE);
       }
       success = true;
     }
@@ -92,16 +104,17 @@ bool inode_create(block_sector_t sector, off_t length) {
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
 struct inode* inode_open(block_sector_t sector) {
-  struct list_elem* e;
+  struct ohash_elem* e;
   struct inode* inode;
+  struct inode key;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
-    inode = list_entry(e, struct inode, elem);
-    if (inode->sector == sector) {
-      inode_reopen(inode);
-      return inode;
-    }
+  key.sector = sector;
+  e = ohash_find(&open_inodes, &key.elem);
+  if (e != NULL) {
+    inode = ohash_entry(e, struct inode, elem);
+    inode_reopen(inode);
+    return inode;
   }
 
   /* Allocate memory. */
@@ -110,12 +123,15 @@ struct inode* inode_open(block_sector_t sector) {
     return NULL;
 
   /* Initialize. */
-  list_push_front(&open_inodes, &inode->elem);
   inode->sector = sector;
+  if (ohash_insert(&open_inodes, &inode->elem) != NULL) {
+    free(inode);
+    return NULL;
+  }
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read(fs_device, inode->sector, &inode->data);
+  cache_read(inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
   return inode;
 }
 
@@ -139,8 +155,8 @@ void inode_close(struct inode* inode) {
 
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0) {
-    /* Remove from inode list and release lock. */
-    list_remove(&inode->elem);
+    /* Remove from inode table and release lock. */
+    ohash_delete(&open_inodes, &inode->elem);
 
     /* Deallocate blocks if removed. */
     if (inode->removed) {
@@ -165,7 +181,13 @@ void inode_remove(struct inode* inode) {
 off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset) {
   uint8_t* buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t* bounce = NULL;
+  uint8_t* bounce;
+
+  /* BUFFER may be user memory, which can fault; the buffer cache
+     must not touch it while it holds a slot lock. */
+  bounce = malloc(BLOCK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return 0;
 
   while (size > 0) {
     /* Disk sector to read, starting byte offset within sector. */
@@ -182,20 +204,9 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-      /* Read full sector directly into caller's buffer. */
-      block_read(fs_device, sector_idx, buffer + bytes_read);
-    } else {
-      /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-      if (bounce == NULL) {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-        if (bounce == NULL)
-          break;
-      }
-      block_read(fs_device, sector_idx, bounce);
-      memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
-    }
+    /* Copy the chunk out of the buffer cache. */
+    cache_read(sector_idx, bounce, sector_ofs, chunk_size);
+    memcpy(buffer + bytes_read, bounce, chunk_size);
 
     /* Advance. */
     size -= chunk_size;
@@ -207,6 +218,22 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
   return bytes_read;
 }
 
+/* Queues up to SECTOR_CNT sectors of INODE, starting with the
+   one that holds byte OFFSET, to be read into the buffer cache
+   in the background on behalf of OWNER.  Sectors past the end of
+   INODE are skipped. */
+void inode_read_ahead(struct inode* inode, const void* owner, off_t offset, size_t sector_cnt) {
+  block_sector_t sectors[READAHEAD_MAX_WINDOW];
+  size_t cnt = 0;
+
+  offset = ROUND_DOWN(offset, BLOCK_SECTOR_SIZE);
+  while (cnt < sector_cnt && cnt < READAHEAD_MAX_WINDOW && offset < inode_length(inode)) {
+    sectors[cnt++] = byte_to_sector(inode, offset);
+    offset += BLOCK_SECTOR_SIZE;
+  }
+  readahead_submit(owner, sectors, cnt);
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
@@ -215,11 +242,16 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
 off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset) {
   const uint8_t* buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t* bounce = NULL;
+  uint8_t* bounce;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  /* BUFFER may be user memory; see inode_read_at(). */
+  bounce = malloc(BLOCK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return 0;
+
   while (size > 0) {
     /* Sector to write, starting byte offset within sector. */
     block_sector_t sector_idx = byte_to_sector(inode, offset);
@@ -235,27 +267,10 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-      /* Write full sector directly to disk. */
-      block_write(fs_device, sector_idx, buffer + bytes_written);
-    } else {
-      /* We need a bounce buffer. */
-      if (bounce == NULL) {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-        if (bounce == NULL)
-          break;
-      }
-
-      /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-      if (sector_ofs > 0 || chunk_size < sector_left)
-        block_read(fs_device, sector_idx, bounce);
-      else
-        memset(bounce, 0, BLOCK_SECTOR_SIZE);
-      memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-      block_write(fs_device, sector_idx, bounce);
-    }
+    /* Copy the chunk into the buffer cache.  A partial sector is
+       read in first unless it is already cached. */
+    memcpy(bounce, buffer + bytes_written, chunk_size);
+    cache_write(sector_idx, bounce, sector_ofs, chunk_size);
 
     /* Advance. */
     size -= chunk_size;
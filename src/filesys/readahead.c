@@ -0,0 +1,164 @@
+#include "filesys/readahead.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Asynchronous read-ahead.
+
+   file_read() notices when an open file is being read
+   sequentially and queues the sectors just past the reader with
+   readahead_submit().  A kernel thread works through the queue,
+   pulling each sector into the buffer cache, so that the reader
+   finds it there instead of waiting on the disk.
+
+   A request names the sectors themselves rather than the file,
+   so the thread never touches inodes.  Each request is tagged
+   with an OWNER, the open file that asked for it, so that
+   readahead_cancel() can drop the file's requests when it seeks
+   or is closed. */
+
+/* Requests queued at once; further requests are dropped. */
+#define READAHEAD_MAX_REQUESTS 16
+
+/* A read-ahead request. */
+struct request {
+  const void* owner;        /* Open file that asked for it. */
+  size_t cnt;               /* Number of sectors. */
+  struct list_elem elem;    /* Element in the request queue. */
+  block_sector_t sectors[]; /* Sectors to read, in order. */
+};
+
+static struct lock readahead_lock; /* Protects the variables below. */
+static struct condition queued;    /* A request was queued. */
+static struct condition finished;  /* The current request ended. */
+static struct list requests;       /* Request queue. */
+static size_t request_cnt;         /* Number of queued requests. */
+static const void* current;        /* Owner of the request being read. */
+static bool cancelled;             /* Stop reading the current request? */
+static size_t max_window;          /* Largest window, in sectors. */
+
+/* Statistics. */
+static long long window_cnt;  /* Requests queued. */
+static long long sector_cnt;  /* Sectors queued. */
+static long long dropped_cnt; /* Requests dropped with a full queue. */
+static long long cancel_cnt;  /* Requests cancelled. */
+
+static thread_func readahead_thread NO_RETURN;
+
+/* Initializes the request queue and starts the read-ahead
+   thread.  Windows are limited to MAX_WINDOW_ sectors, or
+   READAHEAD_MAX_WINDOW if that is smaller. */
+void readahead_init(size_t max_window_) {
+  lock_init(&readahead_lock);
+  cond_init(&queued);
+  cond_init(&finished);
+  list_init(&requests);
+  max_window = max_window_ < READAHEAD_MAX_WINDOW ? max_window_ : READAHEAD_MAX_WINDOW;
+  if (max_window < READAHEAD_MIN_WINDOW)
+    max_window = READAHEAD_MIN_WINDOW;
+  thread_create("readahead", PRI_DEFAULT, readahead_thread, NULL);
+}
+
+/* Returns the largest read-ahead window, in sectors. */
+size_t readahead_max_window(void) { return max_window; }
+
+/* Queues the CNT SECTORS to be read into the buffer cache on
+   behalf of OWNER.  Drops the request if the queue is full or
+   memory is short: read-ahead is only a hint. */
+void readahead_submit(const void* owner, const block_sector_t sectors[], size_t cnt) {
+  struct request* r;
+
+  if (cnt == 0)
+    return;
+  r = malloc(sizeof *r + cnt * sizeof *sectors);
+  if (r == NULL)
+    return;
+  r->owner = owner;
+  r->cnt = cnt;
+  memcpy(r->sectors, sectors, cnt * sizeof *sectors);
+
+  lock_acquire(&readahead_lock);
+  if (request_cnt < READAHEAD_MAX_REQUESTS) {
+    list_push_back(&requests, &r->elem);
+    request_cnt++;
+    window_cnt++;
+    sector_cnt += cnt;
+    cond_signal(&queued, &readahead_lock);
+    r = NULL;
+  } else
+    dropped_cnt++;
+  lock_release(&readahead_lock);
+  free(r);
+}
+
+/* Drops OWNER's queued requests, stops the one being read if it
+   is OWNER's, and waits for that to happen.  On return, the
+   read-ahead thread no longer works for OWNER. */
+void readahead_cancel(const void* owner) {
+  struct list_elem* e;
+
+  lock_acquire(&readahead_lock);
+  for (e = list_begin(&requests); e != list_end(&requests);) {
+    struct request* r = list_entry(e, struct request, elem);
+
+    if (r->owner == owner) {
+      e = list_remove(e);
+      request_cnt--;
+      cancel_cnt++;
+      free(r);
+    } else
+      e = list_next(e);
+  }
+  if (current == owner) {
+    cancelled = true;
+    cancel_cnt++;
+    while (current == owner)
+      cond_wait(&finished, &readahead_lock);
+  }
+  lock_release(&readahead_lock);
+}
+
+/* Prints read-ahead statistics. */
+void readahead_print_stats(void) {
+  printf("Read-ahead: %lld windows of %lld sectors queued, %lld dropped, %lld cancelled\n",
+         window_cnt, sector_cnt, dropped_cnt, cancel_cnt);
+}
+
+/* Read-ahead thread: reads the queued requests in order. */
+static void readahead_thread(void* aux UNUSED) {
+  for (;;) {
+    struct request* r;
+    size_t i;
+
+    lock_acquire(&readahead_lock);
+    while (list_empty(&requests))
+      cond_wait(&queued, &readahead_lock);
+    r = list_entry(list_pop_front(&requests), struct request, elem);
+    request_cnt--;
+    current = r->owner;
+    cancelled = false;
+    lock_release(&readahead_lock);
+
+    for (i = 0; i < r->cnt; i++) {
+      bool stop;
+
+      lock_acquire(&readahead_lock);
+      stop = cancelled;
+      lock_release(&readahead_lock);
+      if (stop)
+        break;
+      cache_prefetch(r->sectors[i]);
+    }
+
+    lock_acquire(&readahead_lock);
+    current = NULL;
+    cond_broadcast(&finished, &readahead_lock);
+    lock_release(&readahead_lock);
+    free(r);
+  }
+}
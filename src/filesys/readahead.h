@@ -0,0 +1,20 @@
+#ifndef FILESYS_READAHEAD_H
+#define FILESYS_READAHEAD_H
+
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Range of the read-ahead window, in sectors. */
+#define READAHEAD_MIN_WINDOW 8
+#define READAHEAD_MAX_WINDOW 64
+
+/* Sequential reads in a row before read-ahead starts. */
+#define READAHEAD_STREAK 2
+
+void readahead_init(size_t max_window);
+size_t readahead_max_window(void);
+void readahead_submit(const void* owner, const block_sector_t sectors[], size_t cnt);
+void readahead_cancel(const void* owner);
+void readahead_print_stats(void);
+
+#endif /* filesys/readahead.h */
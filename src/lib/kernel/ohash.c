@@ -0,0 +1,444 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Control byte values.  A full slot stores the low 7 bits of its
+   element's hash, so its top bit is clear; the two special
+   values both have the top bit set.  Bit 1 tells them apart,
+   which the word-at-a-time match in match_empty() relies on. */
+#define CTRL_EMPTY 0x80   /* Never used since the table was built. */
+#define CTRL_DELETED 0xfe /* Used once, now free (a tombstone). */
+
+/* Bytes of a control word with their top and bottom bits set. */
+#define LSBS 0x01010101u
+#define MSBS 0x80808080u
+
+/* Smallest table worth allocating. */
+#define MIN_SLOTS 16
+
+/* Slots of the old table migrated by each insertion or
+   deletion.  The new table has at least twice the old one's
+   capacity, so this drains the old table well before the new one
+   fills up. */
+#define MIGRATE_STEP 4
+
+static void table_init(struct ohash_table*);
+static bool table_alloc(struct ohash_table*, size_t slot_cnt);
+static void table_free(struct ohash_table*);
+static struct ohash_elem** table_find(struct ohash*, struct ohash_table*, struct ohash_elem*);
+static void table_put(struct ohash_table*, struct ohash_elem*);
+static void migrate(struct ohash*, size_t slot_cnt);
+static bool grow(struct ohash*);
+
+/* Splits hash value HASH into the group where probing starts
+   and the 7-bit tag stored in the control byte. */
+static inline size_t hash_group(unsigned hash) { return hash >> 7; }
+static inline uint8_t hash_tag(unsigned hash) { return hash & 0x7f; }
+
+/* Returns the control bytes of group G in T as one word. */
+static inline uint32_t load_group(const struct ohash_table* t, size_t g) {
+  uint32_t word;
+  memcpy(&word, t->ctrl + g * OHASH_GROUP, sizeof word);
+  return word;
+}
+
+/* Returns a mask with the top bit set in each byte of WORD that
+   may equal TAG.  False positives are possible (when a borrow
+   runs into the next byte) and are weeded out by the caller
+   comparing full hash values; false negatives are not. */
+static inline uint32_t match_tag(uint32_t word, uint8_t tag) {
+  uint32_t x = word ^ (LSBS * tag);
+  return (x - LSBS) & ~x & MSBS;
+}
+
+/* Returns a mask with the top bit set in each empty byte of
+   WORD.  Empty bytes have bit 7 set and bit 1 clear. */
+static inline uint32_t match_empty(uint32_t word) { return word & ~(word << 6) & MSBS; }
+
+/* Returns a mask with the top bit set in each byte of WORD that
+   is empty or deleted. */
+static inline uint32_t match_free(uint32_t word) { return word & MSBS; }
+
+/* Returns the index within its group of the lowest byte set in
+   nonzero MASK, and clears it from *MASK. */
+static inline size_t next_match(uint32_t* mask) {
+  size_t idx = __builtin_ctz(*mask) / 8;
+  *mask &= *mask - 1;
+  return idx;
+}
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using EQUAL, given auxiliary data AUX.
+   No memory is allocated until the first insertion. */
+void ohash_init(struct ohash* h, ohash_hash_func* hash, ohash_equal_func* equal, void* aux) {
+  table_init(&h->cur);
+  table_init(&h->old);
+  h->migrate_idx = 0;
+  h->hash = hash;
+  h->equal = equal;
+  h->aux = aux;
+}
+
+/* Removes all the elements from H, keeping its current size.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while ohash_clear() is running yields undefined
+   behavior, whether done in DESTRUCTOR or elsewhere. */
+void ohash_clear(struct ohash* h, ohash_action_func* destructor) {
+  struct ohash_table* tables[] = {&h->old, &h->cur};
+  size_t i, j;
+
+  for (i = 0; i < 2; i++) {
+    struct ohash_table* t = tables[i];
+    if (destructor != NULL)
+      for (j = 0; j < t->slot_cnt; j++)
+        if ((t->ctrl[j] & 0x80) == 0)
+          destructor(t->slots[j], h->aux);
+  }
+
+  table_free(&h->old);
+  h->migrate_idx = 0;
+  if (h->cur.slot_cnt != 0) {
+    memset(h->cur.ctrl, CTRL_EMPTY, h->cur.slot_cnt);
+    h->cur.used_cnt = 0;
+    h->cur.free_cnt = h->cur.slot_cnt / 8 * 7;
+  }
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, as in ohash_clear(). */
+void ohash_destroy(struct ohash* h, ohash_action_func* destructor) {
+  if (destructor != NULL)
+    ohash_clear(h, destructor);
+  table_free(&h->old);
+  table_free(&h->cur);
+}
+
+/* Makes room in H for ELEM_CNT elements without further growth.
+   Only has an effect on a table that is still empty.  Returns
+   false if memory could not be allocated. */
+bool ohash_reserve(struct ohash* h, size_t elem_cnt) {
+  size_t slot_cnt = MIN_SLOTS;
+
+  if (!ohash_empty(h))
+    return true;
+  while (slot_cnt / 8 * 7 < elem_cnt)
+    slot_cnt *= 2;
+  if (slot_cnt <= h->cur.slot_cnt)
+    return true;
+
+  table_free(&h->old);
+  table_free(&h->cur);
+  return table_alloc(&h->cur, slot_cnt);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW.
+   If the table had to grow and no memory was available, returns
+   NEW itself without inserting it. */
+struct ohash_elem* ohash_insert(struct ohash* h, struct ohash_elem* new) {
+  struct ohash_elem* old;
+
+  new->hash = h->hash(new, h->aux);
+  old = ohash_find(h, new);
+  if (old != NULL)
+    return old;
+
+  if (h->cur.free_cnt == 0 && !grow(h))
+    return new;
+  table_put(&h->cur, new);
+  migrate(h, MIGRATE_STEP);
+  return NULL;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct ohash_elem* ohash_find(struct ohash* h, struct ohash_elem* e) {
+  struct ohash_elem** slot;
+
+  e->hash = h->hash(e, h->aux);
+  slot = table_find(h, &h->cur, e);
+  if (slot == NULL)
+    slot = table_find(h, &h->old, e);
+  return slot != NULL ? *slot : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct ohash_elem* ohash_delete(struct ohash* h, struct ohash_elem* e) {
+  struct ohash_table* t = &h->cur;
+  struct ohash_elem** slot;
+  struct ohash_elem* found;
+
+  e->hash = h->hash(e, h->aux);
+  slot = table_find(h, t, e);
+  if (slot == NULL) {
+    t = &h->old;
+    slot = table_find(h, t, e);
+    if (slot == NULL)
+      return NULL;
+  }
+
+  /* Leave a tombstone so that probe sequences running through
+     this slot still reach the elements behind it. */
+  found = *slot;
+  t->ctrl[slot - t->slots] = CTRL_DELETED;
+  t->used_cnt--;
+  migrate(h, MIGRATE_STEP);
+  return found;
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+      struct ohash_iterator i;
+
+      ohash_first (&i, h);
+      while (ohash_next (&i))
+        {
+          struct foo *f = ohash_entry (i.elem, struct foo, elem);
+          ...do something with f...
+        }
+
+   Modifying hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(), or
+   ohash_delete(), invalidates all iterators. */
+void ohash_first(struct ohash_iterator* i, struct ohash* h) {
+  ASSERT(i != NULL);
+  ASSERT(h != NULL);
+
+  i->hash = h;
+  i->table = &h->old;
+  i->idx = SIZE_MAX;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct ohash_elem* ohash_next(struct ohash_iterator* i) {
+  ASSERT(i != NULL);
+
+  for (;;) {
+    while (++i->idx < i->table->slot_cnt)
+      if ((i->table->ctrl[i->idx] & 0x80) == 0)
+        return i->elem = i->table->slots[i->idx];
+    if (i->table == &i->hash->cur)
+      return i->elem = NULL;
+    i->table = &i->hash->cur;
+    i->idx = SIZE_MAX;
+  }
+}
+
+/* Returns the number of elements in H. */
+size_t ohash_size(struct ohash* h) { return h->cur.used_cnt + h->old.used_cnt; }
+
+/* Returns true if H contains no elements, false otherwise. */
+bool ohash_empty(struct ohash* h) { return ohash_size(h) == 0; }
+
+/* Mixes the bits of X so that every input bit affects every
+   output bit (the MurmurHash3 finalizer). */
+static inline uint32_t fmix32(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+
+/* Returns a hash of the SIZE bytes in BUF.  This is MurmurHash3
+   (x86, 32-bit), which takes the input four bytes at a time
+   instead of the byte at a time of hash_bytes(). */
+unsigned ohash_bytes(const void* buf_, size_t size) {
+  const uint8_t* buf = buf_;
+  uint32_t hash = 0x9747b28cu;
+  uint32_t k;
+  size_t i;
+
+  ASSERT(buf != NULL);
+
+  for (i = 0; i + 4 <= size; i += 4) {
+    memcpy(&k, buf + i, sizeof k);
+    k *= 0xcc9e2d51u;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593u;
+    hash ^= k;
+    hash = (hash << 13) | (hash >> 19);
+    hash = hash * 5 + 0xe6546b64u;
+  }
+
+  k = 0;
+  switch (size & 3) {
+    case 3:
+      k ^= buf[i + 2] << 16;
+      /* Fall through. */
+    case 2:
+      k ^= buf[i + 1] << 8;
+      /* Fall through. */
+    case 1:
+      k ^= buf[i];
+      k *= 0xcc9e2d51u;
+      k = (k << 15) | (k >> 17);
+      k *= 0x1b873593u;
+      hash ^= k;
+  }
+
+  return fmix32(hash ^ size);
+}
+
+/* Returns a hash of integer I. */
+unsigned ohash_int(uint32_t i) { return fmix32(i); }
+
+/* Initializes T as a table with no slots. */
+static void table_init(struct ohash_table* t) {
+  t->slot_cnt = t->used_cnt = t->free_cnt = 0;
+  t->ctrl = NULL;
+  t->slots = NULL;
+}
+
+/* Allocates SLOT_CNT empty slots for T.  The slot pointers and
+   the control bytes share one allocation. */
+static bool table_alloc(struct ohash_table* t, size_t slot_cnt) {
+  ASSERT(slot_cnt % OHASH_GROUP == 0);
+
+  t->slots = malloc(slot_cnt * (sizeof *t->slots + 1));
+  if (t->slots == NULL) {
+    table_init(t);
+    return false;
+  }
+  t->ctrl = (uint8_t*)(t->slots + slot_cnt);
+  memset(t->ctrl, CTRL_EMPTY, slot_cnt);
+  t->slot_cnt = slot_cnt;
+  t->used_cnt = 0;
+  t->free_cnt = slot_cnt / 8 * 7;
+  return true;
+}
+
+/* Frees T's slots. */
+static void table_free(struct ohash_table* t) {
+  free(t->slots);
+  table_init(t);
+}
+
+/* Returns the slot of T that holds an element equal to E, or a
+   null pointer if there is none.  E->hash must be up to date.
+   Groups are probed in triangular order, which visits every
+   group once when the group count is a power of 2. */
+static struct ohash_elem** table_find(struct ohash* h, struct ohash_table* t,
+                                      struct ohash_elem* e) {
+  size_t group_mask, g, step;
+  uint8_t tag = hash_tag(e->hash);
+
+  if (t->used_cnt == 0)
+    return NULL;
+
+  group_mask = t->slot_cnt / OHASH_GROUP - 1;
+  g = hash_group(e->hash) & group_mask;
+  for (step = 1; step <= group_mask + 1; step++) {
+    uint32_t word = load_group(t, g);
+    uint32_t mask = match_tag(word, tag);
+
+    while (mask != 0) {
+      size_t idx = g * OHASH_GROUP + next_match(&mask);
+      struct ohash_elem* cand = t->slots[idx];
+      if (t->ctrl[idx] == tag && cand->hash == e->hash && h->equal(cand, e, h->aux))
+        return &t->slots[idx];
+    }
+    if (match_empty(word) != 0)
+      return NULL;
+    g = (g + step) & group_mask;
+  }
+  return NULL;
+}
+
+/* Stores E, which is not yet in T, in the first free slot along
+   its probe sequence.  T must have a free slot. */
+static void table_put(struct ohash_table* t, struct ohash_elem* e) {
+  size_t group_mask = t->slot_cnt / OHASH_GROUP - 1;
+  size_t g = hash_group(e->hash) & group_mask;
+  size_t step;
+
+  for (step = 1;; step++) {
+    uint32_t mask = match_free(load_group(t, g));
+    if (mask != 0) {
+      size_t idx = g * OHASH_GROUP + next_match(&mask);
+      if (t->ctrl[idx] == CTRL_EMPTY)
+        t->free_cnt--;
+      t->ctrl[idx] = hash_tag(e->hash);
+      t->slots[idx] = e;
+      t->used_cnt++;
+      return;
+    }
+    g = (g + step) & group_mask;
+  }
+}
+
+/* Moves the elements in up to SLOT_CNT slots of H's old table
+   into its current table, and frees the old table once it has
+   been fully scanned.  Migrated slots become tombstones so that
+   lookups in the old table stay correct meanwhile. */
+static void migrate(struct ohash* h, size_t slot_cnt) {
+  struct ohash_table* old = &h->old;
+
+  if (old->slot_cnt == 0)
+    return;
+
+  while (slot_cnt-- > 0 && h->migrate_idx < old->slot_cnt) {
+    size_t idx = h->migrate_idx++;
+    if ((old->ctrl[idx] & 0x80) == 0) {
+      table_put(&h->cur, old->slots[idx]);
+      old->ctrl[idx] = CTRL_DELETED;
+      old->used_cnt--;
+    }
+  }
+
+  if (h->migrate_idx >= old->slot_cnt) {
+    ASSERT(old->used_cnt == 0);
+    table_free(old);
+    h->migrate_idx = 0;
+  }
+}
+
+/* Replaces H's current table by a fresh one and starts migrating
+   the elements of the current table into it.  The new table
+   doubles in size unless most of the used-up slots were
+   tombstones, in which case it keeps the same size.  Returns
+   false if memory could not be allocated. */
+static bool grow(struct ohash* h) {
+  struct ohash_table fresh;
+  size_t slot_cnt = h->cur.slot_cnt;
+
+  /* Finish any earlier migration first, so that there are never
+     more than two tables. */
+  migrate(h, SIZE_MAX);
+
+  if (slot_cnt == 0)
+    slot_cnt = MIN_SLOTS;
+  else if (h->cur.used_cnt >= slot_cnt / 16 * 7)
+    slot_cnt *= 2;
+
+  if (!table_alloc(&fresh, slot_cnt))
+    return false;
+  h->old = h->cur;
+  h->cur = fresh;
+  h->migrate_idx = 0;
+  return true;
+}
@@ -0,0 +1,111 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   This is an alternative to the chained table in hash.h for
+   lookup-heavy kernel tables.  It follows the layout popularized
+   by "Swiss tables": the slots are split into groups of
+   OHASH_GROUP, and next to the array of slot pointers there is
+   an array of one-byte "control" tags, one per slot.  A control
+   byte says whether its slot is empty, deleted, or full, and for
+   full slots also holds 7 bits of the element's hash.  A probe
+   loads a whole group of control bytes as one 32-bit word and
+   compares all of them against the wanted tag at once, so most
+   lookups touch one word of metadata and one element.
+
+   Like struct hash, the table is intrusive: each structure that
+   can be in an ohash embeds a struct ohash_elem, and the table
+   only stores pointers to those.  The element caches its full
+   hash value, which lets the table skip most calls to the
+   equality function and lets it move elements between tables
+   without rehashing them.
+
+   Growing the table does not move every element at once.
+   Instead, the old slot array is kept next to the new one and a
+   few of its slots are migrated on every insertion or deletion,
+   so that no single operation pays for the whole rehash.  Lookups
+   consult both arrays while a migration is in progress. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash element. */
+struct ohash_elem {
+  unsigned hash; /* Cached hash value, owned by ohash.c. */
+};
+
+/* Converts pointer to hash element OHASH_ELEM into a pointer to
+   the structure that OHASH_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the hash element. */
+#define ohash_entry(OHASH_ELEM, STRUCT, MEMBER)                                                    \
+  ((STRUCT*)((uint8_t*)&(OHASH_ELEM)->hash - offsetof(STRUCT, MEMBER.hash)))
+
+/* Computes and returns the hash value for hash element E, given
+   auxiliary data AUX. */
+typedef unsigned ohash_hash_func(const struct ohash_elem* e, void* aux);
+
+/* Returns true if hash elements A and B have equal keys, given
+   auxiliary data AUX. */
+typedef bool ohash_equal_func(const struct ohash_elem* a, const struct ohash_elem* b, void* aux);
+
+/* Performs some operation on hash element E, given auxiliary
+   data AUX. */
+typedef void ohash_action_func(struct ohash_elem* e, void* aux);
+
+/* Number of slots whose control bytes are scanned together. */
+#define OHASH_GROUP 4
+
+/* One array of slots. */
+struct ohash_table {
+  size_t slot_cnt;           /* Number of slots, a power of 2. */
+  size_t used_cnt;           /* Number of full slots. */
+  size_t free_cnt;           /* Empty slots left before growing. */
+  uint8_t* ctrl;             /* Control byte of each slot. */
+  struct ohash_elem** slots; /* Element in each full slot. */
+};
+
+/* Hash table. */
+struct ohash {
+  struct ohash_table cur;  /* Table that receives insertions. */
+  struct ohash_table old;  /* Table being migrated, if any. */
+  size_t migrate_idx;      /* Next slot of OLD to migrate. */
+  ohash_hash_func* hash;   /* Hash function. */
+  ohash_equal_func* equal; /* Equality function. */
+  void* aux;               /* Auxiliary data for `hash' and `equal'. */
+};
+
+/* A hash table iterator. */
+struct ohash_iterator {
+  struct ohash* hash;         /* The hash table. */
+  struct ohash_table* table;  /* Table being iterated. */
+  size_t idx;                 /* Index of current slot. */
+  struct ohash_elem* elem;    /* Current element. */
+};
+
+/* Basic life cycle. */
+void ohash_init(struct ohash*, ohash_hash_func*, ohash_equal_func*, void* aux);
+void ohash_clear(struct ohash*, ohash_action_func*);
+void ohash_destroy(struct ohash*, ohash_action_func*);
+bool ohash_reserve(struct ohash*, size_t elem_cnt);
+
+/* Search, insertion, deletion. */
+struct ohash_elem* ohash_insert(struct ohash*, struct ohash_elem*);
+struct ohash_elem* ohash_find(struct ohash*, struct ohash_elem*);
+struct ohash_elem* ohash_delete(struct ohash*, struct ohash_elem*);
+
+/* Iteration. */
+void ohash_first(struct ohash_iterator*, struct ohash*);
+struct ohash_elem* ohash_next(struct ohash_iterator*);
+
+/* Information. */
+size_t ohash_size(struct ohash*);
+bool ohash_empty(struct ohash*);
+
+/* Hash functions that consume their input a word at a time. */
+unsigned ohash_bytes(const void*, size_t);
+unsigned ohash_int(uint32_t);
+
+#endif /* lib/kernel/ohash.h */
@@ -0,0 +1,420 @@
+/* Radix tree.
+
+   See radix.h for basic information. */
+
+#include "radix.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "../debug.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RADIX_MASK (RADIX_FANOUT - 1)
+#define TAG_WORDS (RADIX_FANOUT / 32)
+
+/* Tree node.  At the bottom level the slots hold items, above it
+   they hold child nodes. */
+struct radix_node {
+  struct radix_node* parent;               /* Parent, or null for the root. */
+  uint8_t offset;                          /* Slot of this node in PARENT. */
+  uint8_t count;                           /* Number of non-null slots. */
+  uint32_t tags[RADIX_TAGS][TAG_WORDS];    /* Slots that carry each tag. */
+  void* slots[RADIX_FANOUT];               /* Children or items. */
+};
+
+static struct radix_node* node_alloc(void);
+static void node_free(struct radix_node*);
+static bool extend(struct radix_tree*, unsigned long index);
+static struct radix_node* find_leaf(const struct radix_tree*, unsigned long index);
+static void prune(struct radix_tree*, struct radix_node*);
+static void shrink(struct radix_tree*);
+static void clear_tag_upward(struct radix_node*, unsigned offset, unsigned tag);
+static size_t gang(const struct radix_node*, unsigned shift, unsigned long base,
+                   unsigned long first, int tag, size_t max_items, void** items,
+                   unsigned long* indexes, size_t cnt);
+static void destroy_node(struct radix_node*, unsigned shift, unsigned long base,
+                         radix_action_func*, void* aux);
+
+/* Tag bit helpers. */
+static inline bool tag_test(const struct radix_node* n, unsigned tag, unsigned ofs) {
+  return (n->tags[tag][ofs / 32] >> (ofs % 32)) & 1;
+}
+static inline void tag_set(struct radix_node* n, unsigned tag, unsigned ofs) {
+  n->tags[tag][ofs / 32] |= 1u << (ofs % 32);
+}
+static inline void tag_clear(struct radix_node* n, unsigned tag, unsigned ofs) {
+  n->tags[tag][ofs / 32] &= ~(1u << (ofs % 32));
+}
+static inline bool tag_any(const struct radix_node* n, unsigned tag) {
+  unsigned i;
+  for (i = 0; i < TAG_WORDS; i++)
+    if (n->tags[tag][i] != 0)
+      return true;
+  return false;
+}
+
+/* Returns the largest index that a tree of HEIGHT levels can
+   hold. */
+static inline unsigned long max_index(unsigned height) {
+  if (height * RADIX_BITS >= sizeof(unsigned long) * CHAR_BIT)
+    return ULONG_MAX;
+  return (1ul << (height * RADIX_BITS)) - 1;
+}
+
+/* Initializes T as an empty tree. */
+void radix_init(struct radix_tree* t) {
+  t->root = NULL;
+  t->height = 0;
+  t->item_cnt = 0;
+}
+
+/* Frees all of T's nodes, leaving it empty.  If ACTION is
+   non-null, it is first called for each item in index order,
+   given auxiliary data AUX, and may free the item. */
+void radix_destroy(struct radix_tree* t, radix_action_func* action, void* aux) {
+  if (t->root != NULL)
+    destroy_node(t->root, (t->height - 1) * RADIX_BITS, 0, action, aux);
+  radix_init(t);
+}
+
+/* Inserts ITEM, which must not be null, at INDEX in T.  Returns
+   true if successful, false if INDEX was already in use or if
+   memory ran out. */
+bool radix_insert(struct radix_tree* t, unsigned long index, void* item) {
+  struct radix_node* node;
+  unsigned shift;
+
+  ASSERT(item != NULL);
+
+  if (!extend(t, index))
+    return false;
+
+  node = t->root;
+  for (shift = (t->height - 1) * RADIX_BITS; shift > 0; shift -= RADIX_BITS) {
+    unsigned ofs = (index >> shift) & RADIX_MASK;
+    struct radix_node* child = node->slots[ofs];
+
+    if (child == NULL) {
+      child = node_alloc();
+      if (child == NULL) {
+        prune(t, node);
+        shrink(t);
+        return false;
+      }
+      child->parent = node;
+      child->offset = ofs;
+      node->slots[ofs] = child;
+      node->count++;
+    }
+    node = child;
+  }
+
+  if (node->slots[index & RADIX_MASK] != NULL)
+    return false;
+  node->slots[index & RADIX_MASK] = item;
+  node->count++;
+  t->item_cnt++;
+  return true;
+}
+
+/* Returns the item at INDEX in T, or a null pointer if there is
+   none. */
+void* radix_lookup(const struct radix_tree* t, unsigned long index) {
+  struct radix_node* leaf = find_leaf(t, index);
+  return leaf != NULL ? leaf->slots[index & RADIX_MASK] : NULL;
+}
+
+/* Removes and returns the item at INDEX in T, or returns a null
+   pointer if there is none.  Nodes left empty are freed and the
+   tree loses levels it no longer needs. */
+void* radix_delete(struct radix_tree* t, unsigned long index) {
+  struct radix_node* leaf = find_leaf(t, index);
+  unsigned ofs = index & RADIX_MASK;
+  unsigned tag;
+  void* item;
+
+  if (leaf == NULL || leaf->slots[ofs] == NULL)
+    return NULL;
+
+  item = leaf->slots[ofs];
+  leaf->slots[ofs] = NULL;
+  leaf->count--;
+  for (tag = 0; tag < RADIX_TAGS; tag++)
+    clear_tag_upward(leaf, ofs, tag);
+  t->item_cnt--;
+
+  prune(t, leaf);
+  shrink(t);
+  return item;
+}
+
+/* Stores in ITEMS up to MAX_ITEMS items of T whose indexes are
+   FIRST or greater, in increasing index order, and returns how
+   many were stored.  If INDEXES is non-null, the index of each
+   item is stored in the corresponding element. */
+size_t radix_gang_lookup(const struct radix_tree* t, unsigned long first, size_t max_items,
+                         void** items, unsigned long* indexes) {
+  if (t->root == NULL || first > max_index(t->height))
+    return 0;
+  return gang(t->root, (t->height - 1) * RADIX_BITS, 0, first, -1, max_items, items, indexes, 0);
+}
+
+/* Sets TAG on the item at INDEX in T, which must exist. */
+void radix_tag_set(struct radix_tree* t, unsigned long index, unsigned tag) {
+  struct radix_node* node = find_leaf(t, index);
+  unsigned ofs = index & RADIX_MASK;
+
+  ASSERT(tag < RADIX_TAGS);
+  ASSERT(node != NULL && node->slots[ofs] != NULL);
+
+  for (; node != NULL; ofs = node->offset, node = node->parent) {
+    if (tag_test(node, tag, ofs))
+      break;
+    tag_set(node, tag, ofs);
+  }
+}
+
+/* Clears TAG on the item at INDEX in T, if it exists. */
+void radix_tag_clear(struct radix_tree* t, unsigned long index, unsigned tag) {
+  struct radix_node* leaf = find_leaf(t, index);
+
+  ASSERT(tag < RADIX_TAGS);
+  if (leaf != NULL)
+    clear_tag_upward(leaf, index & RADIX_MASK, tag);
+}
+
+/* Returns true if the item at INDEX in T carries TAG. */
+bool radix_tag_get(const struct radix_tree* t, unsigned long index, unsigned tag) {
+  struct radix_node* leaf = find_leaf(t, index);
+
+  ASSERT(tag < RADIX_TAGS);
+  return leaf != NULL && tag_test(leaf, tag, index & RADIX_MASK);
+}
+
+/* Returns true if any item in T carries TAG. */
+bool radix_tagged(const struct radix_tree* t, unsigned tag) {
+  ASSERT(tag < RADIX_TAGS);
+  return t->root != NULL && tag_any(t->root, tag);
+}
+
+/* Like radix_gang_lookup(), but only returns items that carry
+   TAG, and skips untagged subtrees without visiting them. */
+size_t radix_gang_lookup_tag(const struct radix_tree* t, unsigned long first, size_t max_items,
+                             unsigned tag, void** items, unsigned long* indexes) {
+  ASSERT(tag < RADIX_TAGS);
+  if (t->root == NULL || first > max_index(t->height))
+    return 0;
+  return gang(t->root, (t->height - 1) * RADIX_BITS, 0, first, tag, max_items, items, indexes,
+              0);
+}
+
+/* Returns the number of items in T. */
+size_t radix_size(const struct radix_tree* t) { return t->item_cnt; }
+
+/* Returns true if T holds no items, false otherwise. */
+bool radix_empty(const struct radix_tree* t) { return t->item_cnt == 0; }
+
+/* Makes T tall enough to hold INDEX, allocating a root if T is
+   empty.  Returns false if memory ran out. */
+static bool extend(struct radix_tree* t, unsigned long index) {
+  if (t->root == NULL) {
+    t->root = node_alloc();
+    if (t->root == NULL)
+      return false;
+    for (t->height = 1; index > max_index(t->height); t->height++)
+      continue;
+    return true;
+  }
+
+  while (index > max_index(t->height)) {
+    struct radix_node* root = node_alloc();
+    unsigned tag;
+
+    if (root == NULL)
+      return false;
+    root->slots[0] = t->root;
+    root->count = 1;
+    for (tag = 0; tag < RADIX_TAGS; tag++)
+      if (tag_any(t->root, tag))
+        tag_set(root, tag, 0);
+    t->root->parent = root;
+    t->root->offset = 0;
+    t->root = root;
+    t->height++;
+  }
+  return true;
+}
+
+/* Returns the bottom-level node of T that would hold INDEX, or a
+   null pointer if it does not exist. */
+static struct radix_node* find_leaf(const struct radix_tree* t, unsigned long index) {
+  struct radix_node* node = t->root;
+  unsigned shift;
+
+  if (node == NULL || index > max_index(t->height))
+    return NULL;
+
+  for (shift = (t->height - 1) * RADIX_BITS; shift > 0 && node != NULL; shift -= RADIX_BITS)
+    node = node->slots[(index >> shift) & RADIX_MASK];
+  return node;
+}
+
+/* Frees NODE and its ancestors in T as long as they are empty. */
+static void prune(struct radix_tree* t, struct radix_node* node) {
+  while (node != NULL && node->count == 0) {
+    struct radix_node* parent = node->parent;
+
+    if (parent == NULL) {
+      t->root = NULL;
+      t->height = 0;
+    } else {
+      unsigned tag;
+
+      parent->slots[node->offset] = NULL;
+      parent->count--;
+      for (tag = 0; tag < RADIX_TAGS; tag++)
+        clear_tag_upward(parent, node->offset, tag);
+    }
+    node_free(node);
+    node = parent;
+  }
+}
+
+/* Removes root levels of T whose only child is in slot 0, since
+   all of their indexes fit in a shorter tree. */
+static void shrink(struct radix_tree* t) {
+  while (t->height > 1 && t->root->count == 1 && t->root->slots[0] != NULL) {
+    struct radix_node* root = t->root;
+
+    t->root = root->slots[0];
+    t->root->parent = NULL;
+    t->height--;
+    node_free(root);
+  }
+}
+
+/* Clears TAG on slot OFS of NODE, and then in each ancestor
+   whose child no longer has TAG anywhere. */
+static void clear_tag_upward(struct radix_node* node, unsigned ofs, unsigned tag) {
+  for (; node != NULL; ofs = node->offset, node = node->parent) {
+    if (!tag_test(node, tag, ofs))
+      break;
+    tag_clear(node, tag, ofs);
+    if (tag_any(node, tag))
+      break;
+  }
+}
+
+/* Collects items for radix_gang_lookup() and
+   radix_gang_lookup_tag() from the subtree NODE, whose slots
+   each span 2**SHIFT indexes starting at BASE.  Only indexes
+   FIRST or greater are collected, and only ones that carry TAG
+   if TAG is nonnegative.  CNT items have been collected so far;
+   returns the new count. */
+static size_t gang(const struct radix_node* node, unsigned shift, unsigned long base,
+                   unsigned long first, int tag, size_t max_items, void** items,
+                   unsigned long* indexes, size_t cnt) {
+  unsigned ofs = first > base ? (first - base) >> shift : 0;
+
+  for (; ofs < RADIX_FANOUT && cnt < max_items; ofs++) {
+    unsigned long slot_base;
+    void* slot = node->slots[ofs];
+
+    if (slot == NULL || (tag >= 0 && !tag_test(node, tag, ofs)))
+      continue;
+
+    slot_base = base + ((unsigned long)ofs << shift);
+    if (shift == 0) {
+      items[cnt] = slot;
+      if (indexes != NULL)
+        indexes[cnt] = slot_base;
+      cnt++;
+    } else
+      cnt = gang(slot, shift - RADIX_BITS, slot_base, first > slot_base ? first : slot_base, tag,
+                 max_items, items, indexes, cnt);
+  }
+  return cnt;
+}
+
+/* Frees the subtree NODE for radix_destroy(), calling ACTION on
+   each item.  NODE's slots each span 2**SHIFT indexes starting
+   at BASE. */
+static void destroy_node(struct radix_node* node, unsigned shift, unsigned long base,
+                         radix_action_func* action, void* aux) {
+  unsigned ofs;
+
+  for (ofs = 0; ofs < RADIX_FANOUT; ofs++) {
+    void* slot = node->slots[ofs];
+    unsigned long slot_base = base + ((unsigned long)ofs << shift);
+
+    if (slot == NULL)
+      continue;
+    if (shift == 0) {
+      if (action != NULL)
+        action(slot_base, slot, aux);
+    } else
+      destroy_node(slot, shift - RADIX_BITS, slot_base, action, aux);
+  }
+  node_free(node);
+}
+
+/* Node cache.
+
+   Nodes are carved out of whole pages from the kernel pool.
+   Free nodes are chained through their `parent' member.  The
+   list is short-lived critical section material, so it is
+   guarded by disabling interrupts rather than by a lock; pages
+   are obtained from palloc with interrupts on. */
+static struct radix_node* free_nodes; /* Free list. */
+static size_t cache_pages;            /* Pages obtained from palloc. */
+static size_t nodes_used;             /* Nodes handed out. */
+
+#define NODES_PER_PAGE (PGSIZE / sizeof(struct radix_node))
+
+/* Returns a zeroed node, or a null pointer if memory ran out. */
+static struct radix_node* node_alloc(void) {
+  struct radix_node* node;
+  enum intr_level old_level;
+
+  old_level = intr_disable();
+  if (free_nodes == NULL) {
+    struct radix_node* page;
+    size_t i;
+
+    intr_set_level(old_level);
+    page = palloc_get_page(0);
+    if (page == NULL)
+      return NULL;
+
+    old_level = intr_disable();
+    for (i = 0; i < NODES_PER_PAGE; i++) {
+      page[i].parent = free_nodes;
+      free_nodes = &page[i];
+    }
+    cache_pages++;
+  }
+  node = free_nodes;
+  free_nodes = node->parent;
+  nodes_used++;
+  intr_set_level(old_level);
+
+  memset(node, 0, sizeof *node);
+  return node;
+}
+
+/* Returns NODE to the cache. */
+static void node_free(struct radix_node* node) {
+  enum intr_level old_level = intr_disable();
+  node->parent = free_nodes;
+  free_nodes = node;
+  nodes_used--;
+  intr_set_level(old_level);
+}
+
+/* Prints node cache statistics. */
+void radix_print_stats(void) {
+  printf("Radix tree: %zu nodes in use, %zu cached in %zu pages\n", nodes_used,
+         cache_pages * NODES_PER_PAGE - nodes_used, cache_pages);
+}
@@ -0,0 +1,76 @@
+#ifndef __LIB_KERNEL_RADIX_H
+#define __LIB_KERNEL_RADIX_H
+
+/* Radix tree.
+
+   Maps unsigned long indexes to non-null pointers.  It suits
+   sparse integer keys such as file descriptors, page numbers, or
+   user addresses, where a list would need a linear scan and a
+   hash table would lose the ordering.
+
+   Each node covers RADIX_BITS bits of the index and has
+   RADIX_FANOUT slots.  The tree is only as tall as the largest
+   index needs: indexes below 64 take one level, indexes below
+   4096 two, and so on up to six levels for the full 32 bits.
+   Empty subtrees are never allocated, and a node is freed as
+   soon as its last slot empties.
+
+   Every slot can also carry RADIX_TAGS tag bits.  A tag on an
+   item is propagated up the tree, so that the items carrying a
+   tag (for example "dirty") can be found without visiting the
+   untagged parts of the tree.
+
+   Nodes come from a dedicated cache of pages that is shared by
+   all trees, not from malloc(), because a node does not fit any
+   malloc() size class well.
+
+   The tree does not do its own locking. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RADIX_BITS 6                  /* Index bits per level. */
+#define RADIX_FANOUT (1 << RADIX_BITS) /* Slots per node. */
+#define RADIX_TAGS 2                  /* Tag bits per slot. */
+
+struct radix_node;
+
+/* Radix tree. */
+struct radix_tree {
+  struct radix_node* root; /* Root node, or null if empty. */
+  unsigned height;         /* Number of levels. */
+  size_t item_cnt;         /* Number of items. */
+};
+
+/* Performs some operation on the item at INDEX, given auxiliary
+   data AUX. */
+typedef void radix_action_func(unsigned long index, void* item, void* aux);
+
+/* Basic life cycle. */
+void radix_init(struct radix_tree*);
+void radix_destroy(struct radix_tree*, radix_action_func*, void* aux);
+
+/* Search, insertion, deletion. */
+bool radix_insert(struct radix_tree*, unsigned long index, void* item);
+void* radix_lookup(const struct radix_tree*, unsigned long index);
+void* radix_delete(struct radix_tree*, unsigned long index);
+size_t radix_gang_lookup(const struct radix_tree*, unsigned long first, size_t max_items,
+                         void** items, unsigned long* indexes);
+
+/* Tags. */
+void radix_tag_set(struct radix_tree*, unsigned long index, unsigned tag);
+void radix_tag_clear(struct radix_tree*, unsigned long index, unsigned tag);
+bool radix_tag_get(const struct radix_tree*, unsigned long index, unsigned tag);
+bool radix_tagged(const struct radix_tree*, unsigned tag);
+size_t radix_gang_lookup_tag(const struct radix_tree*, unsigned long first, size_t max_items,
+                             unsigned tag, void** items, unsigned long* indexes);
+
+/* Information. */
+size_t radix_size(const struct radix_tree*);
+bool radix_empty(const struct radix_tree*);
+
+/* Node cache. */
+void radix_print_stats(void);
+
+#endif /* lib/kernel/radix.h */
@@ -0,0 +1,364 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms are the
+   ones in [CLRS] chapter 13, adapted to use null pointers
+   instead of a sentinel leaf. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left(struct rb_root*, struct rb_node*);
+static void rotate_right(struct rb_root*, struct rb_node*);
+static void transplant(struct rb_root*, struct rb_node* old, struct rb_node* new);
+static void erase_fixup(struct rb_root*, struct rb_node* x, struct rb_node* parent);
+
+/* Returns true if NODE is red.  Null leaves are black. */
+static inline bool is_red(const struct rb_node* node) { return node != NULL && node->red; }
+
+/* Calls ROOT's augment function on NODE, if there is one. */
+static inline void augment(struct rb_root* root, struct rb_node* node) {
+  if (root->augment != NULL)
+    root->augment(node);
+}
+
+/* Initializes ROOT as an empty tree.  If AUGMENT is non-null,
+   it is called to maintain each node's augmented value. */
+void rb_init(struct rb_root* root, rb_augment_func* augment) {
+  ASSERT(root != NULL);
+  root->node = NULL;
+  root->augment = augment;
+}
+
+/* Returns true if ROOT is empty, false otherwise. */
+bool rb_empty(const struct rb_root* root) { return root->node == NULL; }
+
+/* Inserts NODE into ROOT in the position given by LESS, given
+   auxiliary data AUX.  NODE goes after any nodes that are equal
+   to it. */
+void rb_insert(struct rb_root* root, struct rb_node* node, rb_less_func* less, void* aux) {
+  struct rb_node** link = &root->node;
+  struct rb_node* parent = NULL;
+
+  while (*link != NULL) {
+    parent = *link;
+    link = less(node, parent, aux) ? &parent->left : &parent->right;
+  }
+  rb_link(root, node, parent, link);
+}
+
+/* Inserts NODE into ROOT as a child of PARENT, which must be
+   null if the tree is empty.  LINK must be the null child
+   pointer of PARENT where NODE belongs (or &ROOT->node), as
+   found by the caller's own descent.  Then restores the
+   red-black properties. */
+void rb_link(struct rb_root* root, struct rb_node* node, struct rb_node* parent,
+             struct rb_node** link) {
+  ASSERT(*link == NULL);
+
+  node->parent = parent;
+  node->left = node->right = NULL;
+  node->red = true;
+  *link = node;
+  rb_augment_propagate(root, node);
+
+  /* Walk up while there are two reds in a row.  PARENT is red,
+     so it is not the root and GRANDPARENT exists. */
+  while (is_red(node->parent)) {
+    struct rb_node* grandparent;
+    struct rb_node* uncle;
+
+    parent = node->parent;
+    grandparent = parent->parent;
+    if (parent == grandparent->left) {
+      uncle = grandparent->right;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        node = grandparent;
+      } else {
+        if (node == parent->right) {
+          node = parent;
+          rotate_left(root, node);
+          parent = node->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_right(root, grandparent);
+      }
+    } else {
+      uncle = grandparent->left;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        node = grandparent;
+      } else {
+        if (node == parent->left) {
+          node = parent;
+          rotate_right(root, node);
+          parent = node->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_left(root, grandparent);
+      }
+    }
+  }
+  root->node->red = false;
+}
+
+/* Removes NODE from ROOT and restores the red-black
+   properties.  NODE's own members are left undefined. */
+void rb_erase(struct rb_root* root, struct rb_node* node) {
+  struct rb_node* child;  /* Node that moves into the hole. */
+  struct rb_node* parent; /* CHILD's new parent. */
+  bool removed_red;
+
+  if (node->left == NULL || node->right == NULL) {
+    child = node->left != NULL ? node->left : node->right;
+    parent = node->parent;
+    removed_red = node->red;
+    transplant(root, node, child);
+  } else {
+    /* Splice out NODE's successor, which has no left child, and
+       put it where NODE was. */
+    struct rb_node* next = node->right;
+    while (next->left != NULL)
+      next = next->left;
+
+    removed_red = next->red;
+    child = next->right;
+    if (next->parent == node)
+      parent = next;
+    else {
+      parent = next->parent;
+      transplant(root, next, child);
+      next->right = node->right;
+      next->right->parent = next;
+    }
+    transplant(root, node, next);
+    next->left = node->left;
+    next->left->parent = next;
+    next->red = node->red;
+  }
+
+  /* Every node whose subtree lost NODE lies on the path from
+     PARENT up to the root. */
+  if (parent != NULL)
+    rb_augment_propagate(root, parent);
+
+  if (!removed_red)
+    erase_fixup(root, child, parent);
+}
+
+/* Puts NEW in OLD's place in ROOT, without rebalancing.  NEW
+   must sort the same as OLD and must not be in the tree. */
+void rb_replace(struct rb_root* root, struct rb_node* old, struct rb_node* new) {
+  *new = *old;
+  transplant(root, old, new);
+  if (new->left != NULL)
+    new->left->parent = new;
+  if (new->right != NULL)
+    new->right->parent = new;
+  augment(root, new);
+}
+
+/* Returns the first node in ROOT that is not less than KEY
+   according to LESS, given auxiliary data AUX, or a null pointer
+   if every node is less than KEY. */
+struct rb_node* rb_lower_bound(const struct rb_root* root, const struct rb_node* key,
+                               rb_less_func* less, void* aux) {
+  struct rb_node* node = root->node;
+  struct rb_node* result = NULL;
+
+  while (node != NULL)
+    if (less(node, key, aux))
+      node = node->right;
+    else {
+      result = node;
+      node = node->left;
+    }
+  return result;
+}
+
+/* Returns the first node in ROOT equal to KEY according to LESS,
+   given auxiliary data AUX, or a null pointer if there is
+   none. */
+struct rb_node* rb_find(const struct rb_root* root, const struct rb_node* key, rb_less_func* less,
+                        void* aux) {
+  struct rb_node* node = rb_lower_bound(root, key, less, aux);
+  return node != NULL && !less(key, node, aux) ? node : NULL;
+}
+
+/* Returns the smallest node in ROOT, or a null pointer if ROOT
+   is empty. */
+struct rb_node* rb_first(const struct rb_root* root) {
+  struct rb_node* node = root->node;
+  if (node != NULL)
+    while (node->left != NULL)
+      node = node->left;
+  return node;
+}
+
+/* Returns the largest node in ROOT, or a null pointer if ROOT
+   is empty. */
+struct rb_node* rb_last(const struct rb_root* root) {
+  struct rb_node* node = root->node;
+  if (node != NULL)
+    while (node->right != NULL)
+      node = node->right;
+  return node;
+}
+
+/* Returns the node that follows NODE in order, or a null pointer
+   if NODE is the largest. */
+struct rb_node* rb_next(const struct rb_node* node) {
+  if (node->right != NULL) {
+    node = node->right;
+    while (node->left != NULL)
+      node = node->left;
+    return (struct rb_node*)node;
+  }
+  while (node->parent != NULL && node == node->parent->right)
+    node = node->parent;
+  return node->parent;
+}
+
+/* Returns the node that precedes NODE in order, or a null
+   pointer if NODE is the smallest. */
+struct rb_node* rb_prev(const struct rb_node* node) {
+  if (node->left != NULL) {
+    node = node->left;
+    while (node->right != NULL)
+      node = node->right;
+    return (struct rb_node*)node;
+  }
+  while (node->parent != NULL && node == node->parent->left)
+    node = node->parent;
+  return node->parent;
+}
+
+/* Recomputes the augmented values of NODE and all of its
+   ancestors in ROOT.  Does nothing if ROOT is not augmented. */
+void rb_augment_propagate(struct rb_root* root, struct rb_node* node) {
+  if (root->augment == NULL)
+    return;
+  for (; node != NULL; node = node->parent)
+    root->augment(node);
+}
+
+/* Rotates the right child of NODE in ROOT up into NODE's place:
+
+       NODE                 RIGHT
+       /  \                 /   \
+      a   RIGHT    ==>    NODE   c
+          /   \           /  \
+         b     c         a    b
+*/
+static void rotate_left(struct rb_root* root, struct rb_node* node) {
+  struct rb_node* right = node->right;
+
+  node->right = right->left;
+  if (right->left != NULL)
+    right->left->parent = node;
+  transplant(root, node, right);
+  right->left = node;
+  node->parent = right;
+
+  augment(root, node);
+  augment(root, right);
+}
+
+/* Rotates the left child of NODE in ROOT up into NODE's place;
+   the mirror image of rotate_left(). */
+static void rotate_right(struct rb_root* root, struct rb_node* node) {
+  struct rb_node* left = node->left;
+
+  node->left = left->right;
+  if (left->right != NULL)
+    left->right->parent = node;
+  transplant(root, node, left);
+  left->right = node;
+  node->parent = left;
+
+  augment(root, node);
+  augment(root, left);
+}
+
+/* Makes NEW, which may be null, take OLD's place as a child of
+   OLD's parent in ROOT.  OLD's children are not touched. */
+static void transplant(struct rb_root* root, struct rb_node* old, struct rb_node* new) {
+  struct rb_node* parent = old->parent;
+
+  if (parent == NULL)
+    root->node = new;
+  else if (old == parent->left)
+    parent->left = new;
+  else
+    parent->right = new;
+  if (new != NULL)
+    new->parent = parent;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above NODE, which may be null.  NODE's subtree is
+   one black node short.  PARENT is NODE's parent, which we need
+   because NODE may be null. */
+static void erase_fixup(struct rb_root* root, struct rb_node* node, struct rb_node* parent) {
+  while (node != root->node && !is_red(node)) {
+    struct rb_node* sibling;
+
+    if (node == parent->left) {
+      sibling = parent->right;
+      if (is_red(sibling)) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_left(root, parent);
+        sibling = parent->right;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        node = parent;
+        parent = node->parent;
+      } else {
+        if (!is_red(sibling->right)) {
+          sibling->left->red = false;
+          sibling->red = true;
+          rotate_right(root, sibling);
+          sibling = parent->right;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->right->red = false;
+        rotate_left(root, parent);
+        node = root->node;
+      }
+    } else {
+      sibling = parent->left;
+      if (is_red(sibling)) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_right(root, parent);
+        sibling = parent->left;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        node = parent;
+        parent = node->parent;
+      } else {
+        if (!is_red(sibling->left)) {
+          sibling->right->red = false;
+          sibling->red = true;
+          rotate_left(root, sibling);
+          sibling = parent->left;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->left->red = false;
+        rotate_right(root, parent);
+        node = root->node;
+      }
+    }
+  }
+  if (node != NULL)
+    node->red = false;
+}
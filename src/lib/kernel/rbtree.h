@@ -0,0 +1,93 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A balanced binary search tree, for kernel data that needs
+   ordered or range lookups in O(log n) time: address-range
+   descriptors, sleeping threads sorted by wake-up time, and the
+   like.
+
+   Like lists and hash tables, the tree is intrusive: it does not
+   allocate memory.  Each structure that can be in a tree embeds
+   a struct rb_node member, and rb_entry() converts a pointer to
+   that member back into a pointer to the structure.  Refer to
+   lib/kernel/list.h for a detailed explanation of this
+   technique.
+
+   Nodes are ordered by a "less" function supplied by the caller,
+   as for list_insert_ordered().  Equal nodes are allowed; a new
+   node goes after the nodes it is equal to.  Callers that want a
+   custom descent (for example, to look up an address range) can
+   walk the tree themselves through the `left' and `right'
+   members and then call rb_link() at the spot they found.
+
+   Augmented trees.  A tree may keep, in every node, a value
+   computed from that node and its two subtrees, such as the
+   size of the subtree or the largest end address of any range
+   below it.  Pass an augment function to rb_init(); the tree
+   calls it for every node whose subtree changes, children
+   before parents, so that the function can recompute the node's
+   value from its children's.  If a node's own key data changes
+   in a way that affects the value, call rb_augment_propagate()
+   on it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree node. */
+struct rb_node {
+  struct rb_node* parent; /* Parent, or null for the root. */
+  struct rb_node* left;   /* Left child, holds smaller nodes. */
+  struct rb_node* right;  /* Right child, holds larger nodes. */
+  bool red;               /* Color. */
+};
+
+/* Recomputes the augmented value of NODE from NODE itself and
+   its children, which are already up to date. */
+typedef void rb_augment_func(struct rb_node* node);
+
+/* Tree. */
+struct rb_root {
+  struct rb_node* node;     /* Root node, or null if empty. */
+  rb_augment_func* augment; /* Augment function, or null. */
+};
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)                                                          \
+  ((STRUCT*)((uint8_t*)&(RB_NODE)->parent - offsetof(STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+   data AUX.  Returns true if A is less than B, or false if A is
+   greater than or equal to B. */
+typedef bool rb_less_func(const struct rb_node* a, const struct rb_node* b, void* aux);
+
+/* Basic life cycle. */
+void rb_init(struct rb_root*, rb_augment_func*);
+bool rb_empty(const struct rb_root*);
+
+/* Insertion and removal. */
+void rb_insert(struct rb_root*, struct rb_node*, rb_less_func*, void* aux);
+void rb_link(struct rb_root*, struct rb_node*, struct rb_node* parent, struct rb_node** link);
+void rb_erase(struct rb_root*, struct rb_node*);
+void rb_replace(struct rb_root*, struct rb_node* old, struct rb_node* new);
+
+/* Search. */
+struct rb_node* rb_find(const struct rb_root*, const struct rb_node* key, rb_less_func*, void* aux);
+struct rb_node* rb_lower_bound(const struct rb_root*, const struct rb_node* key, rb_less_func*,
+                               void* aux);
+
+/* Traversal, in order. */
+struct rb_node* rb_first(const struct rb_root*);
+struct rb_node* rb_last(const struct rb_root*);
+struct rb_node* rb_next(const struct rb_node*);
+struct rb_node* rb_prev(const struct rb_node*);
+
+/* Augmentation. */
+void rb_augment_propagate(struct rb_root*, struct rb_node*);
+
+#endif /* lib/kernel/rbtree.h */
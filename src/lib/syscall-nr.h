@@ -29,10 +29,19 @@ enum {
   SYS_SEMA_DOWN,    /* Downs a semaphore */
   SYS_SEMA_UP,      /* Ups a semaphore */
   SYS_GET_TID,      /* Gets TID of the current thread */
+  SYS_FORK,         /* Duplicates the current process */
 
   /* Project 3 and optionally project 4. */
-  SYS_MMAP,   /* Map a file into memory. */
-  SYS_MUNMAP, /* Remove a memory mapping. */
+  SYS_MMAP,       /* Map a file into memory. */
+  SYS_MUNMAP,     /* Remove a memory mapping. */
+  SYS_SHM_CREATE, /* Creates or finds a shared memory segment. */
+  SYS_SHM_ATTACH, /* Attaches a shared memory segment. */
+  SYS_SHM_DETACH, /* Detaches a shared memory segment. */
+  SYS_SHM_REMOVE, /* Removes a shared memory segment. */
+  SYS_RSS_LIMIT,  /* Sets the resident set limits. */
+  SYS_RSS_STAT,   /* Reports resident set statistics. */
+  SYS_MADVISE,    /* Gives advice about use of memory. */
+  SYS_VM_STAT,    /* Reports system-wide paging statistics. */
 
   /* Project 4 only. */
   SYS_CHDIR,   /* Change the current directory. */
@@ -79,6 +79,9 @@ void exit(int status) {
 /* 无论父进程有多少个线程，子线程必然只有一个主线程 */
 pid_t exec(const char* file) { return (pid_t)syscall1(SYS_EXEC, file); }
 
+/* 子进程只复制调用fork的线程，页面在写入之前与父进程共享 */
+pid_t fork(void) { return (pid_t)syscall0(SYS_FORK); }
+
 /* 如果子线程对指定进程执行wait，只有该线程会被暂停 */
 int wait(pid_t pid) { return syscall1(SYS_WAIT, pid); }
 
@@ -104,10 +107,32 @@ unsigned tell(int fd) { return syscall1(SYS_TELL, fd); }
 
 void close(int fd) { syscall1(SYS_CLOSE, fd); }
 
-mapid_t mmap(int fd, void* addr) { return syscall2(SYS_MMAP, fd, addr); }
+mapid_t mmap(int fd, void* addr) { return syscall3(SYS_MMAP, fd, addr, 0); }
+
+mapid_t mmap_flags(int fd, void* addr, int flags) {
+  return syscall3(SYS_MMAP, fd, addr, flags);
+}
 
 void munmap(mapid_t mapid) { syscall1(SYS_MUNMAP, mapid); }
 
+bool madvise(void* addr, unsigned length, int advice) {
+  return syscall3(SYS_MADVISE, addr, length, advice);
+}
+
+shmid_t shm_create(int key, unsigned size) { return syscall2(SYS_SHM_CREATE, key, size); }
+
+void* shm_attach(shmid_t id, void* addr) { return (void*)syscall2(SYS_SHM_ATTACH, id, addr); }
+
+bool shm_detach(void* addr) { return syscall1(SYS_SHM_DETACH, addr); }
+
+bool shm_remove(shmid_t id) { return syscall1(SYS_SHM_REMOVE, id); }
+
+bool rss_limit(unsigned soft, unsigned hard) { return syscall2(SYS_RSS_LIMIT, soft, hard); }
+
+bool rss_stat(struct rss_stat* st) { return syscall1(SYS_RSS_STAT, st); }
+
+bool vm_stat(struct vm_stat* st) { return syscall1(SYS_VM_STAT, st); }
+
 bool chdir(const char* dir) { return syscall1(SYS_CHDIR, dir); }
 
 bool mkdir(const char* dir) { return syscall1(SYS_MKDIR, dir); }
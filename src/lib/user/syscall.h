@@ -20,6 +20,40 @@ typedef char sema_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t)-1)
 
+/* Flags for mmap_flags(). */
+#define MAP_SEQUENTIAL 0x1 /* Mapping is read sequentially: fault in ahead. */
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0     /* No special treatment. */
+#define MADV_RANDOM 1     /* Expect random access: no read-ahead. */
+#define MADV_SEQUENTIAL 2 /* Expect sequential access: read ahead, drop behind. */
+#define MADV_WILLNEED 3   /* Will need these pages: prefetch them. */
+#define MADV_DONTNEED 4   /* Free these pages; anonymous memory reads as zero. */
+
+/* Shared memory segment identifier. */
+typedef int shmid_t;
+#define SHM_FAILED ((shmid_t)-1)
+
+/* Resident set statistics filled in by rss_stat(), in pages. */
+struct rss_stat {
+  unsigned rss;             /* Resident pages. */
+  unsigned peak;            /* Peak resident pages. */
+  unsigned soft;            /* Soft limit, 0 if unlimited. */
+  unsigned hard;            /* Hard limit, 0 if unlimited. */
+  unsigned local_evictions; /* Own pages evicted at the limit. */
+};
+
+/* System-wide paging statistics filled in by vm_stat().
+   Disk traffic is counted in sectors. */
+struct vm_stat {
+  unsigned long long page_faults; /* Page faults taken. */
+  unsigned long long evictions;   /* Pages evicted. */
+  unsigned long long fs_reads;    /* Sectors read from the file system device. */
+  unsigned long long fs_writes;   /* Sectors written to the file system device. */
+  unsigned long long swap_reads;  /* Sectors read from the swap device. */
+  unsigned long long swap_writes; /* Sectors written to the swap device. */
+};
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -31,6 +65,7 @@ typedef int mapid_t;
 void halt(void) NO_RETURN;
 void exit(int status) NO_RETURN;
 pid_t exec(const char* file);
+pid_t fork(void);
 int wait(pid_t);
 bool create(const char* file, unsigned initial_size);
 bool remove(const char* file);
@@ -57,7 +92,16 @@ tid_t get_tid(void);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap(int fd, void* addr);
+mapid_t mmap_flags(int fd, void* addr, int flags);
 void munmap(mapid_t);
+bool madvise(void* addr, unsigned length, int advice);
+shmid_t shm_create(int key, unsigned size);
+void* shm_attach(shmid_t, void* addr);
+bool shm_detach(void* addr);
+bool shm_remove(shmid_t);
+bool rss_limit(unsigned soft, unsigned hard);
+bool rss_stat(struct rss_stat*);
+bool vm_stat(struct vm_stat*);
 
 /* Project 4 only. */
 bool chdir(const char* dir);
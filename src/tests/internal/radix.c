@@ -0,0 +1,188 @@
+/* Test program for lib/kernel/radix.c.
+
+   Inserts, tags, and deletes items at random sparse indexes,
+   and after every change checks lookups, gang lookups, and
+   tagged gang lookups against a plain array.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of items in a tree that we will test. */
+#define MAX_SIZE 128
+
+/* An item. */
+struct value {
+  unsigned long index;     /* Index in the tree. */
+  bool in_tree;            /* Currently inserted? */
+  bool tagged[RADIX_TAGS]; /* Tags that should be set. */
+};
+
+static void shuffle(int[], size_t);
+static unsigned long random_index(int level);
+static void verify_tree(struct radix_tree*, struct value[], int size);
+
+/* Test the radix tree implementation. */
+void test(void) {
+  int size;
+
+  printf("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++) {
+    int repeat;
+
+    printf(" %d", size);
+    for (repeat = 0; repeat < 10; repeat++) {
+      static struct value values[MAX_SIZE];
+      static int order[MAX_SIZE];
+      struct radix_tree tree;
+      int level, i, j;
+
+      /* Pick SIZE distinct indexes, spread over every height the
+         tree can have.  A single level has room for only
+         RADIX_FANOUT of them. */
+      level = size > RADIX_FANOUT / 2 ? 1 + repeat % 5 : repeat % 6;
+      for (i = 0; i < size; i++) {
+        do {
+          values[i].index = random_index(level);
+          for (j = 0; j < i; j++)
+            if (values[j].index == values[i].index)
+              break;
+        } while (j < i);
+        values[i].in_tree = false;
+        values[i].tagged[0] = values[i].tagged[1] = false;
+        order[i] = i;
+      }
+      shuffle(order, size);
+
+      /* Insert them one by one.  A second insert must fail. */
+      radix_init(&tree);
+      for (i = 0; i < size; i++) {
+        struct value* v = &values[order[i]];
+        ASSERT(radix_insert(&tree, v->index, v));
+        ASSERT(!radix_insert(&tree, v->index, v));
+        v->in_tree = true;
+        verify_tree(&tree, values, size);
+      }
+
+      /* Tag a random subset, then untag some of it. */
+      for (i = 0; i < size; i++) {
+        unsigned tag = random_ulong() % RADIX_TAGS;
+        radix_tag_set(&tree, values[i].index, tag);
+        values[i].tagged[tag] = true;
+      }
+      verify_tree(&tree, values, size);
+      for (i = 0; i < size; i += 2) {
+        radix_tag_clear(&tree, values[i].index, 0);
+        values[i].tagged[0] = false;
+        verify_tree(&tree, values, size);
+      }
+
+      /* Delete half of them in random order, verifying as we go,
+         then put them back, then delete everything. */
+      shuffle(order, size);
+      for (i = 0; i < size / 2; i++) {
+        struct value* v = &values[order[i]];
+        ASSERT(radix_delete(&tree, v->index) == v);
+        ASSERT(radix_delete(&tree, v->index) == NULL);
+        v->in_tree = v->tagged[0] = v->tagged[1] = false;
+        verify_tree(&tree, values, size);
+      }
+      for (i = 0; i < size / 2; i++) {
+        struct value* v = &values[order[i]];
+        ASSERT(radix_insert(&tree, v->index, v));
+        v->in_tree = true;
+        verify_tree(&tree, values, size);
+      }
+      shuffle(order, size);
+      for (i = 0; i < size; i++) {
+        struct value* v = &values[order[i]];
+        ASSERT(radix_delete(&tree, v->index) == v);
+        v->in_tree = v->tagged[0] = v->tagged[1] = false;
+        verify_tree(&tree, values, size);
+      }
+      ASSERT(radix_empty(&tree));
+      ASSERT(tree.root == NULL);
+    }
+  }
+
+  printf(" done\n");
+  printf("radix: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void shuffle(int* array, size_t cnt) {
+  size_t i;
+
+  for (i = 0; i < cnt; i++) {
+    size_t j = i + random_ulong() % (cnt - i);
+    int t = array[j];
+    array[j] = array[i];
+    array[i] = t;
+  }
+}
+
+/* Returns a random index that needs at most LEVEL + 1 levels,
+   or any index at all if LEVEL is 5 or more. */
+static unsigned long random_index(int level) {
+  unsigned long index = random_ulong();
+  if (level < 5)
+    index &= (1ul << ((level + 1) * RADIX_BITS)) - 1;
+  return index;
+}
+
+/* Verifies that TREE holds exactly the values among the SIZE in
+   VALUES that are marked in_tree, with the right tags. */
+static void verify_tree(struct radix_tree* tree, struct value values[], int size) {
+  static void* items[MAX_SIZE + 1];
+  static unsigned long indexes[MAX_SIZE + 1];
+  size_t cnt, expected;
+  unsigned tag;
+  int i;
+
+  expected = 0;
+  for (i = 0; i < size; i++) {
+    struct value* v = &values[i];
+    if (v->in_tree) {
+      expected++;
+      ASSERT(radix_lookup(tree, v->index) == v);
+      for (tag = 0; tag < RADIX_TAGS; tag++)
+        ASSERT(radix_tag_get(tree, v->index, tag) == v->tagged[tag]);
+    } else
+      ASSERT(radix_lookup(tree, v->index) == NULL);
+  }
+  ASSERT(radix_size(tree) == expected);
+
+  /* Gang lookup returns everything, in increasing order. */
+  cnt = radix_gang_lookup(tree, 0, MAX_SIZE + 1, items, indexes);
+  ASSERT(cnt == expected);
+  for (i = 0; i < (int)cnt; i++) {
+    ASSERT(((struct value*)items[i])->index == indexes[i]);
+    ASSERT(i == 0 || indexes[i - 1] < indexes[i]);
+  }
+
+  /* Starting in the middle skips the earlier items. */
+  if (cnt > 1) {
+    size_t half = cnt / 2;
+    ASSERT(radix_gang_lookup(tree, indexes[half - 1] + 1, MAX_SIZE + 1, items, NULL) ==
+           cnt - half);
+  }
+
+  /* Tagged gang lookups return exactly the tagged items. */
+  for (tag = 0; tag < RADIX_TAGS; tag++) {
+    expected = 0;
+    for (i = 0; i < size; i++)
+      expected += values[i].in_tree && values[i].tagged[tag];
+    ASSERT(radix_tagged(tree, tag) == (expected > 0));
+    cnt = radix_gang_lookup_tag(tree, 0, MAX_SIZE + 1, tag, items, indexes);
+    ASSERT(cnt == expected);
+    for (i = 0; i < (int)cnt; i++)
+      ASSERT(((struct value*)items[i])->tagged[tag]);
+  }
+}
@@ -0,0 +1,194 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and erases values in random order, and after every
+   change checks the red-black properties, the parent pointers,
+   the in-order sequence, and an augmented subtree size kept in
+   each node.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <rbtree.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of nodes in a tree that we will test. */
+#define MAX_SIZE 128
+
+/* A tree node. */
+struct value {
+  struct rb_node node; /* Tree node. */
+  int value;           /* Item value. */
+  int size;            /* Augmented: nodes in subtree. */
+  bool in_tree;        /* Currently inserted? */
+};
+
+static void shuffle(int[], size_t);
+static bool value_less(const struct rb_node*, const struct rb_node*, void*);
+static void value_augment(struct rb_node*);
+static int verify_subtree(struct rb_node*, struct rb_node* parent, int* black_height);
+static void verify_tree(struct rb_root*, struct value[], int size);
+
+/* Test the red-black tree implementation. */
+void test(void) {
+  int size;
+
+  printf("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++) {
+    int repeat;
+
+    printf(" %d", size);
+    for (repeat = 0; repeat < 10; repeat++) {
+      static struct value values[MAX_SIZE];
+      static int order[MAX_SIZE];
+      struct rb_root root;
+      struct value key;
+      int i;
+
+      /* Put values 0...SIZE in VALUES, and their indexes in
+         random order in ORDER.  Nodes must not move while they
+         are in the tree, so we shuffle ORDER, never VALUES. */
+      for (i = 0; i < size; i++) {
+        values[i].value = i;
+        values[i].in_tree = false;
+        order[i] = i;
+      }
+      shuffle(order, size);
+
+      /* Insert them one by one. */
+      rb_init(&root, value_augment);
+      for (i = 0; i < size; i++) {
+        rb_insert(&root, &values[order[i]].node, value_less, NULL);
+        values[order[i]].in_tree = true;
+        verify_tree(&root, values, size);
+      }
+
+      /* Every value can be found, nothing else can. */
+      for (i = 0; i < size; i++) {
+        key.value = i;
+        ASSERT(rb_entry(rb_find(&root, &key.node, value_less, NULL), struct value, node)->value == i);
+      }
+      key.value = size;
+      ASSERT(rb_find(&root, &key.node, value_less, NULL) == NULL);
+      ASSERT(rb_lower_bound(&root, &key.node, value_less, NULL) == NULL);
+
+      /* Erase half of them in random order, verifying as we go,
+         then put them back, then erase everything. */
+      shuffle(order, size);
+      for (i = 0; i < size / 2; i++) {
+        rb_erase(&root, &values[order[i]].node);
+        values[order[i]].in_tree = false;
+        verify_tree(&root, values, size);
+      }
+      for (i = 0; i < size / 2; i++) {
+        rb_insert(&root, &values[order[i]].node, value_less, NULL);
+        values[order[i]].in_tree = true;
+        verify_tree(&root, values, size);
+      }
+      shuffle(order, size);
+      for (i = 0; i < size; i++) {
+        rb_erase(&root, &values[order[i]].node);
+        values[order[i]].in_tree = false;
+        verify_tree(&root, values, size);
+      }
+      ASSERT(rb_empty(&root));
+    }
+  }
+
+  printf(" done\n");
+  printf("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void shuffle(int* array, size_t cnt) {
+  size_t i;
+
+  for (i = 0; i < cnt; i++) {
+    size_t j = i + random_ulong() % (cnt - i);
+    int t = array[j];
+    array[j] = array[i];
+    array[i] = t;
+  }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool value_less(const struct rb_node* a_, const struct rb_node* b_, void* aux UNUSED) {
+  const struct value* a = rb_entry(a_, struct value, node);
+  const struct value* b = rb_entry(b_, struct value, node);
+
+  return a->value < b->value;
+}
+
+/* Recomputes the size of the subtree rooted at NODE. */
+static void value_augment(struct rb_node* node) {
+  struct value* v = rb_entry(node, struct value, node);
+
+  v->size = 1;
+  if (node->left != NULL)
+    v->size += rb_entry(node->left, struct value, node)->size;
+  if (node->right != NULL)
+    v->size += rb_entry(node->right, struct value, node)->size;
+}
+
+/* Verifies the subtree rooted at NODE and returns its size.
+   Stores the number of black nodes on each path to a leaf in
+   *BLACK_HEIGHT. */
+static int verify_subtree(struct rb_node* node, struct rb_node* parent, int* black_height) {
+  int left_height, right_height, size;
+
+  if (node == NULL) {
+    *black_height = 1;
+    return 0;
+  }
+
+  ASSERT(node->parent == parent);
+  if (node->red) {
+    ASSERT(node->left == NULL || !node->left->red);
+    ASSERT(node->right == NULL || !node->right->red);
+  }
+
+  size = 1 + verify_subtree(node->left, node, &left_height) +
+         verify_subtree(node->right, node, &right_height);
+  ASSERT(left_height == right_height);
+  ASSERT(rb_entry(node, struct value, node)->size == size);
+
+  *black_height = left_height + !node->red;
+  return size;
+}
+
+/* Verifies that ROOT is a valid red-black tree holding exactly
+   the values among the SIZE in VALUES that are marked in_tree,
+   in increasing order. */
+static void verify_tree(struct rb_root* root, struct value values[], int size) {
+  struct rb_node* node;
+  int black_height, expected, i, prev;
+
+  ASSERT(root->node == NULL || !root->node->red);
+
+  expected = 0;
+  for (i = 0; i < size; i++)
+    expected += values[i].in_tree;
+  ASSERT(verify_subtree(root->node, NULL, &black_height) == expected);
+
+  /* Forward traversal is sorted and complete. */
+  prev = -1;
+  i = 0;
+  for (node = rb_first(root); node != NULL; node = rb_next(node)) {
+    struct value* v = rb_entry(node, struct value, node);
+    ASSERT(v->in_tree);
+    ASSERT(v->value > prev);
+    prev = v->value;
+    i++;
+  }
+  ASSERT(i == expected);
+
+  /* Backward traversal visits the same nodes. */
+  for (node = rb_last(root); node != NULL; node = rb_prev(node))
+    i--;
+  ASSERT(i == 0);
+}
@@ -0,0 +1,114 @@
+/* Checks the file system buffer cache under eviction.
+
+   Several threads each write their own share of a range of
+   sectors four times larger than the cache, alternating whole
+   sector writes with writes of two halves, and read every sector
+   back through the cache after each pass.  Once the threads are
+   done, the cache is flushed and every sector is read straight
+   from the disk, which must hold the data of the last pass. */
+
+#include <stdint.h>
+#include "tests/userprog/kernel/tests.h"
+#include "devices/block.h"
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define SECTOR_CNT (4 * CACHE_DEFAULT_SLOTS)
+#define PASSES 3
+
+struct worker {
+  block_sector_t first;  /* First sector written by this thread. */
+  size_t cnt;            /* Number of sectors written. */
+  bool ok;               /* Did every sector read back correctly? */
+  struct semaphore done; /* Upped when the thread finishes. */
+};
+
+/* Returns the byte at offset OFS of SECTOR after pass PASS. */
+static uint8_t expected(block_sector_t sector, size_t ofs, int pass) {
+  return sector * 7 + ofs + pass;
+}
+
+/* Fills BUF with the contents of SECTOR after pass PASS. */
+static void fill(uint8_t* buf, block_sector_t sector, int pass) {
+  size_t i;
+
+  for (i = 0; i < BLOCK_SECTOR_SIZE; i++)
+    buf[i] = expected(sector, i, pass);
+}
+
+/* Returns true if BUF holds the contents of SECTOR after PASS. */
+static bool intact(const uint8_t* buf, block_sector_t sector, int pass) {
+  size_t i;
+
+  for (i = 0; i < BLOCK_SECTOR_SIZE; i++)
+    if (buf[i] != expected(sector, i, pass))
+      return false;
+  return true;
+}
+
+static void work(void* w_) {
+  struct worker* w = w_;
+  uint8_t buf[BLOCK_SECTOR_SIZE];
+  int pass;
+  size_t i;
+
+  w->ok = true;
+  for (pass = 0; pass < PASSES; pass++) {
+    for (i = 0; i < w->cnt; i++) {
+      block_sector_t sector = w->first + i;
+
+      fill(buf, sector, pass);
+      if ((i + pass) % 2 == 0)
+        cache_write(sector, buf, 0, BLOCK_SECTOR_SIZE);
+      else {
+        cache_write(sector, buf + BLOCK_SECTOR_SIZE / 2, BLOCK_SECTOR_SIZE / 2,
+                    BLOCK_SECTOR_SIZE / 2);
+        cache_write(sector, buf, 0, BLOCK_SECTOR_SIZE / 2);
+      }
+    }
+    for (i = 0; i < w->cnt; i++) {
+      cache_read(w->first + i, buf, 0, BLOCK_SECTOR_SIZE);
+      if (!intact(buf, w->first + i, pass))
+        w->ok = false;
+    }
+  }
+  sema_up(&w->done);
+}
+
+void test_cache_clock(void) {
+  static struct worker workers[THREAD_CNT];
+  static uint8_t buf[BLOCK_SECTOR_SIZE];
+  block_sector_t start;
+  size_t i;
+
+  if (!free_map_allocate(SECTOR_CNT, &start))
+    fail("could not allocate %d sectors", SECTOR_CNT);
+
+  for (i = 0; i < THREAD_CNT; i++) {
+    struct worker* w = &workers[i];
+
+    w->first = start + i * (SECTOR_CNT / THREAD_CNT);
+    w->cnt = SECTOR_CNT / THREAD_CNT;
+    sema_init(&w->done, 0);
+    thread_create("cache-worker", PRI_DEFAULT, work, w);
+  }
+  for (i = 0; i < THREAD_CNT; i++) {
+    sema_down(&workers[i].done);
+    if (!workers[i].ok)
+      fail("thread %zu read back wrong data through the cache", i);
+  }
+
+  cache_flush();
+  for (i = 0; i < SECTOR_CNT; i++) {
+    block_read(fs_device, start + i, buf);
+    if (!intact(buf, start + i, PASSES - 1))
+      fail("sector %zu of %d is wrong on disk after cache_flush()", i, SECTOR_CNT);
+  }
+
+  free_map_release(start, SECTOR_CNT);
+  pass();
+}
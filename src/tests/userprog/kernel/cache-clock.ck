@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cache-clock) begin
+(cache-clock) PASS
+(cache-clock) end
+EOF
+pass;
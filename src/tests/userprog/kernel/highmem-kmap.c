@@ -0,0 +1,72 @@
+/* Checks that memory above the kernel's linear mapping is put
+   to use.  User frames must come from high memory while it
+   lasts, arrive zeroed when asked, and keep their contents when
+   written through one temporary mapping and read back through
+   another, even with every mapping slot in use at once. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/highmem.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Number of frames to allocate, 8 MB worth. */
+#define FRAME_CNT 2048
+
+/* Number of temporary mapping slots. */
+#define SLOT_CNT (PTSPAN / PGSIZE)
+
+/* Returns the value stored in word I of FRAME. */
+static uint32_t pattern(uintptr_t frame, size_t i) { return frame ^ (i * 0x9e3779b9); }
+
+void test_highmem_kmap(void) {
+  uintptr_t* frames = malloc(FRAME_CNT * sizeof *frames);
+  uint32_t** pages = malloc(SLOT_CNT * sizeof *pages);
+  size_t i, j;
+
+  if (frames == NULL || pages == NULL)
+    fail("malloc failed");
+
+  for (i = 0; i < FRAME_CNT; i++) {
+    frames[i] = palloc_get_frame(PAL_USER | PAL_ZERO);
+    if (frames[i] == 0)
+      fail("frame %zu: allocation failed", i);
+    if (!is_highmem(frames[i]))
+      fail("frame %zu at %#" PRIxPTR " is not in high memory", i, frames[i]);
+  }
+
+  /* Fill the frames, keeping every slot busy at the peak. */
+  for (i = 0; i < FRAME_CNT; i += SLOT_CNT) {
+    for (j = 0; j < SLOT_CNT && i + j < FRAME_CNT; j++) {
+      uint32_t* page = pages[j] = kmap(frames[i + j]);
+      size_t k;
+      for (k = 0; k < PGSIZE / sizeof *page; k++) {
+        if (page[k] != 0)
+          fail("frame %zu: word %zu not zeroed", i + j, k);
+        page[k] = pattern(frames[i + j], k);
+      }
+    }
+    while (j-- > 0)
+      kunmap(pages[j]);
+  }
+
+  /* Read them back one at a time, in reverse. */
+  for (i = FRAME_CNT; i-- > 0;) {
+    uint32_t* page = kmap(frames[i]);
+    size_t k;
+    for (k = 0; k < PGSIZE / sizeof *page; k++)
+      if (page[k] != pattern(frames[i], k))
+        fail("frame %zu: word %zu corrupted", i, k);
+    kunmap(page);
+    palloc_free_frame(frames[i]);
+  }
+
+  free(pages);
+  free(frames);
+  if (palloc_used_cnt(PC_USER) != 0)
+    fail("%zu user pages still in use", palloc_used_cnt(PC_USER));
+  pass();
+}
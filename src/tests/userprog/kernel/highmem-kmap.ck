@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(highmem-kmap) begin
+(highmem-kmap) PASS
+(highmem-kmap) end
+EOF
+pass;
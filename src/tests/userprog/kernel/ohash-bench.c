@@ -0,0 +1,162 @@
+/* Compares the open-addressing table in ohash.h against the
+   chained table in hash.h.
+
+   Both tables are filled with the same keys, then probed with
+   hits and misses, then emptied again, and every result is
+   checked.  Cycle counts per operation are printed for each
+   table size but are informational only. */
+
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/malloc.h"
+
+struct item {
+  struct hash_elem h_elem;
+  struct ohash_elem o_elem;
+  int key;
+};
+
+static inline uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+static unsigned item_hash(const struct hash_elem* e, void* aux UNUSED) {
+  return hash_int(hash_entry(e, struct item, h_elem)->key);
+}
+
+static bool item_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED) {
+  return hash_entry(a, struct item, h_elem)->key < hash_entry(b, struct item, h_elem)->key;
+}
+
+static unsigned item_ohash(const struct ohash_elem* e, void* aux UNUSED) {
+  return ohash_int(ohash_entry(e, struct item, o_elem)->key);
+}
+
+static bool item_equal(const struct ohash_elem* a, const struct ohash_elem* b, void* aux UNUSED) {
+  return ohash_entry(a, struct item, o_elem)->key == ohash_entry(b, struct item, o_elem)->key;
+}
+
+/* Cycles spent in each phase, per operation. */
+struct result {
+  uint32_t insert, hit, miss, delete;
+};
+
+static void bench_hash(struct item* items, int cnt, struct result* r) {
+  struct hash h;
+  struct item key;
+  uint64_t start;
+  int i;
+
+  if (!hash_init(&h, item_hash, item_less, NULL))
+    fail("hash_init failed");
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    if (hash_insert(&h, &items[i].h_elem) != NULL)
+      fail("hash: duplicate key %d", items[i].key);
+  r->insert = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++) {
+    key.key = items[i].key;
+    if (hash_find(&h, &key.h_elem) != &items[i].h_elem)
+      fail("hash: key %d not found", key.key);
+  }
+  r->hit = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++) {
+    key.key = -items[i].key - 1;
+    if (hash_find(&h, &key.h_elem) != NULL)
+      fail("hash: found missing key %d", key.key);
+  }
+  r->miss = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    if (hash_delete(&h, &items[i].h_elem) != &items[i].h_elem)
+      fail("hash: delete of %d failed", items[i].key);
+  r->delete = (rdtsc() - start) / cnt;
+
+  if (!hash_empty(&h))
+    fail("hash: not empty after deletes");
+  hash_destroy(&h, NULL);
+}
+
+static void bench_ohash(struct item* items, int cnt, struct result* r) {
+  struct ohash h;
+  struct item key;
+  uint64_t start;
+  int i;
+
+  ohash_init(&h, item_ohash, item_equal, NULL);
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    if (ohash_insert(&h, &items[i].o_elem) != NULL)
+      fail("ohash: insert of %d failed", items[i].key);
+  r->insert = (rdtsc() - start) / cnt;
+
+  if (ohash_size(&h) != (size_t)cnt)
+    fail("ohash: size is %zu, expected %d", ohash_size(&h), cnt);
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++) {
+    key.key = items[i].key;
+    if (ohash_find(&h, &key.o_elem) != &items[i].o_elem)
+      fail("ohash: key %d not found", key.key);
+  }
+  r->hit = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++) {
+    key.key = -items[i].key - 1;
+    if (ohash_find(&h, &key.o_elem) != NULL)
+      fail("ohash: found missing key %d", key.key);
+  }
+  r->miss = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    if (ohash_delete(&h, &items[i].o_elem) != &items[i].o_elem)
+      fail("ohash: delete of %d failed", items[i].key);
+  r->delete = (rdtsc() - start) / cnt;
+
+  if (!ohash_empty(&h))
+    fail("ohash: not empty after deletes");
+  ohash_destroy(&h, NULL);
+}
+
+void test_ohash_bench(void) {
+  static const int sizes[] = {16, 256, 4096};
+  struct result rh, ro;
+  size_t s;
+  int i;
+
+  random_init(162);
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++) {
+    int cnt = sizes[s];
+    struct item* items = malloc(sizeof *items * cnt);
+    if (items == NULL)
+      fail("out of memory");
+
+    /* Distinct non-negative keys with random high bits. */
+    for (i = 0; i < cnt; i++)
+      items[i].key = (int)((random_ulong() & 0x7fff) << 16 | i) & 0x7fffffff;
+
+    bench_hash(items, cnt, &rh);
+    bench_ohash(items, cnt, &ro);
+    free(items);
+
+    printf("ohash-bench: %5d elems  insert %4u/%4u  hit %4u/%4u  miss %4u/%4u  "
+           "delete %4u/%4u cycles (hash/ohash)\n",
+           cnt, rh.insert, ro.insert, rh.hit, ro.hit, rh.miss, ro.miss, rh.delete, ro.delete);
+  }
+  msg("tables agree on %d inserts, lookups and deletes", 2 * (16 + 256 + 4096));
+  pass();
+}
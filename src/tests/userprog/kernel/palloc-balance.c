@@ -0,0 +1,91 @@
+/* Checks that kernel and user pages share one pool.
+
+   The kernel takes as many pages as it can, which must be more
+   than the half of memory that the old fixed split allowed, and
+   along the way the allocator must call a reclaim hook to empty
+   a small cache.  User pages must then still find their
+   reservation, and once the kernel gives half of its pages back,
+   user pages must be able to grow into them. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+
+/* Pages in the reclaimable cache. */
+#define CACHE_PAGES 16
+
+static void* cache;      /* Cached pages, linked through their first word. */
+static size_t cache_cnt; /* Number of cached pages. */
+
+/* Frees up to PAGE_CNT cached pages. */
+static size_t shrink_cache(size_t page_cnt) {
+  size_t freed = 0;
+
+  while (cache != NULL && freed < page_cnt) {
+    void* page = cache;
+    cache = *(void**)page;
+    palloc_free_page(page);
+    cache_cnt--;
+    freed++;
+  }
+  return freed;
+}
+
+/* Allocates pages with FLAGS until that fails, pushing them on
+   *LIST.  Returns the number of pages allocated. */
+static size_t grab(enum palloc_flags flags, void** list) {
+  size_t cnt = 0;
+  void* page;
+
+  while ((page = palloc_get_page(flags)) != NULL) {
+    *(void**)page = *list;
+    *list = page;
+    cnt++;
+  }
+  return cnt;
+}
+
+/* Frees up to CNT pages from *LIST. */
+static void release(void** list, size_t cnt) {
+  while (*list != NULL && cnt-- > 0) {
+    void* page = *list;
+    *list = *(void**)page;
+    palloc_free_page(page);
+  }
+}
+
+void test_palloc_balance(void) {
+  void* kernel_pages = NULL;
+  void* user_pages = NULL;
+  size_t kernel_cnt, user_cnt, more_cnt;
+
+  palloc_register_reclaim(shrink_cache);
+  for (cache_cnt = 0; cache_cnt < CACHE_PAGES; cache_cnt++) {
+    void* page = palloc_get_page(PAL_ASSERT);
+    *(void**)page = cache;
+    cache = page;
+  }
+
+  kernel_cnt = grab(0, &kernel_pages);
+  if (kernel_cnt + CACHE_PAGES <= init_ram_pages / 2)
+    fail("kernel got only %zu of %" PRIu32 " pages", kernel_cnt, init_ram_pages);
+  if (cache_cnt != 0)
+    fail("reclaim hook left %zu pages cached", cache_cnt);
+
+  user_cnt = grab(PAL_USER, &user_pages);
+  if (user_cnt == 0 || user_cnt < (kernel_cnt + user_cnt) / 8)
+    fail("user got only %zu pages after the kernel took %zu", user_cnt, kernel_cnt);
+
+  release(&kernel_pages, kernel_cnt / 2);
+  more_cnt = grab(PAL_USER, &user_pages);
+  if (more_cnt < kernel_cnt / 4)
+    fail("user got only %zu of the %zu pages the kernel freed", more_cnt, kernel_cnt / 2);
+
+  release(&kernel_pages, SIZE_MAX);
+  release(&user_pages, SIZE_MAX);
+  if (palloc_used_cnt(PC_USER) != 0)
+    fail("%zu user pages still in use", palloc_used_cnt(PC_USER));
+  pass();
+}
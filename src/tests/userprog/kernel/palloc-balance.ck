@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-balance) begin
+(palloc-balance) PASS
+(palloc-balance) end
+EOF
+pass;
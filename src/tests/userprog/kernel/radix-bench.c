@@ -0,0 +1,157 @@
+/* Compares the radix tree in radix.h against the linear list
+   scan that the per-process lock and semaphore tables used to
+   do.
+
+   Keys are consecutive addresses, as for an array of lock_t in
+   user memory, inserted in random order.  Each table size is
+   probed with the same hits and misses in both structures, and
+   every result is checked, including an in-order gang lookup of
+   the whole tree.  Cycle counts per operation are printed for
+   each size but are informational only. */
+
+#include <list.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/malloc.h"
+
+/* Number of lookups timed at each size.  A list scan at the
+   largest size is slow enough that probing every key would
+   take minutes. */
+#define PROBES 256
+
+/* Base of the key range, a typical user data address. */
+#define KEY_BASE 0x0804c000ul
+
+struct item {
+  struct list_elem elem;
+  unsigned long key;
+};
+
+/* Cycles spent in each phase, per operation. */
+struct result {
+  uint32_t insert, hit, miss;
+};
+
+static inline uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Returns the item in LIST with KEY, or a null pointer, the way
+   the old lock table lookup did. */
+static struct item* list_find(struct list* list, unsigned long key) {
+  struct list_elem* e;
+
+  for (e = list_begin(list); e != list_end(list); e = list_next(e)) {
+    struct item* it = list_entry(e, struct item, elem);
+    if (it->key == key)
+      return it;
+  }
+  return NULL;
+}
+
+static void bench_list(struct item* items, int cnt, const int* probes, struct result* r) {
+  struct list list;
+  uint64_t start;
+  int i;
+
+  list_init(&list);
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    list_push_front(&list, &items[i].elem);
+  r->insert = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < PROBES; i++)
+    if (list_find(&list, items[probes[i]].key) != &items[probes[i]])
+      fail("list: key %#lx not found", items[probes[i]].key);
+  r->hit = (rdtsc() - start) / PROBES;
+
+  start = rdtsc();
+  for (i = 0; i < PROBES; i++)
+    if (list_find(&list, items[probes[i]].key + cnt) != NULL)
+      fail("list: found missing key %#lx", items[probes[i]].key + cnt);
+  r->miss = (rdtsc() - start) / PROBES;
+}
+
+static void bench_radix(struct item* items, int cnt, const int* probes, struct result* r) {
+  struct radix_tree tree;
+  unsigned long index;
+  uint64_t start;
+  void* item;
+  int i;
+
+  radix_init(&tree);
+
+  start = rdtsc();
+  for (i = 0; i < cnt; i++)
+    if (!radix_insert(&tree, items[i].key, &items[i]))
+      fail("radix: insert of %#lx failed", items[i].key);
+  r->insert = (rdtsc() - start) / cnt;
+
+  start = rdtsc();
+  for (i = 0; i < PROBES; i++)
+    if (radix_lookup(&tree, items[probes[i]].key) != &items[probes[i]])
+      fail("radix: key %#lx not found", items[probes[i]].key);
+  r->hit = (rdtsc() - start) / PROBES;
+
+  start = rdtsc();
+  for (i = 0; i < PROBES; i++)
+    if (radix_lookup(&tree, items[probes[i]].key + cnt) != NULL)
+      fail("radix: found missing key %#lx", items[probes[i]].key + cnt);
+  r->miss = (rdtsc() - start) / PROBES;
+
+  /* Walking the tree in order yields every key exactly once. */
+  for (i = 0; i < cnt; i++) {
+    if (radix_gang_lookup(&tree, KEY_BASE + i, 1, &item, &index) != 1 ||
+        index != KEY_BASE + i)
+      fail("radix: gang lookup of %#lx failed", KEY_BASE + i);
+  }
+
+  if (radix_size(&tree) != (size_t)cnt)
+    fail("radix: size is %zu, expected %d", radix_size(&tree), cnt);
+  radix_destroy(&tree, NULL, NULL);
+}
+
+void test_radix_bench(void) {
+  static const int sizes[] = {10, 1000, 100000};
+  static int probes[PROBES];
+  struct result rl, rr;
+  size_t s;
+  int i;
+
+  random_init(162);
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++) {
+    int cnt = sizes[s];
+    struct item* items = malloc(sizeof *items * cnt);
+    if (items == NULL)
+      fail("out of memory");
+
+    /* Consecutive keys in random order. */
+    for (i = 0; i < cnt; i++)
+      items[i].key = KEY_BASE + i;
+    for (i = 0; i < cnt; i++) {
+      int j = i + random_ulong() % (cnt - i);
+      unsigned long t = items[i].key;
+      items[i].key = items[j].key;
+      items[j].key = t;
+    }
+    for (i = 0; i < PROBES; i++)
+      probes[i] = random_ulong() % cnt;
+
+    bench_list(items, cnt, probes, &rl);
+    bench_radix(items, cnt, probes, &rr);
+    free(items);
+
+    printf("radix-bench: %6d entries  insert %4u/%4u  hit %7u/%4u  miss %7u/%4u "
+           "cycles (list/radix)\n",
+           cnt, rl.insert, rr.insert, rl.hit, rr.hit, rl.miss, rr.miss);
+  }
+  radix_print_stats();
+  msg("list and radix tree agree at %d, %d and %d entries", sizes[0], sizes[1], sizes[2]);
+  pass();
+}
@@ -0,0 +1,82 @@
+/* Checks file reads with read-ahead.
+
+   Writes a file larger than the buffer cache, then reads it back
+   sequentially in chunks that straddle sector boundaries, which
+   keeps the read-ahead thread busy ahead of the reader, and with
+   seeks, which cancel read-ahead.  Every byte must read back
+   correctly.  Finally closes and removes the file in the middle
+   of a sequential read, which must cancel read-ahead cleanly. */
+
+#include <stdint.h>
+#include "tests/userprog/kernel/tests.h"
+#include "devices/block.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+
+#define FILE_NAME "readahead"
+#define SIZE (128 * BLOCK_SECTOR_SIZE)
+#define CHUNK 700
+
+/* Returns the byte at offset OFS of the file. */
+static uint8_t expected(off_t ofs) { return ofs * 13 + ofs / BLOCK_SECTOR_SIZE; }
+
+/* Reads SIZE bytes from FILE at its position and checks them. */
+static void check_read(struct file* file, off_t size) {
+  static uint8_t buf[CHUNK];
+  off_t ofs = file_tell(file);
+  off_t i;
+
+  if (file_read(file, buf, size) != size)
+    fail("short read of %d bytes at offset %d", size, ofs);
+  for (i = 0; i < size; i++)
+    if (buf[i] != expected(ofs + i))
+      fail("byte %d is %d instead of %d", ofs + i, buf[i], expected(ofs + i));
+}
+
+/* Returns the lesser of SIZE and the bytes left in FILE. */
+static off_t left(struct file* file, off_t size) {
+  off_t rest = SIZE - file_tell(file);
+  return size < rest ? size : rest;
+}
+
+void test_readahead_seq(void) {
+  static uint8_t buf[CHUNK];
+  struct file* file;
+  off_t ofs, i;
+
+  if (!filesys_create(FILE_NAME, SIZE) || (file = filesys_open(FILE_NAME)) == NULL)
+    fail("could not create \"%s\"", FILE_NAME);
+  for (ofs = 0; ofs < SIZE; ofs += CHUNK) {
+    off_t size = left(file, CHUNK);
+
+    for (i = 0; i < size; i++)
+      buf[i] = expected(ofs + i);
+    if (file_write(file, buf, size) != size)
+      fail("short write at offset %d", ofs);
+  }
+  file_close(file);
+
+  /* Sequential reads. */
+  file = filesys_open(FILE_NAME);
+  while (file_tell(file) < SIZE)
+    check_read(file, left(file, CHUNK));
+  file_close(file);
+
+  /* Streaks broken by seeks. */
+  file = filesys_open(FILE_NAME);
+  for (ofs = 0; ofs < SIZE; ofs += SIZE / 4 + 3 * CHUNK) {
+    file_seek(file, ofs);
+    for (i = 0; i < 8 && file_tell(file) < SIZE; i++)
+      check_read(file, left(file, CHUNK));
+  }
+  file_close(file);
+
+  /* Close and remove in the middle of read-ahead. */
+  file = filesys_open(FILE_NAME);
+  for (i = 0; i < 4; i++)
+    check_read(file, CHUNK);
+  file_close(file);
+  if (!filesys_remove(FILE_NAME))
+    fail("could not remove \"%s\"", FILE_NAME);
+  pass();
+}
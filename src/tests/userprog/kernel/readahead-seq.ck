@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readahead-seq) begin
+(readahead-seq) PASS
+(readahead-seq) end
+EOF
+pass;
@@ -6,6 +6,14 @@
 static const struct test userprog_tests[] = {
     {"fp-kasm", test_fp_kasm},
     {"fp-kinit", test_fp_kinit},
+    {"tlb-global", test_tlb_global},
+    {"ohash-bench", test_ohash_bench},
+    {"radix-bench", test_radix_bench},
+    {"vmalloc-frag", test_vmalloc_frag},
+    {"palloc-balance", test_palloc_balance},
+    {"highmem-kmap", test_highmem_kmap},
+    {"cache-clock", test_cache_clock},
+    {"readahead-seq", test_readahead_seq},
 };
 
 /* Runs the userprog test named NAME. */
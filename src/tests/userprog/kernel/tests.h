@@ -7,5 +7,13 @@ void run_userprog_test(const char*);
 
 extern test_func test_fp_kasm;
 extern test_func test_fp_kinit;
+extern test_func test_tlb_global;
+extern test_func test_ohash_bench;
+extern test_func test_radix_bench;
+extern test_func test_vmalloc_frag;
+extern test_func test_palloc_balance;
+extern test_func test_highmem_kmap;
+extern test_func test_cache_clock;
+extern test_func test_readahead_seq;
 
 #endif /* tests/userprog/kernel/tests.h */
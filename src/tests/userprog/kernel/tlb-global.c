@@ -0,0 +1,99 @@
+/* Context-switch microbenchmark for global kernel pages.
+
+   Two kernel threads ping-pong through a pair of semaphores.
+   Each hand-off reloads CR3, as a switch between two processes
+   would, and then walks a working set of kernel pages the way
+   a syscall-heavy workload touches kernel data.  The run is
+   timed once with CR4.PGE cleared, so every reload flushes the
+   kernel's TLB entries, and once with it set, so that they
+   survive.  The cycle counts are informational only. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+#define ROUNDS 2000    /* Hand-offs per measurement. */
+#define WORKING_SET 64 /* Kernel pages touched per hand-off. */
+
+static struct semaphore ping, pong;
+static uint8_t* pages[WORKING_SET];
+static volatile uint32_t sink;
+
+static inline uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Simulates the kernel side of a switch to another process. */
+static void switch_and_touch(void) {
+  int i;
+
+  asm volatile("movl %%cr3, %%eax; movl %%eax, %%cr3" : : : "eax", "memory");
+  for (i = 0; i < WORKING_SET; i++)
+    sink += pages[i][(i * 64) % PGSIZE];
+}
+
+static void partner(void* aux UNUSED) {
+  int i;
+
+  for (i = 0; i < ROUNDS; i++) {
+    sema_down(&ping);
+    switch_and_touch();
+    sema_up(&pong);
+  }
+}
+
+/* Returns the average number of cycles per round trip. */
+static uint32_t measure(void) {
+  uint64_t start;
+  int i;
+
+  sema_init(&ping, 0);
+  sema_init(&pong, 0);
+  thread_create("tlb-partner", PRI_DEFAULT, partner, NULL);
+
+  start = rdtsc();
+  for (i = 0; i < ROUNDS; i++) {
+    switch_and_touch();
+    sema_up(&ping);
+    sema_down(&pong);
+  }
+  return (rdtsc() - start) / ROUNDS;
+}
+
+void test_tlb_global(void) {
+  uint32_t local_cycles, global_cycles;
+  bool old;
+  int i;
+
+  for (i = 0; i < WORKING_SET; i++) {
+    pages[i] = palloc_get_page(PAL_ZERO);
+    if (pages[i] == NULL)
+      fail("out of kernel pages");
+  }
+
+  if (!cpu_has_pge) {
+    msg("CPU lacks global pages, nothing to compare");
+    local_cycles = global_cycles = measure();
+  } else {
+    old = tlb_set_global(false);
+    local_cycles = measure();
+    tlb_set_global(true);
+    global_cycles = measure();
+    tlb_set_global(old);
+  }
+
+  printf("tlb-global: large pages %s, %u cycles/round trip without global pages, "
+         "%u with\n",
+         cpu_has_pse ? "on" : "off", local_cycles, global_cycles);
+
+  for (i = 0; i < WORKING_SET; i++)
+    palloc_free_page(pages[i]);
+  pass();
+}
@@ -0,0 +1,82 @@
+/* Fragments the kernel pool so that no two free pages are
+   adjacent, then checks that large malloc() blocks still
+   succeed by way of vmalloc(), that their contents survive, and
+   that freeing and reallocating them many times works through
+   the lazy TLB purges. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/userprog/kernel/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+
+/* Size of each large block, too big for one page. */
+#define BLOCK_SIZE (16 * PGSIZE)
+
+/* Number of blocks live at once. */
+#define BLOCK_CNT 4
+
+/* Allocation rounds. */
+#define ROUNDS 200
+
+void test_vmalloc_frag(void) {
+  void* held = NULL;  /* Pages we keep, linked through their first word. */
+  void* freed = NULL; /* Pages we give back at the end. */
+  uint8_t* blocks[BLOCK_CNT];
+  size_t page_cnt = 0;
+  void* page;
+  int round, i;
+
+  /* Take every kernel page, then give back every other one, so
+     that the pool has no two adjacent free pages left.  Allocation
+     order is by address, so alternate pages are never adjacent.
+     User pages come from the same pool, so take all of those too,
+     or the kernel could find a run of them. */
+  while ((page = palloc_get_page(0)) != NULL) {
+    if (page_cnt++ % 2 == 0) {
+      *(void**)page = held;
+      held = page;
+    } else {
+      *(void**)page = freed;
+      freed = page;
+    }
+  }
+  while ((page = palloc_get_page(PAL_USER)) != NULL) {
+    *(void**)page = held;
+    held = page;
+  }
+  while (freed != NULL) {
+    page = freed;
+    freed = *(void**)page;
+    palloc_free_page(page);
+  }
+  if (palloc_get_multiple(0, 2) != NULL)
+    fail("kernel pool is not fragmented");
+
+  for (round = 0; round < ROUNDS; round++) {
+    for (i = 0; i < BLOCK_CNT; i++) {
+      blocks[i] = malloc(BLOCK_SIZE);
+      if (blocks[i] == NULL)
+        fail("round %d: malloc(%d) failed", round, BLOCK_SIZE);
+      if (!is_vmalloc_addr(blocks[i]))
+        fail("round %d: block is not from vmalloc", round);
+      memset(blocks[i], round + i, BLOCK_SIZE);
+    }
+    for (i = 0; i < BLOCK_CNT; i++) {
+      size_t ofs;
+      for (ofs = 0; ofs < BLOCK_SIZE; ofs += 509)
+        if (blocks[i][ofs] != (uint8_t)(round + i))
+          fail("round %d: block %d corrupted at offset %zu", round, i, ofs);
+      free(blocks[i]);
+    }
+  }
+
+  while (held != NULL) {
+    page = held;
+    held = *(void**)page;
+    palloc_free_page(page);
+  }
+  pass();
+}
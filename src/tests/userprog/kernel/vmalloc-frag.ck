@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vmalloc-frag) begin
+(vmalloc-frag) PASS
+(vmalloc-frag) end
+EOF
+pass;
@@ -0,0 +1,4 @@
+/* Child process of bench-fork: exits at once, so that exec()
+   costs little more than loading a process. */
+
+int main(void) { return 0; }
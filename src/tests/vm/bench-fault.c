@@ -0,0 +1,43 @@
+/* Measures the latency of the first touch of a page for each
+   way a page can be brought in: a zero-filled page, a page read
+   from the executable, and a page read back from swap. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define ZERO_PAGES 128
+#define FILE_PAGES 64
+#define SWAP_PAGES 64
+
+static char zeros[ZERO_PAGES * BENCH_PAGE];
+static const char text[FILE_PAGES * BENCH_PAGE] = {'t', 'e', 'x', 't'};
+static char ws[BENCH_WS_PAGES * BENCH_PAGE];
+
+void test_main(void) {
+  struct bench b;
+  volatile char sink;
+  size_t i;
+
+  bench_start(&b, "fault-zero");
+  for (i = 0; i < ZERO_PAGES; i++)
+    zeros[i * BENCH_PAGE] = i;
+  bench_stop(&b, ZERO_PAGES);
+
+  bench_start(&b, "fault-file");
+  for (i = 0; i < FILE_PAGES; i++)
+    sink = text[i * BENCH_PAGE];
+  bench_stop(&b, FILE_PAGES);
+
+  /* Dirty a working set larger than memory, so that its first
+     pages have been written to swap by the time the loop ends. */
+  for (i = 0; i < BENCH_WS_PAGES; i++)
+    ws[i * BENCH_PAGE] = i;
+  bench_start(&b, "fault-swap");
+  for (i = 0; i < SWAP_PAGES; i++)
+    sink = ws[i * BENCH_PAGE];
+  bench_stop(&b, SWAP_PAGES);
+
+  (void)sink;
+}
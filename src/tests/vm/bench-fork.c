@@ -0,0 +1,41 @@
+/* Measures the cost of creating a process: a fork() whose child
+   exits at once, and an exec() of a program that does nothing,
+   each followed by wait(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define ROUNDS 8
+#define DATA_PAGES 64
+
+static char data[DATA_PAGES * BENCH_PAGE];
+
+void test_main(void) {
+  struct bench b;
+  pid_t pid;
+  size_t i;
+
+  /* Give the parent some resident memory for fork() to copy. */
+  for (i = 0; i < DATA_PAGES; i++)
+    data[i * BENCH_PAGE] = i;
+
+  bench_start(&b, "fork");
+  for (i = 0; i < ROUNDS; i++) {
+    pid = fork();
+    if (pid == 0)
+      exit(0);
+    if (pid < 0 || wait(pid) != 0)
+      fail("fork round %zu failed", i);
+  }
+  bench_stop(&b, ROUNDS);
+
+  bench_start(&b, "exec");
+  for (i = 0; i < ROUNDS; i++) {
+    pid = exec("bench-child");
+    if (pid < 0 || wait(pid) != 0)
+      fail("exec round %zu failed", i);
+  }
+  bench_stop(&b, ROUNDS);
+}
@@ -0,0 +1,60 @@
+/* Creates a file and sums its contents twice, once through
+   read() into a buffer and once through a memory mapping, and
+   reports the cost per page of each. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define FILE_PAGES 128
+#define ACTUAL ((void*)0x10000000)
+
+static char buf[BENCH_PAGE];
+
+/* Returns the sum of the CNT words at P. */
+static unsigned sum(const unsigned* p, size_t cnt) {
+  unsigned s = 0;
+
+  while (cnt-- > 0)
+    s += *p++;
+  return s;
+}
+
+void test_main(void) {
+  struct bench b;
+  unsigned read_sum, mmap_sum;
+  mapid_t map;
+  size_t i;
+  int fd;
+
+  CHECK(create("bench.dat", 0), "create \"bench.dat\"");
+  CHECK((fd = open("bench.dat")) > 1, "open \"bench.dat\"");
+  for (i = 0; i < FILE_PAGES; i++) {
+    memset(buf, i, sizeof buf);
+    if (write(fd, buf, sizeof buf) != sizeof buf)
+      fail("write \"bench.dat\" failed");
+  }
+  close(fd);
+
+  CHECK((fd = open("bench.dat")) > 1, "open \"bench.dat\"");
+  read_sum = 0;
+  bench_start(&b, "read");
+  for (i = 0; i < FILE_PAGES; i++) {
+    if (read(fd, buf, sizeof buf) != sizeof buf)
+      fail("read \"bench.dat\" failed");
+    read_sum += sum((const unsigned*)buf, sizeof buf / sizeof(unsigned));
+  }
+  bench_stop(&b, FILE_PAGES);
+
+  CHECK((map = mmap(fd, ACTUAL)) != MAP_FAILED, "mmap \"bench.dat\"");
+  bench_start(&b, "mmap");
+  mmap_sum = sum(ACTUAL, FILE_PAGES * BENCH_PAGE / sizeof(unsigned));
+  bench_stop(&b, FILE_PAGES);
+  munmap(map);
+  close(fd);
+
+  if (read_sum != mmap_sum)
+    fail("read() and mmap() sums differ: %u vs. %u", read_sum, mmap_sum);
+}
@@ -0,0 +1,32 @@
+/* Scans a working set larger than memory, first in order and
+   then in random order, touching one byte per page, and reports
+   the cost per page access under eviction. */
+
+#include <random.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define PASSES 2
+#define ACCESSES (PASSES * BENCH_WS_PAGES)
+
+static char ws[BENCH_WS_PAGES * BENCH_PAGE];
+
+void test_main(void) {
+  struct bench b;
+  size_t i;
+
+  for (i = 0; i < BENCH_WS_PAGES; i++)
+    ws[i * BENCH_PAGE] = i;
+
+  bench_start(&b, "scan-sequential");
+  for (i = 0; i < ACCESSES; i++)
+    ws[i % BENCH_WS_PAGES * BENCH_PAGE]++;
+  bench_stop(&b, ACCESSES);
+
+  random_init(0);
+  bench_start(&b, "scan-random");
+  for (i = 0; i < ACCESSES; i++)
+    ws[random_ulong() % BENCH_WS_PAGES * BENCH_PAGE]++;
+  bench_stop(&b, ACCESSES);
+}
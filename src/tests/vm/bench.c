@@ -0,0 +1,39 @@
+/* Helpers shared by the VM benchmarks.  A benchmark brackets the
+   code it measures with bench_start() and bench_stop(), which
+   prints a single "bench:" line giving the cycles spent per
+   operation together with the page faults, evictions and disk
+   sectors read and written meanwhile.  "make bench" collects
+   these lines into a results file. */
+
+#include "tests/vm/bench.h"
+#include "tests/lib.h"
+
+static inline uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Starts measuring B, which will be reported as NAME. */
+void bench_start(struct bench* b, const char* name) {
+  b->name = name;
+  if (!vm_stat(&b->stat))
+    fail("vm_stat failed");
+  b->start = rdtsc();
+}
+
+/* Stops measuring B, which performed OPS operations, and reports
+   the cost per operation. */
+void bench_stop(struct bench* b, unsigned ops) {
+  uint64_t cycles = rdtsc() - b->start;
+  struct vm_stat now;
+
+  if (!vm_stat(&now))
+    fail("vm_stat failed");
+  msg("bench: %s ops=%u cycles/op=%llu faults=%llu evictions=%llu "
+      "fs_reads=%llu fs_writes=%llu swap_reads=%llu swap_writes=%llu",
+      b->name, ops, cycles / (ops > 0 ? ops : 1), now.page_faults - b->stat.page_faults,
+      now.evictions - b->stat.evictions, now.fs_reads - b->stat.fs_reads,
+      now.fs_writes - b->stat.fs_writes, now.swap_reads - b->stat.swap_reads,
+      now.swap_writes - b->stat.swap_writes);
+}
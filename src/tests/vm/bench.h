@@ -0,0 +1,26 @@
+#ifndef TESTS_VM_BENCH_H
+#define TESTS_VM_BENCH_H
+
+#include <stdint.h>
+#include <syscall.h>
+
+/* Size of a page, in bytes. */
+#define BENCH_PAGE 4096
+
+/* Pages in a working set that does not fit in the user pool of
+   the default 4 MB machine but does fit in its 4 MB swap
+   device. */
+#define BENCH_WS_PAGES 640
+
+/* One measurement: the time stamp counter and the system's
+   paging statistics at the start of the measured code. */
+struct bench {
+  const char* name;
+  uint64_t start;
+  struct vm_stat stat;
+};
+
+void bench_start(struct bench*, const char* name);
+void bench_stop(struct bench*, unsigned ops);
+
+#endif /* tests/vm/bench.h */
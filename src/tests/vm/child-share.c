@@ -0,0 +1,30 @@
+/* Child process of page-share.
+   Checks that its initialized data starts out with the contents
+   of the executable, overwrites all of it with its own ID, and
+   then checks repeatedly that no sibling running the same
+   program changed it. */
+
+#include <string.h>
+#include "tests/lib.h"
+
+#define SIZE (4 * 4096)
+static char data[SIZE] = {'s', 'h', 'a', 'r', 'e'};
+
+int main(int argc, char* argv[]) {
+  char id = argv[argc - 1][0];
+  int round;
+  size_t i;
+
+  test_name = "child-share";
+
+  if (memcmp(data, "share", 5) || data[SIZE - 1] != 0)
+    fail("initialized data is wrong");
+
+  memset(data, id, SIZE);
+  for (round = 0; round < 64; round++)
+    for (i = 0; i < SIZE; i++)
+      if (data[i] != id)
+        fail("byte %zu changed to '%c' in child '%c'", i, data[i], id);
+
+  return id;
+}
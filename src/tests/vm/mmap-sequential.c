@@ -0,0 +1,51 @@
+/* Maps a multi-page file with MAP_SEQUENTIAL, checks its
+   contents while walking through it in order, modifies every
+   page and verifies after munmap that the changes reached the
+   file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 24
+#define SIZE (PAGES * 4096)
+
+static char buf[4096];
+
+void test_main(void) {
+  char* actual = (char*)0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i, j;
+
+  CHECK(create("seq.dat", SIZE), "create \"seq.dat\"");
+  CHECK((handle = open("seq.dat")) > 1, "open \"seq.dat\"");
+  for (i = 0; i < PAGES; i++) {
+    memset(buf, 'a' + i, sizeof buf);
+    if (write(handle, buf, sizeof buf) != sizeof buf)
+      fail("write of page %zu failed", i);
+  }
+
+  CHECK((map = mmap_flags(handle, actual, MAP_SEQUENTIAL)) != MAP_FAILED, "mmap \"seq.dat\"");
+  for (i = 0; i < PAGES; i++)
+    for (j = 0; j < 4096; j++)
+      if (actual[i * 4096 + j] != (char)('a' + i))
+        fail("byte %zu of page %zu has value %02hhx", j, i, actual[i * 4096 + j]);
+  msg("read back %d pages", PAGES);
+
+  for (i = 0; i < PAGES; i++)
+    actual[i * 4096 + i] = 'X';
+  munmap(map);
+
+  seek(handle, 0);
+  for (i = 0; i < PAGES; i++) {
+    if (read(handle, buf, sizeof buf) != sizeof buf)
+      fail("read of page %zu failed", i);
+    for (j = 0; j < 4096; j++)
+      if (buf[j] != (j == i ? 'X' : (char)('a' + i)))
+        fail("byte %zu of page %zu was not written back", j, i);
+  }
+  msg("write-back verified");
+  close(handle);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-sequential) begin
+(mmap-sequential) create "seq.dat"
+(mmap-sequential) open "seq.dat"
+(mmap-sequential) mmap "seq.dat"
+(mmap-sequential) read back 24 pages
+(mmap-sequential) write-back verified
+(mmap-sequential) end
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Streams through a plain mapping of a multi-page file, first
+   in order, then in a random order, then in order again, so that
+   the kernel's read-ahead window has to grow, collapse and grow
+   back.  Finally exits while read-ahead of a second mapping may
+   still be pending. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 96
+#define SIZE (PAGES * 4096)
+
+static char buf[4096];
+
+static void check_page(const char* actual, size_t i) {
+  size_t j;
+
+  for (j = 0; j < 4096; j++)
+    if (actual[i * 4096 + j] != (char)(i * 7 + j % 13))
+      fail("byte %zu of page %zu has value %02hhx", j, i, actual[i * 4096 + j]);
+}
+
+void test_main(void) {
+  char* actual = (char*)0x10000000;
+  char* second = (char*)0x20000000;
+  struct arc4 arc4;
+  int handle;
+  mapid_t map;
+  size_t i, j;
+
+  CHECK(create("stream.dat", SIZE), "create \"stream.dat\"");
+  CHECK((handle = open("stream.dat")) > 1, "open \"stream.dat\"");
+  for (i = 0; i < PAGES; i++) {
+    for (j = 0; j < sizeof buf; j++)
+      buf[j] = i * 7 + j % 13;
+    if (write(handle, buf, sizeof buf) != sizeof buf)
+      fail("write of page %zu failed", i);
+  }
+
+  CHECK((map = mmap(handle, actual)) != MAP_FAILED, "mmap \"stream.dat\"");
+  for (i = 0; i < PAGES; i++)
+    check_page(actual, i);
+  msg("sequential pass");
+  munmap(map);
+
+  CHECK((map = mmap(handle, actual)) != MAP_FAILED, "mmap \"stream.dat\" again");
+  arc4_init(&arc4, "mmap-stream", 11);
+  for (i = 0; i < PAGES; i++) {
+    unsigned char r;
+
+    arc4_crypt(&arc4, &r, 1);
+    check_page(actual, r % PAGES);
+  }
+  msg("random pass");
+  for (i = 0; i < PAGES; i++)
+    check_page(actual, i);
+  msg("sequential pass after random");
+
+  CHECK(mmap(handle, second) != MAP_FAILED, "mmap \"stream.dat\" a third time");
+  for (i = 0; i < 8; i++)
+    check_page(second, i);
+  msg("exit with read-ahead pending");
+}
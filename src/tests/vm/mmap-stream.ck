@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-stream) begin
+(mmap-stream) create "stream.dat"
+(mmap-stream) open "stream.dat"
+(mmap-stream) mmap "stream.dat"
+(mmap-stream) sequential pass
+(mmap-stream) mmap "stream.dat" again
+(mmap-stream) random pass
+(mmap-stream) sequential pass after random
+(mmap-stream) mmap "stream.dat" a third time
+(mmap-stream) exit with read-ahead pending
+(mmap-stream) end
+EOF
+pass;
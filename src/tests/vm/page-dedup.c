@@ -0,0 +1,85 @@
+/* Fills a buffer with a handful of distinct page patterns, some
+   of them all zeros, in both a parent and its forked child, and
+   then keeps reading it while the merge thread (enabled with
+   -merge) combines the identical pages.  Afterward every page
+   must still hold its pattern, and writing one page of each
+   pattern must leave the other copies alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 128
+#define PATTERNS 4
+#define ROUNDS 200
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/* Byte of page PAGE at offset OFS.  Pattern 0 is all zeros. */
+static char expected(size_t page, size_t ofs) {
+  size_t pattern = page % PATTERNS;
+  return pattern == 0 ? 0 : (char)(pattern * 37 + ofs % 13);
+}
+
+static void fill(void) {
+  size_t page, ofs;
+
+  for (page = 0; page < PAGE_CNT; page++) {
+    /* Write the zero pages too, so that they are no longer the
+       shared zero page but anonymous pages of their own. */
+    buf[page][0] = 1;
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      buf[page][ofs] = expected(page, ofs);
+  }
+}
+
+/* Returns the first page that does not hold its pattern, except
+   for the first byte of pages below MODIFIED, which must be the
+   page number instead.  Returns PAGE_CNT if all pages match. */
+static size_t check(size_t modified) {
+  size_t page, ofs;
+
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++) {
+      char c = page < modified && ofs == 0 ? (char)page : expected(page, ofs);
+      if (buf[page][ofs] != c)
+        return page;
+    }
+  return PAGE_CNT;
+}
+
+/* Reads the buffer over and over, giving the merge thread time to
+   scan it several times, then writes the first page of each
+   pattern and checks everything again. */
+static size_t settle_and_write(void) {
+  size_t round, page;
+
+  for (round = 0; round < ROUNDS; round++)
+    if ((page = check(0)) != PAGE_CNT)
+      return page;
+  for (page = 0; page < PATTERNS; page++)
+    buf[page][0] = page;
+  return check(PATTERNS);
+}
+
+void test_main(void) {
+  pid_t child;
+  size_t page;
+
+  /* Fill after forking, so that both processes own private
+     frames rather than sharing them copy-on-write. */
+  child = fork();
+  fill();
+  if (child == 0)
+    exit(settle_and_write() == PAGE_CNT ? 0 : 1);
+  CHECK(child > 0, "fork");
+  msg("fill pages");
+
+  page = settle_and_write();
+  if (page != PAGE_CNT)
+    fail("page %zu does not match after merging", page);
+  msg("parent: pages intact after writes");
+  CHECK(wait(child) == 0, "wait for child");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-dedup) begin
+(page-dedup) fork
+(page-dedup) fill pages
+(page-dedup) parent: pages intact after writes
+(page-dedup) wait for child
+(page-dedup) end
+EOF
+pass;
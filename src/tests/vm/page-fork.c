@@ -0,0 +1,62 @@
+/* Forks a child that must see a copy of the parent's memory,
+   open files and held locks.  The child then overwrites the
+   memory, which must not affect the parent's copy. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+static bool buf_is(char (*expect)(size_t)) {
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != expect(i))
+      return false;
+  return true;
+}
+
+static char pattern(size_t i) { return i % 251; }
+
+static char ones(size_t i UNUSED) { return 0xff; }
+
+void test_main(void) {
+  char chunk[16];
+  lock_t lock;
+  pid_t child;
+  int fd, status;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = pattern(i);
+  CHECK((fd = open("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK(read(fd, chunk, sizeof chunk) == sizeof chunk, "read \"sample.txt\"");
+  CHECK(lock_init(&lock), "lock_init");
+  lock_acquire(&lock);
+
+  child = fork();
+  if (child == 0) {
+    CHECK(buf_is(pattern), "child: memory matches parent");
+    CHECK(read(fd, chunk, sizeof chunk) == sizeof chunk
+              && !memcmp(chunk, sample + sizeof chunk, sizeof chunk),
+          "child: read continues at parent's position");
+    lock_release(&lock);
+    msg("child: released inherited lock");
+    memset(buf, 0xff, SIZE);
+    CHECK(buf_is(ones), "child: overwrote memory");
+    exit(81);
+  }
+
+  status = wait(child);
+  CHECK(child != PID_ERROR && status == 81, "fork and wait for child");
+  CHECK(buf_is(pattern), "parent: memory unchanged");
+  CHECK(read(fd, chunk, sizeof chunk) == sizeof chunk
+            && !memcmp(chunk, sample + sizeof chunk, sizeof chunk),
+        "parent: read position unchanged");
+  lock_release(&lock);
+}
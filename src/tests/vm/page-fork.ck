@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-fork) begin
+(page-fork) open "sample.txt"
+(page-fork) read "sample.txt"
+(page-fork) lock_init
+(page-fork) child: memory matches parent
+(page-fork) child: read continues at parent's position
+(page-fork) child: released inherited lock
+(page-fork) child: overwrote memory
+(page-fork) fork and wait for child
+(page-fork) parent: memory unchanged
+(page-fork) parent: read position unchanged
+(page-fork) end
+EOF
+pass;
@@ -0,0 +1,96 @@
+/* Touches a 16 MB zero-filled array aligned to 4 MB, which the
+   kernel can map with four large pages when booted with
+   -large-pages, and then walks it with one access per 4 kB
+   page, which takes a TLB entry per page unless large pages are
+   in use.  The cycle counts for the first touch and for the walk
+   are informational only: run the test with and without
+   -large-pages to compare them.  Then drops the whole array with
+   madvise(MADV_DONTNEED), which must leave it reading as zeros
+   and usable again.  Finally checks that the kernel can read a
+   file into the array and that a forked child gets its own copy
+   of it. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define SIZE (16 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define PAGE_CNT (SIZE / PAGE_SIZE)
+#define ROUNDS 16
+
+/* Offset of the file data read into the array. */
+#define SAMPLE_OFS (5 * PAGE_SIZE + 100)
+
+static char buf[SIZE] __attribute__((aligned(4 * 1024 * 1024)));
+static volatile unsigned sink;
+
+static inline uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Returns true if every page still holds its marker byte and the
+   sample data sits at SAMPLE_OFS. */
+static bool array_intact(void) {
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i != SAMPLE_OFS / PAGE_SIZE && buf[i * PAGE_SIZE] != (char)i)
+      return false;
+  return !memcmp(buf + SAMPLE_OFS, sample, sizeof sample - 1);
+}
+
+void test_main(void) {
+  uint64_t start;
+  unsigned sum = 0;
+  size_t i, round;
+  pid_t child;
+  int fd;
+
+  start = rdtsc();
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+  msg("first touch: %llu cycles per page", (rdtsc() - start) / PAGE_CNT);
+
+  /* Vary the offset within each page so that the walk spreads
+     over the cache instead of hitting the same set. */
+  start = rdtsc();
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < PAGE_CNT; i++)
+      sum += buf[i * PAGE_SIZE + (i % 64) * 64];
+  sink = sum;
+  msg("walk: %llu cycles per access", (rdtsc() - start) / (ROUNDS * PAGE_CNT));
+
+  CHECK(madvise(buf, SIZE, MADV_DONTNEED), "madvise MADV_DONTNEED");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * PAGE_SIZE] != 0)
+      fail("page %zu not zero after MADV_DONTNEED", i);
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+  msg("array refilled after MADV_DONTNEED");
+
+  CHECK((fd = open("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK(read(fd, buf + SAMPLE_OFS, sizeof sample - 1) == (int)sizeof sample - 1,
+        "read \"sample.txt\" into the array");
+  close(fd);
+  if (!array_intact())
+    fail("array corrupted");
+
+  child = fork();
+  if (child == 0) {
+    if (!array_intact())
+      exit(1);
+    memset(buf, 0xff, SIZE / 2);
+    exit(0);
+  }
+  CHECK(child > 0, "fork");
+  CHECK(wait(child) == 0, "wait for child");
+  if (!array_intact())
+    fail("child's writes reached the parent");
+  msg("parent: array unchanged");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+# The cycle counts vary from run to run.
+my (@output) = grep (!/cycles per/, read_text_file ("$test.output"));
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(page-large) begin
+(page-large) madvise MADV_DONTNEED
+(page-large) array refilled after MADV_DONTNEED
+(page-large) open "sample.txt"
+(page-large) read "sample.txt" into the array
+(page-large) fork
+(page-large) wait for child
+(page-large) parent: array unchanged
+(page-large) end
+EOF
+pass;
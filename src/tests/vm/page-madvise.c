@@ -0,0 +1,71 @@
+/* Exercises madvise(): MADV_DONTNEED must turn anonymous pages
+   back into zeros while leaving the rest of the buffer alone,
+   must bring initialized data back from the executable even
+   after it was written and forked, and access hints on a file
+   mapping must not change what the process reads from it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 32
+#define SIZE (PAGES * 4096)
+#define HALF (SIZE / 2)
+
+static char buf[SIZE] __attribute__((aligned(4096)));
+static char data[4096] __attribute__((aligned(4096))) = "initialized data";
+
+static bool range_is(size_t start, size_t end, bool zero) {
+  size_t i;
+
+  for (i = start; i < end; i++)
+    if (buf[i] != (zero ? 0 : (char)(i % 251 + 1)))
+      return false;
+  return true;
+}
+
+void test_main(void) {
+  char* actual = (char*)0x10000000;
+  int handle;
+  mapid_t map;
+  pid_t child;
+  size_t i;
+
+  CHECK(!madvise(buf + 1, 4096, MADV_DONTNEED), "reject misaligned address");
+  CHECK(!madvise(buf, 4096, 42), "reject unknown advice");
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251 + 1;
+  CHECK(madvise(buf, HALF, MADV_DONTNEED), "madvise MADV_DONTNEED");
+  CHECK(range_is(0, HALF, true), "dropped pages read as zero");
+  CHECK(range_is(HALF, SIZE, false), "other pages intact");
+  for (i = 0; i < HALF; i++)
+    buf[i] = i % 251 + 1;
+  CHECK(range_is(0, SIZE, false), "dropped pages writable again");
+
+  strlcpy(data, "modified data", sizeof data);
+  CHECK(madvise(data, sizeof data, MADV_DONTNEED), "madvise MADV_DONTNEED on data");
+  CHECK(!strcmp(data, "initialized data"), "data reloaded from executable");
+  strlcpy(data, "modified data", sizeof data);
+  child = fork();
+  if (child == 0)
+    exit(0);
+  CHECK(child != PID_ERROR && wait(child) == 0, "fork and wait for child");
+  CHECK(madvise(data, sizeof data, MADV_DONTNEED), "madvise MADV_DONTNEED on forked data");
+  CHECK(!strcmp(data, "initialized data"), "forked data reloaded from executable");
+
+  CHECK((handle = open("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK((map = mmap(handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  CHECK(madvise(actual, 4096, MADV_SEQUENTIAL), "madvise MADV_SEQUENTIAL");
+  CHECK(madvise(actual, 4096, MADV_WILLNEED), "madvise MADV_WILLNEED");
+  if (memcmp(actual, sample, strlen(sample)))
+    fail("read of advised mapping reported bad data");
+  CHECK(madvise(actual, 4096, MADV_DONTNEED), "madvise MADV_DONTNEED on mapping");
+  CHECK(madvise(actual, 4096, MADV_RANDOM), "madvise MADV_RANDOM");
+  if (memcmp(actual, sample, strlen(sample)))
+    fail("mapping lost its contents after MADV_DONTNEED");
+  munmap(map);
+  close(handle);
+}
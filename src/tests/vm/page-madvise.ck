@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-madvise) begin
+(page-madvise) reject misaligned address
+(page-madvise) reject unknown advice
+(page-madvise) madvise MADV_DONTNEED
+(page-madvise) dropped pages read as zero
+(page-madvise) other pages intact
+(page-madvise) dropped pages writable again
+(page-madvise) madvise MADV_DONTNEED on data
+(page-madvise) data reloaded from executable
+(page-madvise) fork and wait for child
+(page-madvise) madvise MADV_DONTNEED on forked data
+(page-madvise) forked data reloaded from executable
+(page-madvise) open "sample.txt"
+(page-madvise) mmap "sample.txt"
+(page-madvise) madvise MADV_SEQUENTIAL
+(page-madvise) madvise MADV_WILLNEED
+(page-madvise) madvise MADV_DONTNEED on mapping
+(page-madvise) madvise MADV_RANDOM
+(page-madvise) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Fills 5 MB of memory, more than the machine has, with a
+   pattern that differs from page to page, then checks it twice
+   in different orders.  Pages must be evicted to swap and
+   brought back intact. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (5 * 1024 * 1024)
+#define PAGE 4096
+
+static char buf[SIZE];
+
+/* Returns the byte expected at offset OFS. */
+static char expected(size_t ofs) { return (char)(ofs / PAGE * 7 + ofs % 251); }
+
+void test_main(void) {
+  size_t i;
+
+  msg("write pass");
+  for (i = 0; i < SIZE; i++)
+    buf[i] = expected(i);
+
+  msg("forward read pass");
+  for (i = 0; i < SIZE; i += 61)
+    if (buf[i] != expected(i))
+      fail("byte %zu is %d, expected %d", i, buf[i], expected(i));
+
+  msg("backward read pass");
+  for (i = SIZE; i-- > 0;)
+    if (buf[i] != expected(i))
+      fail("byte %zu is %d, expected %d", i, buf[i], expected(i));
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-overcommit) begin
+(page-overcommit) write pass
+(page-overcommit) forward read pass
+(page-overcommit) backward read pass
+(page-overcommit) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Limits the process's resident set, then writes and verifies
+   a buffer four times as large as the limit.  The process must
+   evict its own pages instead of growing past its hard limit,
+   and a forked child must inherit the limits.  Pages shared
+   with the child stay in the parent's resident set. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HARD 64
+#define PAGES (4 * HARD)
+#define SIZE (PAGES * 4096)
+
+static char buf[SIZE];
+
+void test_main(void) {
+  struct rss_stat st;
+  pid_t child;
+  size_t i;
+
+  CHECK(!rss_limit(HARD, HARD / 2), "reject soft limit above hard limit");
+  CHECK(rss_limit(0, HARD), "rss_limit");
+
+  msg("write %d pages", PAGES);
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 253;
+  msg("verify %d pages", PAGES);
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char)(i % 253))
+      fail("byte %zu is wrong", i);
+
+  CHECK(rss_stat(&st), "rss_stat");
+  if (st.hard != HARD || st.soft != 0)
+    fail("limits are %u/%u, expected 0/%d", st.soft, st.hard, HARD);
+  if (st.rss > HARD || st.peak > HARD)
+    fail("resident set %u (peak %u) exceeds hard limit %d", st.rss, st.peak, HARD);
+  if (st.local_evictions == 0)
+    fail("no local evictions");
+  msg("resident set stayed within the hard limit");
+
+  child = fork();
+  if (child == 0)
+    exit(rss_stat(&st) && st.hard == HARD ? 81 : 1);
+  CHECK(wait(child) == 81, "child inherits the limit");
+
+  CHECK(rss_stat(&st), "rss_stat after fork");
+  if (st.rss < HARD / 2 || st.rss > HARD || st.peak > HARD)
+    fail("resident set %u (peak %u) after fork, expected %d to %d",
+         st.rss, st.peak, HARD / 2, HARD);
+  msg("shared pages stayed in the resident set");
+}
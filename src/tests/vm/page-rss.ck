@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-rss) begin
+(page-rss) reject soft limit above hard limit
+(page-rss) rss_limit
+(page-rss) write 256 pages
+(page-rss) verify 256 pages
+(page-rss) rss_stat
+(page-rss) resident set stayed within the hard limit
+(page-rss) child inherits the limit
+(page-rss) rss_stat after fork
+(page-rss) shared pages stayed in the resident set
+(page-rss) end
+EOF
+pass;
@@ -0,0 +1,24 @@
+/* Runs 4 child-share processes at once.  They share the pages
+   of their executable until they write to them, and every
+   child must still end up with a private copy of its data. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void test_main(void) {
+  pid_t children[CHILD_CNT];
+  char cmd[32];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) {
+    snprintf(cmd, sizeof cmd, "child-share %c", 'a' + i);
+    CHECK((children[i] = exec(cmd)) != -1, "exec \"%s\"", cmd);
+  }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK(wait(children[i]) == 'a' + i, "wait for child %d", i);
+}
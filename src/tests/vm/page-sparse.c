@@ -0,0 +1,29 @@
+/* Touches one page in every 64 of a 16 MB array, which is far
+   more memory than the machine has.  This only works if pages
+   are loaded when first used rather than when the program
+   starts. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (16 * 1024 * 1024)
+#define STRIDE (64 * 4096)
+
+static char buf[SIZE];
+
+void test_main(void) {
+  size_t i;
+
+  msg("write pass");
+  for (i = 0; i < SIZE; i += STRIDE) {
+    if (buf[i] != 0)
+      fail("byte %zu != 0", i);
+    buf[i] = i / STRIDE + 1;
+  }
+
+  msg("read pass");
+  for (i = 0; i < SIZE; i += STRIDE)
+    if (buf[i] != (char)(i / STRIDE + 1))
+      fail("byte %zu is %d", i, buf[i]);
+}
@@ -0,0 +1,34 @@
+/* Reads every page of a 32 MB array, which is far more memory
+   than the machine has, then writes to a few of them.  Pages
+   that are only read must share the zero page instead of each
+   taking a frame, and pages that are written must get private
+   frames that start out zeroed. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (32 * 1024 * 1024)
+#define STRIDE (256 * 4096)
+
+static char buf[SIZE];
+
+void test_main(void) {
+  size_t i;
+
+  msg("read pass");
+  for (i = 0; i < SIZE; i += 4096)
+    if (buf[i] != 0)
+      fail("byte %zu != 0", i);
+
+  msg("write pass");
+  for (i = 0; i < SIZE; i += STRIDE) {
+    if (buf[i + 1] != 0)
+      fail("byte %zu != 0", i + 1);
+    buf[i] = i / STRIDE + 1;
+  }
+
+  msg("check pass");
+  for (i = 0; i < SIZE; i += 4096)
+    if (buf[i] != (i % STRIDE == 0 ? (char)(i / STRIDE + 1) : 0))
+      fail("byte %zu is %d", i, buf[i]);
+}
@@ -0,0 +1,41 @@
+/* Fills 6 MB of memory, more than the machine has, with pages
+   that all compress well, then checks all of it.  Compressed
+   memory keeps growing while the kernel evicts, until free
+   pages drop below the low watermark; allocating a page for
+   compressed memory at that point must not recurse into
+   eviction. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (6 * 1024 * 1024)
+#define PAGE 4096
+#define PAGE_CNT (SIZE / PAGE)
+
+static char buf[SIZE];
+
+/* Fills page IDX of BUF with its expected contents, which are
+   distinct for every page but compress to a few chunks. */
+static void fill(char* page, size_t idx) {
+  size_t i;
+
+  for (i = 0; i < PAGE; i++)
+    page[i] = (char)(idx * 3 + i / 32);
+}
+
+void test_main(void) {
+  static char expected[PAGE];
+  size_t i;
+
+  msg("write pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill(buf + i * PAGE, i);
+
+  msg("read pass");
+  for (i = 0; i < PAGE_CNT; i++) {
+    fill(expected, i);
+    if (memcmp(buf + i * PAGE, expected, PAGE))
+      fail("page %zu is corrupted", i);
+  }
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-zswap-fill) begin
+(page-zswap-fill) write pass
+(page-zswap-fill) read pass
+(page-zswap-fill) end
+EOF
+pass;
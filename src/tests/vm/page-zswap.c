@@ -0,0 +1,47 @@
+/* Fills 6 MB of memory, more than the machine has, alternating
+   between pages that compress well and pages of random bytes
+   that do not compress at all, then checks all of it.  Evicted
+   pages end up both in compressed memory and on the swap
+   device, and must come back intact from either. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (6 * 1024 * 1024)
+#define PAGE 4096
+#define PAGE_CNT (SIZE / PAGE)
+
+static char buf[SIZE];
+
+/* Fills page IDX of BUF with its expected contents. */
+static void fill(char* page, size_t idx) {
+  struct arc4 arc4;
+  size_t i;
+
+  if (idx % 2 == 0) {
+    for (i = 0; i < PAGE; i++)
+      page[i] = (char)(idx + i / 64);
+  } else {
+    arc4_init(&arc4, &idx, sizeof idx);
+    memset(page, 0, PAGE);
+    arc4_crypt(&arc4, page, PAGE);
+  }
+}
+
+void test_main(void) {
+  static char expected[PAGE];
+  size_t i;
+
+  msg("write pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill(buf + i * PAGE, i);
+
+  msg("read pass");
+  for (i = 0; i < PAGE_CNT; i++) {
+    fill(expected, i);
+    if (memcmp(buf + i * PAGE, expected, PAGE))
+      fail("page %zu is corrupted", i);
+  }
+}
@@ -0,0 +1,24 @@
+/* Recurses deep enough to grow the stack by about 1 MB, one
+   frame at a time, then checks that every frame survived.
+   This must succeed. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 2048
+
+static int recurse(int depth) {
+  char frame[500];
+  int sum;
+
+  memset(frame, depth & 0xff, sizeof frame);
+  if (depth == 0)
+    return 0;
+  sum = recurse(depth - 1);
+  if (frame[0] != (char)(depth & 0xff) || frame[sizeof frame - 1] != (char)(depth & 0xff))
+    fail("frame at depth %d was clobbered", depth);
+  return sum + (depth & 0xff);
+}
+
+void test_main(void) { msg("sum: %d", recurse(DEPTH)); }
@@ -0,0 +1,82 @@
+/* Creates a shared memory segment, forks a child that attaches
+   it at a different address, and passes messages back and forth
+   through it, synchronizing with semaphores that live inside the
+   segment.  Both processes must see each other's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define KEY 162
+#define PAGES 4
+#define ROUNDS 32
+
+#define PARENT_ADDR ((char*)0x10000000)
+#define CHILD_ADDR ((char*)0x20000000)
+
+/* Layout of the segment: two semaphores in the first page,
+   the message in the remaining pages. */
+#define FULL(BASE) ((sema_t*)(BASE))
+#define EMPTY(BASE) ((sema_t*)(BASE) + 1)
+#define DATA(BASE) ((BASE) + 4096)
+#define DATA_SIZE ((PAGES - 1) * 4096)
+
+static bool data_is(const char* base, int round) {
+  size_t i;
+
+  for (i = 0; i < DATA_SIZE; i++)
+    if (base[i] != (char)(i * 7 + round))
+      return false;
+  return true;
+}
+
+static void fill(char* base, int round) {
+  size_t i;
+
+  for (i = 0; i < DATA_SIZE; i++)
+    base[i] = i * 7 + round;
+}
+
+void test_main(void) {
+  shmid_t id;
+  char* base;
+  pid_t child;
+  int round;
+
+  CHECK((id = shm_create(KEY, PAGES * 4096)) != SHM_FAILED, "shm_create");
+  CHECK(shm_create(KEY, 4096) == id, "shm_create finds existing segment");
+  CHECK((base = shm_attach(id, PARENT_ADDR)) == PARENT_ADDR, "shm_attach");
+  CHECK(sema_init(FULL(base), 0) && sema_init(EMPTY(base), 1), "sema_init in segment");
+
+  child = fork();
+  if (child == 0) {
+    char* mine = shm_attach(id, CHILD_ADDR);
+    bool ok = mine == CHILD_ADDR;
+
+    for (round = 0; ok && round < ROUNDS; round++) {
+      sema_down(FULL(mine));
+      ok = data_is(DATA(mine), round);
+      fill(DATA(mine), -round);
+      sema_up(EMPTY(mine));
+    }
+    shm_detach(mine);
+    exit(ok ? 81 : 1);
+  }
+
+  for (round = 0; round < ROUNDS; round++) {
+    sema_down(EMPTY(base));
+    if (round > 0 && !data_is(DATA(base), -(round - 1)))
+      fail("round %d: child's reply not visible", round);
+    fill(DATA(base), round);
+    sema_up(FULL(base));
+  }
+  msg("parent: sent %d messages", ROUNDS);
+
+  CHECK(wait(child) == 81, "wait for child");
+  CHECK(data_is(DATA(base), -(ROUNDS - 1)), "parent: last reply visible");
+  CHECK(shm_remove(id), "shm_remove");
+  CHECK(shm_attach(id, CHILD_ADDR) == NULL, "removed segment cannot be attached");
+  CHECK(data_is(DATA(base), -(ROUNDS - 1)), "parent: data survives removal");
+  CHECK(shm_detach(base), "shm_detach");
+}
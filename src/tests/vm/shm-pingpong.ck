@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-pingpong) begin
+(shm-pingpong) shm_create
+(shm-pingpong) shm_create finds existing segment
+(shm-pingpong) shm_attach
+(shm-pingpong) sema_init in segment
+(shm-pingpong) parent: sent 32 messages
+(shm-pingpong) wait for child
+(shm-pingpong) parent: last reply visible
+(shm-pingpong) shm_remove
+(shm-pingpong) removed segment cannot be attached
+(shm-pingpong) parent: data survives removal
+(shm-pingpong) shm_detach
+(shm-pingpong) end
+EOF
+pass;
@@ -0,0 +1,89 @@
+#include "threads/highmem.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+
+/* Temporary kernel mappings.
+
+   A frame in high memory has no kernel virtual address, so
+   whenever the kernel needs to read or write one, for example to
+   load a page of an executable into it, it borrows one of the
+   KMAP_SLOTS page-sized slots at KMAP_START with kmap() and gives
+   it back with kunmap().  The slots' page table lives in
+   init_page_dir, so a mapping is visible in every address space.
+
+   Mappings are meant to be short-lived.  If every slot is in
+   use, kmap() waits for one to be returned. */
+
+/* Number of slots. */
+#define KMAP_SLOTS (PTSPAN / PGSIZE)
+
+static struct lock kmap_lock;
+static struct condition slot_freed; /* Signaled by kunmap(). */
+static struct bitmap* used_map;     /* Slots in use. */
+static uint32_t* kmap_pt;           /* Page table for the slots. */
+static size_t next_slot;            /* Where to start looking. */
+
+/* Initializes temporary mappings.  Must be called after
+   paging_init() and before any process page directory is
+   created, since it adds a page table to init_page_dir. */
+void kmap_init(void) {
+  kmap_pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+  init_page_dir[pd_no(KMAP_START)] = pde_create(kmap_pt);
+
+  lock_init(&kmap_lock);
+  cond_init(&slot_freed);
+  used_map = bitmap_create(KMAP_SLOTS);
+  if (used_map == NULL)
+    PANIC("kmap: bitmap creation failed");
+}
+
+/* Returns a kernel virtual address through which the page frame
+   at physical address PADDR can be accessed, until it is passed
+   to kunmap().  Frames in low memory are returned at their
+   permanent address.  May sleep, so it must not be called from
+   an interrupt handler. */
+void* kmap(uintptr_t paddr) {
+  size_t slot;
+  void* vaddr;
+
+  ASSERT(pg_ofs((void*)paddr) == 0);
+  if (!is_highmem(paddr))
+    return ptov(paddr);
+
+  ASSERT(!intr_context());
+  lock_acquire(&kmap_lock);
+  while ((slot = bitmap_scan_and_flip(used_map, next_slot, 1, false)) == BITMAP_ERROR &&
+         (slot = bitmap_scan_and_flip(used_map, 0, 1, false)) == BITMAP_ERROR)
+    cond_wait(&slot_freed, &kmap_lock);
+  next_slot = (slot + 1) % KMAP_SLOTS;
+  lock_release(&kmap_lock);
+
+  vaddr = (uint8_t*)KMAP_START + slot * PGSIZE;
+  kmap_pt[slot] = paddr | PTE_P | PTE_W | (cpu_has_pge ? PTE_G : 0);
+  return vaddr;
+}
+
+/* Ends a mapping made by kmap().  VADDR must not be used
+   afterward. */
+void kunmap(void* vaddr) {
+  size_t slot;
+
+  if (vaddr < KMAP_START)
+    return;
+
+  ASSERT(pg_ofs(vaddr) == 0);
+  slot = ((uintptr_t)vaddr - (uintptr_t)KMAP_START) / PGSIZE;
+  kmap_pt[slot] = 0;
+  asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+
+  lock_acquire(&kmap_lock);
+  ASSERT(bitmap_test(used_map, slot));
+  bitmap_reset(used_map, slot);
+  cond_signal(&slot_freed, &kmap_lock);
+  lock_release(&kmap_lock);
+}
@@ -0,0 +1,27 @@
+#ifndef THREADS_HIGHMEM_H
+#define THREADS_HIGHMEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+
+/* Physical memory below LOWMEM_LIMIT ("low memory") is mapped
+   linearly at PHYS_BASE, up to where the vmalloc range begins.
+   Memory above it ("high memory") has no permanent kernel
+   mapping; it can only be used for user pages, and the kernel
+   reaches it through temporary mappings made by kmap(). */
+#define LOWMEM_LIMIT ((uintptr_t)VMALLOC_START - (uintptr_t)PHYS_BASE)
+
+/* Kernel virtual range for temporary mappings: the last 4 MB of
+   the address space, covered by one page table. */
+#define KMAP_START ((void*)0xffc00000)
+
+void kmap_init(void);
+void* kmap(uintptr_t paddr);
+void kunmap(void*);
+
+/* Returns true if physical address PADDR lies in high memory. */
+static inline bool is_highmem(uintptr_t paddr) { return paddr >= LOWMEM_LIMIT; }
+
+#endif /* threads/highmem.h */
@@ -23,6 +23,8 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/highmem.h"
+#include "threads/vmalloc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -37,13 +39,28 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/large.h"
+#include "vm/merge.h"
+#include "vm/prefetch.h"
+#include "vm/share.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t* init_page_dir;
 
+/* Paging features of the CPU, detected by paging_init(). */
+bool cpu_has_pse; /* 4 MB pages. */
+bool cpu_has_pge; /* Global pages. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -52,6 +69,9 @@ static bool format_filesys;
    overriding the defaults. */
 static const char* filesys_bdev_name;
 static const char* scratch_bdev_name;
+
+/* -cache: Number of sectors in the file system buffer cache. */
+static size_t cache_slot_cnt = CACHE_DEFAULT_SLOTS;
 #ifdef VM
 static const char* swap_bdev_name;
 #endif
@@ -60,7 +80,19 @@ static const char* swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef VM
+/* -zswap: Maximum number of pages in the compressed swap cache. */
+static size_t zswap_page_limit = ZSWAP_DEFAULT_PAGES;
+
+/* -merge: Pages the same-page merging thread scans per pass. */
+static size_t merge_page_cnt;
+
+/* -large-pages: Map big zero-filled regions with 4 MB pages? */
+static bool large_pages;
+#endif
+
 static void bss_init(void);
+static uint32_t detect_memory(void);
 static void paging_init(void);
 
 static char** read_command_line(void);
@@ -75,11 +107,15 @@ static void locate_block_device(enum block_type, const char* name);
 
 /* Pintos main program. */
 int main(void) {
+  uint32_t ram_pages;
   char** argv;
 
   /* Clear BSS. */
   bss_init();
 
+  /* Size memory from the BIOS memory map. */
+  ram_pages = detect_memory();
+
   /* Break command line into arguments and parse options. */
   argv = read_command_line();
   argv = parse_options(argv);
@@ -90,12 +126,14 @@ int main(void) {
   console_init();
 
   /* Greet user. */
-  printf("Pintos booting with %'" PRIu32 " kB RAM...\n", init_ram_pages * PGSIZE / 1024);
+  printf("Pintos booting with %'" PRIu32 " kB RAM...\n", ram_pages * (PGSIZE / 1024));
 
   /* Initialize memory system. */
   palloc_init(user_page_limit);
   malloc_init();
   paging_init();
+  vmalloc_init();
+  kmap_init();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -127,7 +165,19 @@ int main(void) {
   /* Initialize file system. */
   ide_init();
   locate_block_devices();
-  filesys_init(format_filesys);
+  filesys_init(format_filesys, cache_slot_cnt);
+#endif
+
+#ifdef VM
+  /* Initialize virtual memory. */
+  frame_init();
+  swap_init();
+  zswap_init(zswap_page_limit);
+  share_init();
+  shm_init();
+  prefetch_init();
+  merge_init(merge_page_cnt);
+  large_init(large_pages);
 #endif
 
   printf("Boot complete.\n");
@@ -151,15 +201,104 @@ static void bss_init(void) {
   memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Finds the top of usable RAM below 4 GB in the BIOS memory
+   map that start.S obtained, and returns it in pages.  Sets
+   init_ram_pages to the part of it in low memory, which is all
+   that paging_init() maps.  If the BIOS provided no map, keeps
+   the size that start.S found the old way. */
+static uint32_t detect_memory(void) {
+  const struct e820_entry* map = ptov(LOADER_E820_MAP);
+  uint64_t top = 0;
+  uint32_t i;
+
+  if (init_e820_cnt == 0)
+    return init_ram_pages;
+
+  for (i = 0; i < init_e820_cnt; i++) {
+    uint64_t end = map[i].base + map[i].length;
+    if (map[i].type != E820_USABLE)
+      continue;
+    if (end > (uint64_t)1 << 32)
+      end = (uint64_t)1 << 32;
+    if (end > top)
+      top = end;
+  }
+
+  init_ram_pages = (top < LOWMEM_LIMIT ? top : LOWMEM_LIMIT) >> PGBITS;
+  return top >> PGBITS;
+}
+
+/* Reads the CPUID feature flags into CPU_HAS_PSE and
+   CPU_HAS_PGE.  CPUID exists if software can toggle EFLAGS.ID.
+   See [IA32-v2a] "CPUID--CPU Identification". */
+static void detect_paging_features(void) {
+  uint32_t before, after, eax, ebx, ecx, edx;
+
+  asm volatile("pushfl; popl %0; movl %0, %1; xorl $0x200000, %1;"
+               "pushl %1; popfl; pushfl; popl %1; pushl %0; popfl"
+               : "=&r"(before), "=&r"(after));
+  if (((before ^ after) & 0x200000) == 0)
+    return;
+
+  asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+  cpu_has_pse = (edx & (1 << 3)) != 0;
+  cpu_has_pge = (edx & (1 << 13)) != 0;
+}
+
+static inline uint32_t read_cr4(void) {
+  uint32_t cr4;
+  asm volatile("movl %%cr4, %0" : "=r"(cr4));
+  return cr4;
+}
+
+static inline void write_cr4(uint32_t cr4) { asm volatile("movl %0, %%cr4" : : "r"(cr4) : "memory"); }
+
+/* Flushes every TLB entry, including global ones.  A CR3 reload
+   leaves global translations in place, but toggling CR4.PGE
+   drops them too.  See [IA32-v3a] 4.10.4.1 "Operations that
+   Invalidate TLBs and Paging-Structure Caches". */
+void tlb_flush_global(void) {
+  if (cpu_has_pge) {
+    uint32_t cr4 = read_cr4();
+    write_cr4(cr4 & ~CR4_PGE);
+    write_cr4(cr4);
+  } else
+    asm volatile("movl %%cr3, %%eax; movl %%eax, %%cr3" : : : "eax", "memory");
+}
+
+/* Enables or disables global translations.  Used by benchmarks
+   that want to measure what global pages buy us.  Returns the
+   previous setting. */
+bool tlb_set_global(bool enable) {
+  uint32_t cr4;
+
+  if (!cpu_has_pge)
+    return false;
+  cr4 = read_cr4();
+  write_cr4(enable ? cr4 | CR4_PGE : cr4 & ~CR4_PGE);
+  return (cr4 & CR4_PGE) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, each 4 MB chunk of physical memory
+   is mapped with a single large page, and every kernel
+   translation is marked global.  The chunk holding the kernel
+   text, and any partial chunk at the end of RAM, still use 4 kB
+   pages so that the text stays read-only.  Since every process
+   page directory copies the kernel half of init_page_dir, these
+   PDEs are shared by all of them, and a CR3 reload on a context
+   switch no longer throws the kernel's TLB entries away. */
 static void paging_init(void) {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
 
+  detect_paging_features();
+
   pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++) {
@@ -169,20 +308,37 @@ static void paging_init(void) {
     size_t pte_idx = pt_no(vaddr);
     bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+    if (cpu_has_pse && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages &&
+        !(&_start < vaddr + PTSPAN && vaddr < &_end_kernel_text)) {
+      pd[pde_idx] = pde_create_large_kernel(vaddr, cpu_has_pge);
+      page += PTSPAN / PGSIZE - 1;
+      continue;
+    }
+
     if (pd[pde_idx] == 0) {
       pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
       pd[pde_idx] = pde_create(pt);
     }
 
-    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | (cpu_has_pge ? PTE_G : 0);
   }
 
+  /* Large pages must be enabled before the page directory that
+     uses them is loaded. */
+  if (cpu_has_pse)
+    write_cr4(read_cr4() | CR4_PSE);
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)));
+
+  /* Global pages are turned on only once paging with the final
+     page directory is in effect. */
+  if (cpu_has_pge)
+    write_cr4(read_cr4() | CR4_PGE);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -240,6 +396,11 @@ static char** parse_options(char** argv) {
       filesys_bdev_name = value;
     else if (!strcmp(name, "-scratch"))
       scratch_bdev_name = value;
+    else if (!strcmp(name, "-cache")) {
+      cache_slot_cnt = atoi(value);
+      if (cache_slot_cnt == 0)
+        PANIC("buffer cache needs at least one sector (use -h for help)");
+    }
 #ifdef VM
     else if (!strcmp(name, "-swap"))
       swap_bdev_name = value;
@@ -258,10 +419,19 @@ static char** parse_options(char** argv) {
         scheduler_flags[SCHED_MLFQS] = 1;
       else
         PANIC("unknown scheduler option `%s' (use -h for help)", value);
-    }
+    } else if (!strcmp(name, "-sched-as"))
+      sched_as_affinity = true;
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
+#endif
+#ifdef VM
+    else if (!strcmp(name, "-zswap"))
+      zswap_page_limit = atoi(value);
+    else if (!strcmp(name, "-merge"))
+      merge_page_cnt = atoi(value);
+    else if (!strcmp(name, "-large-pages"))
+      large_pages = true;
 #endif
     else
       PANIC("unknown option `%s' (use -h for help)", name);
@@ -420,6 +590,7 @@ static void usage(void) {
          "  -f                 Format file system device during startup.\n"
          "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
          "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+         "  -cache=SECTORS     Cache up to SECTORS file system sectors (default 64).\n"
 #ifdef VM
          "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif // VM
@@ -431,9 +602,18 @@ static void usage(void) {
          "\"-sched-fair\", \"-sched-prio\".\n"
          "  -sched-prio        Use strict-priority round-robin scheduler. Mutually exclusive with "
          "\"-sched-fair\", \"-sched-mlfqs\".\n"
+         "  -sched-as          With \"-sched-prio\", prefer equal-priority threads that share\n"
+         "                     the current address space.\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif // USERPROG
+#ifdef VM
+         "  -zswap=COUNT       Keep up to COUNT pages of compressed swap in memory.\n"
+         "                     0 sends evicted pages straight to the swap device.\n"
+         "  -merge=PAGES       Merge identical anonymous pages, scanning PAGES pages\n"
+         "                     per pass.  Off by default.\n"
+         "  -large-pages       Map 4 MB aligned zero-filled regions with 4 MB pages.\n"
+#endif // VM
   );
   shutdown_power_off();
 }
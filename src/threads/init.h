@@ -9,4 +9,11 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t* init_page_dir;
 
+/* Paging features of the CPU. */
+extern bool cpu_has_pse;
+extern bool cpu_has_pge;
+
+void tlb_flush_global(void);
+bool tlb_set_global(bool enable);
+
 #endif /* threads/init.h */
@@ -24,6 +24,14 @@
 #define LOADER_ARGS_LEN 128
 #define LOADER_ARG_CNT_LEN 4
 
+/* Physical address where start.S stores the BIOS memory map,
+   and the most entries it will store there. */
+#define LOADER_E820_MAP 0x1000
+#define LOADER_E820_MAX 64
+
+/* Type of E820 memory map entry that describes usable RAM. */
+#define E820_USABLE 1
+
 /* GDT selectors defined by loader.
    More selectors are defined by userprog/gdt.h. */
 #define SEL_NULL 0x00  /* Null selector. */
@@ -35,6 +43,18 @@
 
 /* Amount of physical memory, in 4 kB pages. */
 extern uint32_t init_ram_pages;
+
+/* BIOS memory map entry, as returned by int 15h, AX=E820h. */
+struct e820_entry {
+  uint64_t base;   /* Physical address of range. */
+  uint64_t length; /* Length of range, in bytes. */
+  uint32_t type;   /* E820_USABLE or a reserved type. */
+  uint32_t attrs;  /* ACPI 3.0 extended attributes. */
+} __attribute__((packed));
+
+/* Number of entries in the memory map at LOADER_E820_MAP, or 0
+   if the BIOS does not support E820h. */
+extern uint32_t init_e820_cnt;
 #endif
 
 #endif /* threads/loader.h */
@@ -8,6 +8,7 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/vmalloc.h"
 
 /* A simple implementation of malloc().
 
@@ -32,7 +33,10 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  If the
+   kernel pool is too fragmented to supply that many physically
+   contiguous pages, we fall back to vmalloc(), which maps
+   scattered pages at contiguous virtual addresses. */
 
 /* Descriptor. */
 struct desc {
@@ -99,6 +103,8 @@ void* malloc(size_t size) {
          Allocate enough pages to hold SIZE plus an arena. */
     size_t page_cnt = DIV_ROUND_UP(size + sizeof *a, PGSIZE);
     a = palloc_get_multiple(0, page_cnt);
+    if (a == NULL && page_cnt > 1)
+      a = vmalloc(0, page_cnt);
     if (a == NULL)
       return NULL;
 
@@ -112,15 +118,21 @@ void* malloc(size_t size) {
 
   lock_acquire(&d->lock);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty(&d->free_list)) {
+  /* If the free list is empty, create a new arena.  The page
+     allocator may call reclaim hooks that malloc() and free()
+     blocks themselves, so drop the lock while it runs, and give
+     the page back if the free list was refilled meanwhile. */
+  while (list_empty(&d->free_list)) {
     size_t i;
 
-    /* Allocate a page. */
+    lock_release(&d->lock);
     a = palloc_get_page(0);
-    if (a == NULL) {
-      lock_release(&d->lock);
+    if (a == NULL)
       return NULL;
+    lock_acquire(&d->lock);
+    if (!list_empty(&d->free_list)) {
+      palloc_free_page(a);
+      break;
     }
 
     /* Initialize arena and add its blocks to the free list. */
@@ -230,7 +242,10 @@ void free(void* p) {
       lock_release(&d->lock);
     } else {
       /* It's a big block.  Free its pages. */
-      palloc_free_multiple(a, a->free_cnt);
+      if (is_vmalloc_addr(a))
+        vfree(a);
+      else
+        palloc_free_multiple(a, a->free_cnt);
       return;
     }
   }
@@ -7,7 +7,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/highmem.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -15,144 +17,545 @@
    page-multiple) chunks.  See malloc.h for an allocator that
    hands out smaller chunks.
 
-   System memory is divided into two "pools" called the kernel
-   and user pools.  The user pool is for user (virtual) memory
-   pages, the kernel pool for everything else.  The idea here is
-   that the kernel needs to have memory for its own operations
-   even if user processes are swapping like mad.
-
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
-
-/* A memory pool. */
-struct pool {
-  struct lock lock;        /* Mutual exclusion. */
-  struct bitmap* used_map; /* Bitmap of free pages. */
-  uint8_t* base;           /* Base of pool. */
+   All free memory forms a single pool, shared by two classes of
+   pages: user pages, for user (virtual) memory, and kernel pages
+   for everything else.  The idea behind keeping the classes
+   apart is that the kernel needs to have memory for its own
+   operations even if user processes are swapping like mad, but
+   a fixed split leaves one side idle while the other runs out.
+   So instead of splitting memory, each class gets:
+
+     - A reservation: a minimum number of pages that the other
+       class may never take.  A class can always allocate up to
+       its reservation.
+
+     - A soft limit.  Below it, a class may use any memory that
+       is not reserved for the other class.  Above it, a class
+       may not dig into the last LOW_WMARK free pages, which are
+       kept for the class that is still under its soft limit.
+
+     - A hard limit, which is never exceeded.  For user pages it
+       is set by the -ul command-line option.
+
+   By default, each class reserves 1/8 of memory and has a soft
+   limit of half of memory, which is where the old fixed split
+   put the boundary.
+
+   Whenever an allocation leaves fewer than LOW_WMARK pages free,
+   the allocator calls the reclaim hooks registered with
+   palloc_register_reclaim() and asks them to bring the number
+   of free pages back up to HIGH_WMARK.  An allocation refused
+   for lack of memory asks them for as many pages as it would
+   have needed, and is then retried once.
+
+   Kernel pages are allocated first-fit from the bottom of the
+   pool.  User pages are allocated starting where the user pool
+   used to begin, which keeps the two classes mostly apart and
+   leaves long runs of pages for palloc_get_multiple() in the
+   kernel.
+
+   The pool is made of two zones.  ZONE_NORMAL is low memory,
+   which the kernel maps linearly at PHYS_BASE, and ZONE_HIGHMEM
+   is any RAM above LOWMEM_LIMIT (see highmem.h), which has no
+   kernel address.  Kernel pages, and anything obtained through
+   palloc_get_page() or palloc_get_multiple(), come from
+   ZONE_NORMAL.  User frames obtained through palloc_get_frame()
+   come from ZONE_HIGHMEM when it has room, so that low memory
+   stays free for the kernel.  Ranges that the BIOS memory map
+   does not describe as usable RAM are never handed out. */
+
+/* A class of pages. */
+struct page_class {
+  const char* name; /* "kernel" or "user". */
+  size_t used;      /* Pages in use. */
+  size_t peak;      /* Largest USED so far. */
+  size_t reserve;   /* Guaranteed minimum. */
+  size_t soft;      /* Soft limit. */
+  size_t hard;      /* Hard limit. */
+  long long fails;  /* Allocations refused. */
+};
+
+/* A zone of physical memory. */
+enum zone_type { ZONE_NORMAL, ZONE_HIGHMEM, ZONE_CNT };
+
+struct zone {
+  const char* name;       /* "normal" or "highmem". */
+  uintptr_t base;         /* Physical address of first page. */
+  size_t pages;           /* Number of pages, including holes. */
+  size_t free;            /* Number of free pages. */
+  size_t user_start;      /* Where user allocations start looking. */
+  struct bitmap* used_map; /* Pages in use, or not usable RAM. */
+  struct bitmap* user_map; /* Pages that belong to PC_USER. */
 };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* The pool of free memory. */
+static struct lock pool_lock;        /* Mutual exclusion. */
+static struct zone zones[ZONE_CNT];  /* Indexed by enum zone_type. */
+static size_t pool_pages;            /* Number of usable pages in all zones. */
+static struct page_class classes[2]; /* Indexed by enum palloc_class. */
+
+/* Watermarks, in free pages. */
+static size_t low_wmark, high_wmark;
+
+/* Reclaim hooks. */
+#define RECLAIM_MAX 4
+static palloc_reclaim_func* reclaim_hooks[RECLAIM_MAX];
+static size_t reclaim_hook_cnt;
+static bool reclaiming;           /* A reclaim is in progress. */
+static long long reclaim_cnt;     /* Number of reclaims. */
+static long long reclaimed_pages; /* Pages the hooks freed. */
 
-static void init_pool(struct pool*, void* base, size_t page_cnt, const char* name);
-static bool page_from_pool(const struct pool*, void* page);
+/* Large frame runs. */
+static long long large_cnt;   /* Runs handed out. */
+static long long large_fails; /* Requests with no aligned run free. */
+
+static void init_zone(struct zone*, const char* name, uintptr_t base, size_t page_cnt,
+                      uint8_t** bm_buf);
+static uintptr_t get_frames(enum palloc_flags, size_t page_cnt, bool highmem);
+static void free_frames(uintptr_t frames, size_t page_cnt);
+static bool may_allocate(enum palloc_class, size_t page_cnt);
+static size_t free_target(enum palloc_class, size_t page_cnt);
+static size_t free_pages(void);
+static void reclaim(size_t target);
+static struct zone* frame_zone(uintptr_t frame);
+static uintptr_t take_frames(struct zone*, size_t page_idx, size_t page_cnt, enum palloc_class);
+static void zero_frames(uintptr_t frames, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages are given to user pages. */
 void palloc_init(size_t user_page_limit) {
-  /* Free memory starts at 1 MB and runs to the end of RAM. */
-  uint8_t* free_start = ptov(1024 * 1024);
-  uint8_t* free_end = ptov(init_ram_pages * PGSIZE);
-  size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  /* Low memory starts at 1 MB and runs to the end of the linear
+     mapping; high memory runs from there to the top of RAM below
+     4 GB. */
+  uintptr_t normal_base = 1024 * 1024;
+  size_t normal_cnt = init_ram_pages - pg_no((void*)normal_base);
+  size_t high_cnt = 0;
+  size_t bm_pages;
+  uint8_t* bm_buf;
+  uint32_t i;
+  struct page_class* k = &classes[PC_KERNEL];
+  struct page_class* u = &classes[PC_USER];
+
+  if (init_ram_pages * PGSIZE == LOWMEM_LIMIT) {
+    const struct e820_entry* map = ptov(LOADER_E820_MAP);
+    for (i = 0; i < init_e820_cnt; i++) {
+      uint64_t end = map[i].base + map[i].length;
+      if (map[i].type != E820_USABLE || end <= LOWMEM_LIMIT)
+        continue;
+      if (end > (uint64_t)1 << 32)
+        end = (uint64_t)1 << 32;
+      if ((end >> PGBITS) - pg_no((void*)LOWMEM_LIMIT) > high_cnt)
+        high_cnt = (end >> PGBITS) - pg_no((void*)LOWMEM_LIMIT);
+    }
+  }
+
+  /* We'll put the zones' bitmaps at the base of low memory.
+     Calculate the space needed for them and subtract it from
+     the normal zone's size. */
+  bm_pages = DIV_ROUND_UP(2 * bitmap_buf_size(normal_cnt) + 2 * bitmap_buf_size(high_cnt),
+                          PGSIZE);
+  if (bm_pages > normal_cnt)
+    PANIC("Not enough memory in pool for bitmaps.");
+  normal_cnt -= bm_pages;
+
+  lock_init(&pool_lock);
+  bm_buf = ptov(normal_base);
+  init_zone(&zones[ZONE_NORMAL], "normal", normal_base + bm_pages * PGSIZE, normal_cnt, &bm_buf);
+  init_zone(&zones[ZONE_HIGHMEM], "highmem", LOWMEM_LIMIT, high_cnt, &bm_buf);
+  zones[ZONE_NORMAL].user_start = normal_cnt / 2;
+  pool_pages = zones[ZONE_NORMAL].free + zones[ZONE_HIGHMEM].free;
+
+  k->name = "kernel";
+  k->hard = zones[ZONE_NORMAL].free;
+  k->soft = pool_pages / 2;
+  k->reserve = pool_pages / 8;
+
+  u->name = "user";
+  u->hard = user_page_limit < pool_pages ? user_page_limit : pool_pages;
+  u->soft = pool_pages / 2 < u->hard ? pool_pages / 2 : u->hard;
+  u->reserve = pool_pages / 8 < u->hard ? pool_pages / 8 : u->hard;
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool(&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool(&user_pool, free_start + kernel_pages * PGSIZE, user_pages, "user pool");
+  low_wmark = pool_pages / 64 > 4 ? pool_pages / 64 : 4;
+  high_wmark = 2 * low_wmark;
+
+  printf("%zu pages available: kernel reserves %zu, user reserves %zu, user limit %zu.\n",
+         pool_pages, k->reserve, u->reserve, u->hard);
+  if (zones[ZONE_HIGHMEM].free > 0)
+    printf("%zu of them in high memory.\n", zones[ZONE_HIGHMEM].free);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   If PAL_USER is set, the pages are user pages, otherwise kernel
+   pages.  If PAL_ZERO is set in FLAGS, then the pages are filled
+   with zeros.  If too few pages are available, returns a null
+   pointer, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics.  The pages always come from low memory.
+   If PAL_NORECLAIM is set, the reclaim hooks are not called even
+   when memory is low, so that a reclaim hook, or code it calls,
+   may allocate pages without recursing into itself. */
 void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
-  struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void* pages;
-  size_t page_idx;
+  uintptr_t frames = get_frames(flags, page_cnt, false);
+  return frames != 0 ? ptov(frames) : NULL;
+}
 
-  if (page_cnt == 0)
-    return NULL;
+/* Obtains a single free page and returns its kernel virtual
+   address.
+   If PAL_USER is set, the page is a user page, otherwise a
+   kernel page.  If PAL_ZERO is set in FLAGS, then the page is
+   filled with zeros.  If no pages are available, returns a null
+   pointer, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics. */
+void* palloc_get_page(enum palloc_flags flags) { return palloc_get_multiple(flags, 1); }
+
+/* Obtains a single free page frame and returns its physical
+   address, which may lie in high memory if PAL_USER is set in
+   FLAGS.  Use kmap() to access its contents.  Otherwise the same
+   as palloc_get_page(), except that failure returns 0. */
+uintptr_t palloc_get_frame(enum palloc_flags flags) {
+  return get_frames(flags, 1, (flags & PAL_USER) != 0);
+}
+
+/* Obtains PALLOC_LARGE_PAGES contiguous user frames that start
+   on a 4 MB boundary, for mapping with a single large page, and
+   returns the physical address of the first.  PAL_USER must be
+   set in FLAGS.  Such runs are only found in unfragmented
+   memory, so this returns 0 without asking the reclaim hooks
+   for memory if none is free right now; the caller is expected
+   to fall back to single frames.  Free the run with
+   palloc_free_large_frame(), or each frame on its own with
+   palloc_free_frame(). */
+uintptr_t palloc_get_large_frame(enum palloc_flags flags) {
+  uintptr_t frames = 0;
+  int zi;
 
-  lock_acquire(&pool->lock);
-  page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-  lock_release(&pool->lock);
+  ASSERT(flags & PAL_USER);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+  lock_acquire(&pool_lock);
+  if (may_allocate(PC_USER, PALLOC_LARGE_PAGES))
+    for (zi = ZONE_HIGHMEM; zi >= 0 && frames == 0; zi--) {
+      struct zone* z = &zones[zi];
+      size_t page_idx = ((ROUND_UP(z->base, PTSPAN) - z->base) >> PGBITS);
+
+      for (; page_idx + PALLOC_LARGE_PAGES <= z->pages; page_idx += PALLOC_LARGE_PAGES)
+        if (bitmap_none(z->used_map, page_idx, PALLOC_LARGE_PAGES)) {
+          bitmap_set_multiple(z->used_map, page_idx, PALLOC_LARGE_PAGES, true);
+          frames = take_frames(z, page_idx, PALLOC_LARGE_PAGES, PC_USER);
+          break;
+        }
+    }
+  if (frames != 0)
+    large_cnt++;
   else
-    pages = NULL;
+    large_fails++;
+  lock_release(&pool_lock);
+
+  if (frames != 0 && (flags & PAL_ZERO))
+    zero_frames(frames, PALLOC_LARGE_PAGES);
+  return frames;
+}
+
+/* Frees a run of frames obtained from palloc_get_large_frame(). */
+void palloc_free_large_frame(uintptr_t frames) {
+  ASSERT((frames & (PTSPAN - 1)) == 0);
+  free_frames(frames, PALLOC_LARGE_PAGES);
+}
+
+/* Frees the PAGE_CNT pages starting at PAGES. */
+void palloc_free_multiple(void* pages, size_t page_cnt) {
+  ASSERT(pg_ofs(pages) == 0);
+  if (pages == NULL || page_cnt == 0)
+    return;
+  free_frames(vtop(pages), page_cnt);
+}
 
-  if (pages != NULL) {
+/* Frees the page at PAGE. */
+void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
+
+/* Frees the page frame at physical address FRAME, which was
+   obtained from palloc_get_frame().  Does nothing if FRAME is 0. */
+void palloc_free_frame(uintptr_t frame) {
+  if (frame != 0)
+    free_frames(frame, 1);
+}
+
+/* Registers HOOK to be called when free memory runs low.  HOOK
+   is asked to free up to the given number of pages and returns
+   how many it freed.  It is called without any allocator lock
+   held and may itself allocate, but it will not be re-entered. */
+void palloc_register_reclaim(palloc_reclaim_func* hook) {
+  ASSERT(reclaim_hook_cnt < RECLAIM_MAX);
+  reclaim_hooks[reclaim_hook_cnt++] = hook;
+}
+
+/* Returns the number of pages of class C in use. */
+size_t palloc_used_cnt(enum palloc_class c) { return classes[c].used; }
+
+/* Prints page allocator statistics. */
+void palloc_print_stats(void) {
+  size_t i;
+
+  for (i = 0; i < sizeof classes / sizeof *classes; i++) {
+    const struct page_class* pc = &classes[i];
+    printf("Pages: %s %zu used, %zu peak, %lld refused\n", pc->name, pc->used, pc->peak,
+           pc->fails);
+  }
+  for (i = 0; i < ZONE_CNT; i++)
+    if (zones[i].pages > 0)
+      printf("Pages: %s zone %zu free\n", zones[i].name, zones[i].free);
+  printf("Pages: %lld reclaims freed %lld pages\n", reclaim_cnt, reclaimed_pages);
+  printf("Pages: %lld large runs handed out, %lld requests found no aligned run\n", large_cnt,
+         large_fails);
+}
+
+/* Initializes Z to cover PAGE_CNT pages starting at physical
+   address BASE, with its bitmaps carved out of *BM_BUF, which is
+   advanced past them.  Pages that the BIOS memory map does not
+   report as usable RAM are marked in use for good.  Without a
+   memory map, every page is taken to be usable. */
+static void init_zone(struct zone* z, const char* name, uintptr_t base, size_t page_cnt,
+                      uint8_t** bm_buf) {
+  const struct e820_entry* map = ptov(LOADER_E820_MAP);
+  uint64_t start = base, end = base + (uint64_t)page_cnt * PGSIZE;
+  uint32_t i;
+  int pass;
+
+  z->name = name;
+  z->base = base;
+  z->pages = page_cnt;
+  z->used_map = bitmap_create_in_buf(page_cnt, *bm_buf, bitmap_buf_size(page_cnt));
+  *bm_buf += bitmap_buf_size(page_cnt);
+  z->user_map = bitmap_create_in_buf(page_cnt, *bm_buf, bitmap_buf_size(page_cnt));
+  *bm_buf += bitmap_buf_size(page_cnt);
+
+  if (init_e820_cnt > 0) {
+    /* Usable ranges first, then anything reserved on top of
+       them, rounding inward and outward respectively. */
+    bitmap_set_all(z->used_map, true);
+    for (pass = 0; pass < 2; pass++)
+      for (i = 0; i < init_e820_cnt; i++) {
+        bool usable = map[i].type == E820_USABLE;
+        uint64_t lo = map[i].base, hi = map[i].base + map[i].length;
+
+        if (usable != (pass == 0))
+          continue;
+        lo = usable ? (lo + PGMASK) & ~(uint64_t)PGMASK : lo & ~(uint64_t)PGMASK;
+        hi = usable ? hi & ~(uint64_t)PGMASK : (hi + PGMASK) & ~(uint64_t)PGMASK;
+        if (lo < start)
+          lo = start;
+        if (hi > end)
+          hi = end;
+        if (lo < hi)
+          bitmap_set_multiple(z->used_map, (lo - start) >> PGBITS, (hi - lo) >> PGBITS, !usable);
+      }
+  }
+  z->free = bitmap_count(z->used_map, 0, page_cnt, false);
+}
+
+/* Obtains PAGE_CNT contiguous page frames and returns the
+   physical address of the first, or 0 on failure.  See
+   palloc_get_multiple() for FLAGS.  If HIGHMEM is true, the
+   frames may come from high memory, which is tried first. */
+static uintptr_t get_frames(enum palloc_flags flags, size_t page_cnt, bool highmem) {
+  enum palloc_class c = flags & PAL_USER ? PC_USER : PC_KERNEL;
+  uintptr_t frames = 0;
+  size_t target = 0;
+  bool low = false;
+  int attempt;
+
+  if (page_cnt == 0)
+    return 0;
+
+  for (attempt = 0; attempt < 2 && frames == 0; attempt++) {
+    struct zone* z = NULL;
+    size_t page_idx = BITMAP_ERROR;
+    int zi;
+
+    if (attempt > 0) {
+      if (flags & PAL_NORECLAIM)
+        break;
+      reclaim(target);
+    }
+
+    lock_acquire(&pool_lock);
+    if (may_allocate(c, page_cnt))
+      for (zi = highmem ? ZONE_HIGHMEM : ZONE_NORMAL; zi >= 0 && page_idx == BITMAP_ERROR;
+           zi--) {
+        z = &zones[zi];
+        if (z->free < page_cnt)
+          continue;
+        if (c == PC_USER) {
+          page_idx = bitmap_scan_and_flip(z->used_map, z->user_start, page_cnt, false);
+          if (page_idx == BITMAP_ERROR)
+            page_idx = bitmap_scan_and_flip(z->used_map, 0, page_cnt, false);
+        } else
+          page_idx = bitmap_scan_and_flip(z->used_map, 0, page_cnt, false);
+      }
+    if (page_idx != BITMAP_ERROR) {
+      frames = take_frames(z, page_idx, page_cnt, c);
+      low = free_pages() < low_wmark;
+    } else if (attempt == 0 && !(flags & PAL_NORECLAIM))
+      target = free_target(c, page_cnt);
+    else
+      classes[c].fails++;
+    lock_release(&pool_lock);
+  }
+
+  if (frames != 0) {
     if (flags & PAL_ZERO)
-      memset(pages, 0, PGSIZE * page_cnt);
+      zero_frames(frames, page_cnt);
+    if (low && !(flags & PAL_NORECLAIM))
+      reclaim(high_wmark);
   } else {
     if (flags & PAL_ASSERT)
       PANIC("palloc_get: out of pages");
   }
 
-  return pages;
+  return frames;
 }
 
-/* Obtains a single free page and returns its kernel virtual
-   address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the page is filled with zeros.  If no pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
-void* palloc_get_page(enum palloc_flags flags) { return palloc_get_multiple(flags, 1); }
+/* Gives the PAGE_CNT pages starting at PAGE_IDX in Z, already
+   marked in use in its used_map, to class C and returns the
+   physical address of the first.  The caller must hold
+   pool_lock. */
+static uintptr_t take_frames(struct zone* z, size_t page_idx, size_t page_cnt,
+                             enum palloc_class c) {
+  struct page_class* pc = &classes[c];
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
-void palloc_free_multiple(void* pages, size_t page_cnt) {
-  struct pool* pool;
-  size_t page_idx;
+  bitmap_set_multiple(z->user_map, page_idx, page_cnt, c == PC_USER);
+  z->free -= page_cnt;
+  pc->used += page_cnt;
+  if (pc->used > pc->peak)
+    pc->peak = pc->used;
+  return z->base + PGSIZE * page_idx;
+}
 
-  ASSERT(pg_ofs(pages) == 0);
-  if (pages == NULL || page_cnt == 0)
-    return;
+/* Fills the PAGE_CNT frames starting at FRAMES with zeros. */
+static void zero_frames(uintptr_t frames, size_t page_cnt) {
+  size_t i;
 
-  if (page_from_pool(&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool(&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED();
+  for (i = 0; i < page_cnt; i++) {
+    void* page = kmap(frames + i * PGSIZE);
+    memset(page, 0, PGSIZE);
+    kunmap(page);
+  }
+}
+
+/* Frees the PAGE_CNT frames starting at physical address
+   FRAMES. */
+static void free_frames(uintptr_t frames, size_t page_cnt) {
+  struct zone* z = frame_zone(frames);
+  size_t page_idx;
+  enum palloc_class c;
 
-  page_idx = pg_no(pages) - pg_no(pool->base);
+  ASSERT(z != NULL);
+  page_idx = (frames - z->base) >> PGBITS;
 
 #ifndef NDEBUG
-  memset(pages, 0xcc, PGSIZE * page_cnt);
+  {
+    size_t i;
+    for (i = 0; i < page_cnt; i++) {
+      void* page = kmap(frames + i * PGSIZE);
+      memset(page, 0xcc, PGSIZE);
+      kunmap(page);
+    }
+  }
 #endif
 
-  ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+  lock_acquire(&pool_lock);
+  c = bitmap_test(z->user_map, page_idx) ? PC_USER : PC_KERNEL;
+  ASSERT(bitmap_all(z->used_map, page_idx, page_cnt));
+  ASSERT(c == PC_USER ? bitmap_all(z->user_map, page_idx, page_cnt)
+                      : bitmap_none(z->user_map, page_idx, page_cnt));
+  bitmap_set_multiple(z->used_map, page_idx, page_cnt, false);
+  z->free += page_cnt;
+  classes[c].used -= page_cnt;
+  lock_release(&pool_lock);
 }
 
-/* Frees the page at PAGE. */
-void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
+/* Returns true if class C may take PAGE_CNT more pages under
+   its limits and the other class's reservation.  Kernel pages
+   can only come from low memory, so for them only free low
+   memory counts, and the user reservation only holds it back
+   as far as high memory cannot cover it.  The caller must hold
+   pool_lock. */
+static bool may_allocate(enum palloc_class c, size_t page_cnt) {
+  const struct page_class* pc = &classes[c];
+  const struct page_class* other = &classes[c == PC_USER ? PC_KERNEL : PC_USER];
+  size_t held_back = other->used < other->reserve ? other->reserve - other->used : 0;
+  size_t avail = free_pages();
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
-static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* name) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
-
-  printf("%zu pages available in %s.\n", page_cnt, name);
-
-  /* Initialize the pool. */
-  lock_init(&p->lock);
-  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
-}
-
-/* Returns true if PAGE was allocated from POOL,
-   false otherwise. */
-static bool page_from_pool(const struct pool* pool, void* page) {
-  size_t page_no = pg_no(page);
-  size_t start_page = pg_no(pool->base);
-  size_t end_page = start_page + bitmap_size(pool->used_map);
-
-  return page_no >= start_page && page_no < end_page;
+  if (c == PC_KERNEL) {
+    size_t high_free = zones[ZONE_HIGHMEM].free;
+    avail = zones[ZONE_NORMAL].free;
+    held_back = held_back > high_free ? held_back - high_free : 0;
+  }
+
+  if (pc->used + page_cnt > pc->hard)
+    return false;
+  if (pc->used + page_cnt <= pc->reserve)
+    return avail >= page_cnt;
+  if (avail < page_cnt + held_back)
+    return false;
+  if (pc->used + page_cnt > pc->soft && avail - page_cnt < held_back + low_wmark)
+    return false;
+  return true;
+}
+
+/* Returns the number of free pages that would let class C
+   allocate PAGE_CNT pages, as far as free memory is concerned.
+   The caller must hold pool_lock. */
+static size_t free_target(enum palloc_class c, size_t page_cnt) {
+  const struct page_class* pc = &classes[c];
+  const struct page_class* other = &classes[c == PC_USER ? PC_KERNEL : PC_USER];
+  size_t target = page_cnt;
+
+  if (pc->used + page_cnt > pc->reserve && other->used < other->reserve)
+    target += other->reserve - other->used;
+  if (pc->used + page_cnt > pc->soft)
+    target += low_wmark;
+  return target > high_wmark ? target : high_wmark;
+}
+
+/* Returns the number of free pages.  The caller must hold
+   pool_lock. */
+static size_t free_pages(void) { return zones[ZONE_NORMAL].free + zones[ZONE_HIGHMEM].free; }
+
+/* Calls the reclaim hooks until there are TARGET free pages or
+   all of them have been tried.  Does nothing if a reclaim is
+   already under way. */
+static void reclaim(size_t target) {
+  size_t i, want;
+
+  lock_acquire(&pool_lock);
+  if (reclaiming || reclaim_hook_cnt == 0 || free_pages() >= target) {
+    lock_release(&pool_lock);
+    return;
+  }
+  reclaiming = true;
+  reclaim_cnt++;
+  want = target - free_pages();
+  lock_release(&pool_lock);
+
+  for (i = 0; i < reclaim_hook_cnt && want > 0; i++) {
+    size_t freed = reclaim_hooks[i](want);
+    reclaimed_pages += freed;
+    want = freed < want ? want - freed : 0;
+  }
+
+  lock_acquire(&pool_lock);
+  reclaiming = false;
+  lock_release(&pool_lock);
+}
+
+/* Returns the zone that FRAME was allocated from, or a null
+   pointer if it is not in the pool. */
+static struct zone* frame_zone(uintptr_t frame) {
+  int i;
+
+  for (i = 0; i < ZONE_CNT; i++) {
+    struct zone* z = &zones[i];
+    if (frame >= z->base && (frame - z->base) >> PGBITS < z->pages)
+      return z;
+  }
+  return NULL;
 }
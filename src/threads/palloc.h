@@ -2,18 +2,40 @@
 #define THREADS_PALLOC_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* How to allocate pages. */
 enum palloc_flags {
   PAL_ASSERT = 001, /* Panic on failure. */
   PAL_ZERO = 002,   /* Zero page contents. */
-  PAL_USER = 004    /* User page. */
+  PAL_USER = 004,   /* User page. */
+  PAL_NORECLAIM = 010 /* Never call the reclaim hooks. */
 };
 
+/* Classes of pages, each with its own limits. */
+enum palloc_class {
+  PC_KERNEL, /* Kernel pages. */
+  PC_USER    /* User pages. */
+};
+
+/* Number of frames in a run for one 4 MB large page. */
+#define PALLOC_LARGE_PAGES 1024
+
+/* Tries to free up to PAGE_CNT pages when memory runs low.
+   Returns the number of pages actually freed. */
+typedef size_t palloc_reclaim_func(size_t page_cnt);
+
 void palloc_init(size_t user_page_limit);
 void* palloc_get_page(enum palloc_flags);
 void* palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void*);
 void palloc_free_multiple(void*, size_t page_cnt);
+uintptr_t palloc_get_frame(enum palloc_flags);
+void palloc_free_frame(uintptr_t);
+uintptr_t palloc_get_large_frame(enum palloc_flags);
+void palloc_free_large_frame(uintptr_t);
+void palloc_register_reclaim(palloc_reclaim_func*);
+size_t palloc_used_cnt(enum palloc_class);
+void palloc_print_stats(void);
 
 #endif /* threads/palloc.h */
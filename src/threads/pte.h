@@ -62,6 +62,13 @@ static inline uintptr_t pd_no(const void* va) { return (uintptr_t)va >> PDSHIFT;
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100          /* 1=global, not flushed by CR3 loads. */
+
+/* Control register 4 bits that enable the two flags above.
+   See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x10  /* Page size extensions (4 MB pages). */
+#define CR4_PGE 0x80  /* Page global enable. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t* pt) {
@@ -69,10 +76,34 @@ static inline uint32_t pde_create(uint32_t* pt) {
   return vtop(pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB of kernel memory starting at
+   PAGE with a single large page, which requires CR4.PSE.  PAGE
+   must be 4 MB aligned.  If GLOBAL is true then the translation
+   is also marked global, so that it survives CR3 reloads once
+   CR4.PGE is set.  The page is writable and kernel-only. */
+static inline uint32_t pde_create_large_kernel(void* page, bool global) {
+  ASSERT(((uintptr_t)page & (PTSPAN - 1)) == 0);
+  return vtop(page) | PTE_PS | PTE_P | PTE_W | (global ? PTE_G : 0);
+}
+
+/* Returns a PDE that maps the 4 MB of physical memory starting
+   at FRAME into user space with a single large page, which
+   requires CR4.PSE.  FRAME must be 4 MB aligned.  If WRITABLE is
+   true, the user process may write the page. */
+static inline uint32_t pde_create_large_user(uintptr_t frame, bool writable) {
+  ASSERT((frame & (PTSPAN - 1)) == 0);
+  return frame | PTE_PS | PTE_P | PTE_U | (writable ? PTE_W : 0);
+}
+
+/* Returns true if PDE maps a 4 MB page instead of pointing to a
+   page table. */
+static inline bool pde_is_large(uint32_t pde) { return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS); }
+
 /* Returns a pointer to the page table that page directory entry
    PDE, which must "present", points to. */
 static inline uint32_t* pde_get_pt(uint32_t pde) {
   ASSERT(pde & PTE_P);
+  ASSERT(!(pde & PTE_PS));
   return ptov(pde & PTE_ADDR);
 }
 
@@ -93,8 +124,20 @@ static inline uint32_t pte_create_user(void* page, bool writable) {
   return pte_create_kernel(page, writable) | PTE_U;
 }
 
+/* Returns a PTE that points to the page frame at physical
+   address FRAME, which may lie in high memory.  Otherwise the
+   same as pte_create_user(). */
+static inline uint32_t pte_create_user_frame(uintptr_t frame, bool writable) {
+  ASSERT((frame & PTE_FLAGS) == 0);
+  return frame | PTE_P | PTE_U | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page that page table entry PTE points
    to. */
 static inline void* pte_get_page(uint32_t pte) { return ptov(pte & PTE_ADDR); }
 
+/* Returns the physical address of the page frame that page
+   table entry PTE points to. */
+static inline uintptr_t pte_get_frame(uint32_t pte) { return pte & PTE_ADDR; }
+
 #endif /* threads/pte.h */
@@ -13,6 +13,8 @@
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #ifdef USERPROG
+#include "threads/init.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
 #endif
 
@@ -82,6 +84,14 @@ static struct thread* thread_schedule_reserved(void);
    Is equal to SCHED_FIFO by default. */
 enum sched_policy active_sched_policy;
 
+/* "-sched-as": 严格优先级调度器在同等优先级的线程中，
+   优先选择与当前地址空间相同的线程，从而省去CR3的重新载入 */
+bool sched_as_affinity;
+
+/* 最多允许连续插队多少次，避免其他进程的线程饿死 */
+#define AS_AFFINITY_MAX_STREAK TIME_SLICE
+static unsigned as_affinity_streak;
+
 /* Selects a thread to run from the ready list according to
    some scheduling policy, and returns a pointer to it. */
 typedef struct thread* scheduler_func(void);
@@ -562,6 +572,7 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   t->in_handler = false;
   t->joined_by = NULL;
   t->stack_no = -1;
+  t->user_esp = NULL;
   t->magic = THREAD_MAGIC;
 
   t->donated_for = NULL;
@@ -616,12 +627,60 @@ static struct thread* thread_schedule_fifo(void) {
     return idle_thread;
 }
 
+#ifdef USERPROG
+/* 返回线程T所在的地址空间（内核线程为init_page_dir） */
+static uint32_t* thread_pagedir(struct thread* t) {
+  if (t->pcb != NULL && t->pcb->pagedir != NULL)
+    return t->pcb->pagedir;
+  return init_page_dir;
+}
+
+/**
+ * @brief 在与队首线程优先级相同的线程中，寻找与当前已载入的地址空间相同的线程
+ *
+ * 找到的线程若不是队首线程，则视为一次插队；连续插队达到
+ * AS_AFFINITY_MAX_STREAK 次后，强制调度队首线程
+ *
+ * @return struct thread* 若没有合适的线程，返回NULL
+ */
+static struct thread* pick_same_address_space(void) {
+  struct thread* front = list_entry(list_front(&ready_list), struct thread, elem);
+  uint32_t* pd = active_pd();
+  struct thread* pos;
+
+  if (thread_pagedir(front) == pd || as_affinity_streak >= AS_AFFINITY_MAX_STREAK) {
+    as_affinity_streak = 0;
+    return NULL;
+  }
+
+  list_for_each_entry(pos, &ready_list, elem) {
+    if (pos->e_pri != front->e_pri)
+      break;
+    if (thread_pagedir(pos) == pd) {
+      as_affinity_streak++;
+      return pos;
+    }
+  }
+  as_affinity_streak = 0;
+  return NULL;
+}
+#endif
+
 /* Strict priority scheduler */
 static struct thread* thread_schedule_prio(void) {
-  if (!list_empty(&ready_list))
-    return list_entry(list_pop_front(&ready_list), struct thread, elem);
-  else
+  if (list_empty(&ready_list))
     return idle_thread;
+
+#ifdef USERPROG
+  if (sched_as_affinity) {
+    struct thread* t = pick_same_address_space();
+    if (t != NULL) {
+      list_remove(&t->elem);
+      return t;
+    }
+  }
+#endif
+  return list_entry(list_pop_front(&ready_list), struct thread, elem);
 }
 
 /* Fair priority scheduler */
@@ -132,6 +132,7 @@ struct thread {
 #endif
   struct process* pcb;        /* Process control block if this thread is a userprog */
   size_t stack_no;            /* 线程的虚拟内存栈编号 */
+  void* user_esp;             /* 最近一次进入系统调用时的用户栈指针 */
   struct list_elem prog_elem; /* 进程线程列表元素 */
   struct thread* joined_by;   /* 指向join当前线程的TCB（通过禁用中断确保读写原子性） */
 
@@ -156,6 +157,9 @@ enum sched_policy {
  * Is equal to SCHED_FIFO by default. */
 extern enum sched_policy active_sched_policy;
 
+/* 同等优先级下是否偏向调度相同地址空间的线程，由 "-sched-as" 开启 */
+extern bool sched_as_affinity;
+
 void thread_init(void);
 void thread_start(void);
 
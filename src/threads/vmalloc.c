@@ -0,0 +1,199 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Virtually contiguous kernel allocator.
+
+   palloc_get_multiple() needs physically contiguous pages, which
+   may be impossible to find once the kernel pool is fragmented,
+   even when plenty of pages are free.  vmalloc() instead takes
+   pages one at a time from the kernel pool and maps them at
+   consecutive addresses in a kernel virtual range reserved for
+   the purpose, VMALLOC_START to VMALLOC_END.
+
+   Each allocation is followed by an unmapped guard page, which
+   catches overruns and also marks where the allocation ends, so
+   that vfree() does not need to be told its size.
+
+   Unmapping a page requires its stale translation to be flushed
+   from the TLB before the address can be handed out again.
+   Rather than flushing each page as it is freed, vfree() only
+   clears the PTEs and returns the physical pages; the addresses
+   are marked "lazy" and stay reserved.  When enough of them pile
+   up, or when an allocation cannot find room, purge() flushes
+   them all at once and makes them available again.  The freed
+   physical pages themselves may be reused at once, since only
+   the dead vmalloc address could still reach them. */
+
+/* Number of pages in the vmalloc range. */
+#define VMALLOC_PAGES ((size_t)(VMALLOC_END - VMALLOC_START) / PGSIZE)
+
+/* Lazily freed pages allowed to accumulate before a purge. */
+#define LAZY_MAX 256
+
+/* Purges of at most this many pages use INVLPG per page; larger
+   ones flush the whole TLB. */
+#define INVLPG_MAX 32
+
+static struct lock vmalloc_lock;
+static struct bitmap* used_map; /* Reserved pages, including lazy ones. */
+static struct bitmap* lazy_map; /* Freed pages awaiting a TLB flush. */
+static size_t lazy_cnt;         /* Number of bits set in LAZY_MAP. */
+
+static void purge(void);
+
+/* Returns the page table entry for kernel virtual address
+   VADDR, which must lie in the vmalloc range. */
+static uint32_t* lookup_pte(const void* vaddr) {
+  ASSERT(is_vmalloc_addr(vaddr));
+  return pde_get_pt(init_page_dir[pd_no(vaddr)]) + pt_no(vaddr);
+}
+
+/* Returns the address of page PAGE_IDX in the vmalloc range. */
+static inline void* page_addr(size_t page_idx) {
+  return (uint8_t*)VMALLOC_START + page_idx * PGSIZE;
+}
+
+/* Returns the index in the vmalloc range of page VADDR. */
+static inline size_t page_idx(const void* vaddr) {
+  return ((uintptr_t)vaddr - (uintptr_t)VMALLOC_START) / PGSIZE;
+}
+
+/* Initializes the vmalloc allocator.  Must be called after
+   paging_init() and before any process page directory is
+   created, since it adds page tables to init_page_dir. */
+void vmalloc_init(void) {
+  uint8_t* vaddr;
+
+  ASSERT(ptov(init_ram_pages * PGSIZE) <= VMALLOC_START);
+
+  for (vaddr = VMALLOC_START; vaddr < (uint8_t*)VMALLOC_END; vaddr += PTSPAN) {
+    uint32_t* pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+    init_page_dir[pd_no(vaddr)] = pde_create(pt);
+  }
+
+  lock_init(&vmalloc_lock);
+  used_map = bitmap_create(VMALLOC_PAGES);
+  lazy_map = bitmap_create(VMALLOC_PAGES);
+  if (used_map == NULL || lazy_map == NULL)
+    PANIC("vmalloc: bitmap creation failed");
+}
+
+/* Obtains PAGE_CNT pages from the kernel pool, one at a time,
+   and maps them at consecutive kernel virtual addresses.
+   Returns the address of the first page.  If PAL_ZERO is set in
+   FLAGS, the pages are zeroed.  If address space or memory runs
+   out, returns a null pointer, unless PAL_ASSERT is set in FLAGS,
+   in which case the kernel panics.  PAL_USER is not allowed.
+
+   Must not be called from an interrupt handler. */
+void* vmalloc(enum palloc_flags flags, size_t page_cnt) {
+  size_t start, i;
+
+  ASSERT(!(flags & PAL_USER));
+  ASSERT(!intr_context());
+
+  if (page_cnt == 0)
+    return NULL;
+
+  /* Reserve PAGE_CNT pages plus a guard page. */
+  lock_acquire(&vmalloc_lock);
+  start = bitmap_scan_and_flip(used_map, 0, page_cnt + 1, false);
+  if (start == BITMAP_ERROR && lazy_cnt > 0) {
+    purge();
+    start = bitmap_scan_and_flip(used_map, 0, page_cnt + 1, false);
+  }
+  lock_release(&vmalloc_lock);
+  if (start == BITMAP_ERROR)
+    goto fail;
+
+  /* Back each page.  The PTEs are ours alone once reserved. */
+  for (i = 0; i < page_cnt; i++) {
+    void* kpage = palloc_get_page(flags & PAL_ZERO);
+    if (kpage == NULL) {
+      /* Undo.  Nothing has been accessed through the new
+         mappings, so none of them can be in the TLB. */
+      while (i-- > 0) {
+        uint32_t* pte = lookup_pte(page_addr(start + i));
+        palloc_free_page(pte_get_page(*pte));
+        *pte = 0;
+      }
+      lock_acquire(&vmalloc_lock);
+      bitmap_set_multiple(used_map, start, page_cnt + 1, false);
+      lock_release(&vmalloc_lock);
+      goto fail;
+    }
+    *lookup_pte(page_addr(start + i)) =
+        pte_create_kernel(kpage, true) | (cpu_has_pge ? PTE_G : 0);
+  }
+
+  return page_addr(start);
+
+fail:
+  if (flags & PAL_ASSERT)
+    PANIC("vmalloc: out of pages");
+  return NULL;
+}
+
+/* Frees the pages at VADDR, which must have been returned by
+   vmalloc().  The physical pages go back to the kernel pool at
+   once; the addresses become reusable at the next purge. */
+void vfree(void* vaddr) {
+  size_t start, page_cnt;
+  uint32_t* pte;
+
+  if (vaddr == NULL)
+    return;
+
+  ASSERT(pg_ofs(vaddr) == 0);
+  start = page_idx(vaddr);
+
+  /* Unmap pages up to the guard page. */
+  for (page_cnt = 0; (*(pte = lookup_pte(page_addr(start + page_cnt))) & PTE_P) != 0;
+       page_cnt++) {
+    palloc_free_page(pte_get_page(*pte));
+    *pte = 0;
+  }
+  ASSERT(page_cnt > 0);
+
+  lock_acquire(&vmalloc_lock);
+  ASSERT(bitmap_all(used_map, start, page_cnt + 1));
+  bitmap_set_multiple(lazy_map, start, page_cnt + 1, true);
+  lazy_cnt += page_cnt + 1;
+  if (lazy_cnt > LAZY_MAX)
+    purge();
+  lock_release(&vmalloc_lock);
+}
+
+/* Returns true if VADDR lies in the vmalloc range. */
+bool is_vmalloc_addr(const void* vaddr) {
+  return vaddr >= VMALLOC_START && vaddr < VMALLOC_END;
+}
+
+/* Flushes the TLB entries of all lazily freed pages and makes
+   their addresses available again.  The caller must hold
+   vmalloc_lock. */
+static void purge(void) {
+  size_t idx;
+
+  ASSERT(lock_held_by_current_thread(&vmalloc_lock));
+
+  if (lazy_cnt > INVLPG_MAX)
+    tlb_flush_global();
+  else
+    for (idx = bitmap_scan(lazy_map, 0, 1, true); idx != BITMAP_ERROR;
+         idx = bitmap_scan(lazy_map, idx + 1, 1, true))
+      asm volatile("invlpg (%0)" : : "r"(page_addr(idx)) : "memory");
+
+  for (idx = 0; idx < VMALLOC_PAGES; idx++)
+    if (bitmap_test(lazy_map, idx))
+      bitmap_reset(used_map, idx);
+  bitmap_set_all(lazy_map, false);
+  lazy_cnt = 0;
+}
@@ -0,0 +1,20 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/palloc.h"
+
+/* Kernel virtual range reserved for vmalloc().  It lies above
+   the linear mapping of physical memory, and its page tables are
+   created at boot in init_page_dir so that every process page
+   directory shares them. */
+#define VMALLOC_START ((void*)0xf0000000)
+#define VMALLOC_END ((void*)0xf2000000)
+
+void vmalloc_init(void);
+void* vmalloc(enum palloc_flags, size_t page_cnt);
+void vfree(void*);
+bool is_vmalloc_addr(const void*);
+
+#endif /* threads/vmalloc.h */
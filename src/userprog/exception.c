@@ -5,12 +5,16 @@
 #include "userprog/process.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill(struct intr_frame*);
 static void page_fault(struct intr_frame*);
+#ifdef VM
+static bool grow_stack(struct thread*, void* fault_addr, const void* esp);
+#endif
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -59,6 +63,9 @@ void exception_init(void) {
 /* Prints exception statistics. */
 void exception_print_stats(void) { printf("Exception: %lld page faults\n", page_fault_cnt); }
 
+/* Returns the number of page faults handled so far. */
+long long exception_page_faults(void) { return page_fault_cnt; }
+
 /* Handler for an exception (probably) caused by a user process. */
 static void kill(struct intr_frame* f) {
   /* This interrupt is one (probably) caused by a user process.
@@ -148,11 +155,61 @@ static void page_fault(struct intr_frame* f) {
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* 访问尚未载入的用户页面，无论是用户进程自己还是内核代表它访问，
+     都根据补充页表将页面载入，然后重新执行出错的指令
+     写入只读映射的共享页面同样由page_load()处理（写时复制） */
+  struct thread* t = thread_current();
+  struct process* pcb = t->pcb;
+  if ((not_present || write) && is_user_vaddr(fault_addr) && pcb != NULL &&
+      pcb->pagedir != NULL) {
+    if (page_load(&pcb->spt, pcb->pagedir, fault_addr, write))
+      return;
+    /* 用户态出错时使用中断帧中的栈指针，内核态出错时（系统调用访问用户缓冲区）
+       f->esp是内核栈指针，只能使用进入系统调用时保存的用户栈指针 */
+    if (not_present && grow_stack(t, fault_addr, user ? f->esp : t->user_esp))
+      return;
+  }
+#endif
+
 //   printf("Page fault at %p: %s error %s page in %s context.\n", fault_addr,
 //          not_present ? "not present" : "rights violation", write ? "writing" : "reading",
 //          user ? "user" : "kernel");
   kill(f);
 }
+
+#ifdef VM
+/**
+ * @brief 尝试为线程T扩展用户栈，使其覆盖FAULT_ADDR
+ *
+ * @details 每个线程的栈独占一个STACK_SIZE大小的栈槽，栈槽顶部的第一页
+ * 由setup_stack()登记，其余页面在第一次被访问时才登记并载入
+ *
+ * 只有同时满足以下条件的访问才被视为栈增长：
+ * 1. 位于T自己的栈槽中，并且不是栈槽最底部的一页。这一页永远不会被映射，
+ *    作为相邻两个线程栈之间的保护页，栈溢出会在这里触发Page Fault并杀死进程，
+ *    而不是悄悄改写下一个线程的栈。因此每个栈最多MAX_STACK_PAGES - 1页
+ * 2. 不低于ESP - 32，PUSHA指令会在修改esp之前访问esp下方32字节
+ *
+ * @param esp 出错时的用户栈指针，未知时为NULL
+ * @return true 栈已经扩展，可以重新执行出错的指令
+ * @return false 不是栈访问，或者内存不足
+ */
+static bool grow_stack(struct thread* t, void* fault_addr, const void* esp) {
+  struct process* pcb = t->pcb;
+  uint8_t* top = (uint8_t*)PHYS_BASE - t->stack_no * STACK_SIZE;
+  uint8_t* bottom = top - (MAX_STACK_PAGES - 1) * PGSIZE;
+  uint8_t* addr = fault_addr;
+  void* upage = pg_round_down(fault_addr);
+
+  if (esp == NULL || addr < bottom || addr >= top || addr + 32 < (const uint8_t*)esp)
+    return false;
+  if (!spt_add_zero(&pcb->spt, upage, true))
+    return false;
+  if (!page_load(&pcb->spt, pcb->pagedir, upage, true)) {
+    spt_remove(&pcb->spt, pcb->pagedir, upage);
+    return false;
+  }
+  return true;
+}
+#endif
@@ -6,7 +6,14 @@
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
-static void invalidate_pagedir(uint32_t*);
+static void invalidate_page(uint32_t*, const void*);
+static void load_pagedir(uint32_t*);
+
+/* Page directory currently loaded into CR3, updated by
+   load_pagedir().  Switching between threads that share an
+   address space need not reload CR3, which would flush the
+   TLB. */
+static uint32_t* loaded_pd;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -29,13 +36,17 @@ void pagedir_destroy(uint32_t* pd) {
 
   ASSERT(pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no(PHYS_BASE); pde++)
-    if (*pde & PTE_P) {
+    if (pde_is_large(*pde)) {
+      /* Large pages belong to the virtual memory code, which
+         frees them before the page directory. */
+      continue;
+    } else if (*pde & PTE_P) {
       uint32_t* pt = pde_get_pt(*pde);
       uint32_t* pte;
 
       for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
         if (*pte & PTE_P)
-          palloc_free_page(pte_get_page(*pte));
+          palloc_free_frame(pte_get_frame(*pte));
       palloc_free_page(pt);
     }
   palloc_free_page(pd);
@@ -46,7 +57,9 @@ void pagedir_destroy(uint32_t* pd) {
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   Addresses covered by a 4 MB page have no page table entry, so
+   a null pointer is returned for them in either case. */
 static uint32_t* lookup_page(uint32_t* pd, const void* vaddr, bool create) {
   uint32_t *pt, *pde;
 
@@ -58,6 +71,8 @@ static uint32_t* lookup_page(uint32_t* pd, const void* vaddr, bool create) {
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no(vaddr);
+  if (pde_is_large(*pde))
+    return NULL;
   if (*pde == 0) {
     if (create) {
       pt = palloc_get_page(PAL_ZERO);
@@ -85,19 +100,33 @@ static uint32_t* lookup_page(uint32_t* pd, const void* vaddr, bool create) {
    Returns true if successful, false if memory allocation
    failed. */
 bool pagedir_set_page(uint32_t* pd, void* upage, void* kpage, bool writable) {
+  ASSERT(pg_ofs(kpage) == 0);
+  ASSERT(vtop(kpage) >> PTSHIFT < init_ram_pages);
+
+  return pagedir_set_frame(pd, upage, vtop(kpage), writable);
+}
+
+/* Adds a mapping in page directory PD from user virtual page
+   UPAGE to the page frame at physical address FRAME, which may
+   lie in high memory.
+   UPAGE must not already be mapped.
+   FRAME should probably be obtained with palloc_get_frame().
+   If WRITABLE is true, the new page is read/write;
+   otherwise it is read-only.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool pagedir_set_frame(uint32_t* pd, void* upage, uintptr_t frame, bool writable) {
   uint32_t* pte;
 
   ASSERT(pg_ofs(upage) == 0);
-  ASSERT(pg_ofs(kpage) == 0);
   ASSERT(is_user_vaddr(upage));
-  ASSERT(vtop(kpage) >> PTSHIFT < init_ram_pages);
   ASSERT(pd != init_page_dir);
 
   pte = lookup_page(pd, upage, true);
 
   if (pte != NULL) {
     ASSERT((*pte & PTE_P) == 0);
-    *pte = pte_create_user(kpage, writable);
+    *pte = pte_create_user_frame(frame, writable);
     return true;
   } else
     return false;
@@ -119,6 +148,21 @@ void* pagedir_get_page(uint32_t* pd, const void* uaddr) {
     return NULL;
 }
 
+/* Looks up the physical address that corresponds to user virtual
+   address UADDR in PD.  Returns that physical address, which may
+   lie in high memory, or 0 if UADDR is unmapped. */
+uintptr_t pagedir_get_frame(uint32_t* pd, const void* uaddr) {
+  uint32_t* pte;
+
+  ASSERT(is_user_vaddr(uaddr));
+
+  pte = lookup_page(pd, uaddr, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    return pte_get_frame(*pte) + pg_ofs(uaddr);
+  else
+    return 0;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
@@ -132,10 +176,76 @@ void pagedir_clear_page(uint32_t* pd, void* upage) {
   pte = lookup_page(pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0) {
     *pte &= ~PTE_P;
-    invalidate_pagedir(pd);
+    invalidate_page(pd, upage);
   }
 }
 
+/* Maps the 4 MB of user virtual memory starting at UPAGE to the
+   4 MB of physical memory starting at FRAME with a single large
+   page in page directory PD.  Both addresses must be 4 MB
+   aligned, and CR4.PSE must be enabled.  No page in the range
+   may be mapped; a page table left over from earlier mappings
+   in the range is freed. */
+void pagedir_set_large(uint32_t* pd, void* upage, uintptr_t frame, bool writable) {
+  uint32_t* pde = pd + pd_no(upage);
+
+  ASSERT(((uintptr_t)upage & (PTSPAN - 1)) == 0);
+  ASSERT(is_user_vaddr(upage));
+  ASSERT(pd != init_page_dir);
+  ASSERT(!pde_is_large(*pde));
+
+  if (*pde & PTE_P) {
+    uint32_t* pt = pde_get_pt(*pde);
+    size_t i;
+
+    for (i = 0; i < PGSIZE / sizeof *pt; i++)
+      ASSERT((pt[i] & PTE_P) == 0);
+    palloc_free_page(pt);
+  }
+  *pde = pde_create_large_user(frame, writable);
+  invalidate_page(pd, upage);
+}
+
+/* Replaces the 4 MB page at UPAGE in page directory PD by a page
+   table that maps the same frames with 4 kB pages, each with the
+   large page's permissions and dirty bit.  Returns true if
+   successful, false if memory allocation failed, in which case
+   the large page is left in place. */
+bool pagedir_split_large(uint32_t* pd, void* upage) {
+  uint32_t* pde = pd + pd_no(upage);
+  uintptr_t frame;
+  uint32_t* pt;
+  size_t i;
+
+  ASSERT(((uintptr_t)upage & (PTSPAN - 1)) == 0);
+  ASSERT(pde_is_large(*pde));
+
+  pt = palloc_get_page(0);
+  if (pt == NULL)
+    return false;
+  frame = *pde & ~(uint32_t)(PTSPAN - 1);
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = pte_create_user_frame(frame + i * PGSIZE, (*pde & PTE_W) != 0) | (*pde & PTE_D);
+  *pde = pde_create(pt);
+
+  /* INVLPG on any address in a large page drops its whole
+     translation. */
+  invalidate_page(pd, upage);
+  return true;
+}
+
+/* Removes the 4 MB page at UPAGE from page directory PD.  The
+   frames it mapped are not freed. */
+void pagedir_clear_large(uint32_t* pd, void* upage) {
+  uint32_t* pde = pd + pd_no(upage);
+
+  ASSERT(((uintptr_t)upage & (PTSPAN - 1)) == 0);
+  ASSERT(pde_is_large(*pde));
+
+  *pde = 0;
+  invalidate_page(pd, upage);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -154,7 +264,7 @@ void pagedir_set_dirty(uint32_t* pd, const void* vpage, bool dirty) {
       *pte |= PTE_D;
     else {
       *pte &= ~(uint32_t)PTE_D;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
@@ -177,23 +287,20 @@ void pagedir_set_accessed(uint32_t* pd, const void* vpage, bool accessed) {
       *pte |= PTE_A;
     else {
       *pte &= ~(uint32_t)PTE_A;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register.  Does nothing if PD is already loaded, so switching
+   between threads of the same process keeps the TLB warm. */
 void pagedir_activate(uint32_t* pd) {
   if (pd == NULL)
     pd = init_page_dir;
 
-  /* Store the physical address of the page directory into CR3
-     aka PDBR (page directory base register).  This activates our
-     new page tables immediately.  See [IA32-v2a] "MOV--Move
-     to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-     Address of the Page Directory". */
-  asm volatile("movl %0, %%cr3" : : "r"(vtop(pd)) : "memory");
+  if (pd != loaded_pd)
+    load_pagedir(pd);
 }
 
 /* Returns the currently active page directory. */
@@ -207,18 +314,32 @@ uint32_t* active_pd(void) {
   return ptov(pd);
 }
 
+/* Unconditionally loads PD into CR3, flushing all non-global
+   TLB entries. */
+static void load_pagedir(uint32_t* pd) {
+  /* Store the physical address of the page directory into CR3
+     aka PDBR (page directory base register).  This activates our
+     new page tables immediately.  See [IA32-v2a] "MOV--Move
+     to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
+     Address of the Page Directory". */
+  loaded_pd = pd;
+  asm volatile("movl %0, %%cr3" : : "r"(vtop(pd)) : "memory");
+}
+
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
-
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
-static void invalidate_pagedir(uint32_t* pd) {
-  if (active_pd() == pd) {
-    /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-    pagedir_activate(pd);
-  }
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page that changed.
+
+   This function invalidates VADDR's TLB entry if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything: user translations are never global, so the CR3
+   load that made another directory active dropped them.)
+   INVLPG only drops one entry, unlike re-activating PD, so the
+   rest of the TLB survives.  See [IA32-v3a] 3.12 "Translation
+   Lookaside Buffers (TLBs)". */
+static void invalidate_page(uint32_t* pd, const void* vaddr) {
+  if (loaded_pd == pd)
+    asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
 }
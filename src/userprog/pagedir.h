@@ -8,7 +8,12 @@ uint32_t* pagedir_create(void);
 void pagedir_destroy(uint32_t* pd);
 bool pagedir_set_page(uint32_t* pd, void* upage, void* kpage, bool rw);
 void* pagedir_get_page(uint32_t* pd, const void* upage);
+bool pagedir_set_frame(uint32_t* pd, void* upage, uintptr_t frame, bool rw);
+uintptr_t pagedir_get_frame(uint32_t* pd, const void* upage);
 void pagedir_clear_page(uint32_t* pd, void* upage);
+void pagedir_set_large(uint32_t* pd, void* upage, uintptr_t frame, bool rw);
+bool pagedir_split_large(uint32_t* pd, void* upage);
+void pagedir_clear_large(uint32_t* pd, void* upage);
 bool pagedir_is_dirty(uint32_t* pd, const void* upage);
 void pagedir_set_dirty(uint32_t* pd, const void* upage, bool dirty);
 bool pagedir_is_accessed(uint32_t* pd, const void* upage);
@@ -3,7 +3,13 @@
 
 #include "threads/thread.h"
 #include "filesys/filesys.h"
+#include <radix.h>
 #include <stdint.h>
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+#endif
 
 // At most 8MB can be allocated to the stack
 // These defines will be used in Project 2: Multithreading
@@ -26,16 +32,16 @@ enum exiting_status {
   EXITING_NORMAL, /* 执行系统调用exit触发的退出事件 可能位于退出进程的后半段 */
   EXITING_EXCEPTION /* 进程已因异常退出（此事件废弃，现在的系统已不可能出现此事件） */
 };
+/* 用户锁注册项，以lid的地址为键存放在locks_tab中 */
 struct registered_lock {
-  lock_t* lid;           /* 锁的标识符 */
-  struct lock lock;      /* 锁本身 */
-  struct list_elem elem; /* List element */
+  lock_t* lid;      /* 锁的标识符 */
+  struct lock lock; /* 锁本身 */
 };
 
+/* 用户信号量注册项，以sid的地址为键存放在semas_tab中 */
 struct registered_sema {
   sema_t* sid;           /* 信号量的标识符 */
   struct semaphore sema; /* 信号量本身 */
-  struct list_elem elem; /* List element */
 };
 
 /* 文件描述符表元素 
@@ -179,10 +185,10 @@ struct process {
   struct semaphore* filesys_sema; /* 全局文件系统信号量指针 */
   uint32_t files_next_desc;       /* 下一文件描述符 */
 
-  struct rw_lock locks_lock; /* 进程用户空间锁列表读写锁 */
-  struct list locks_tab;     /* 进程用户空间锁列表 */
-  struct rw_lock semas_lock; /* 进程用户空间信号量列表读写锁 */
-  struct list semas_tab;     /* 进程用户空间信号量列表 */
+  struct rw_lock locks_lock;    /* 进程用户空间锁表读写锁 */
+  struct radix_tree locks_tab;  /* 进程用户空间锁表（基数树，键为lid） */
+  struct rw_lock semas_lock;    /* 进程用户空间信号量表读写锁 */
+  struct radix_tree semas_tab;  /* 进程用户空间信号量表（基数树，键为sid） */
 
   // 线程系统相关
   struct rw_lock threads_lock; /* 线程队列读写锁 */
@@ -195,11 +201,24 @@ struct process {
   uint32_t active_threads;       /* 有多少线程位于尚未退出中？ */
 
   struct thread* main_thread; /* Pointer to main thread */
+
+#ifdef VM
+  struct spt spt; /* 补充页表，记录尚未载入的页面如何载入 */
+
+  struct list maps_tab;  /* 元素是内存映射表项，也就是struct mapping */
+  struct lock maps_lock; /* 内存映射表与共享内存附加表的锁 */
+  mapid_t maps_next_id;  /* 下一映射标识符 */
+  struct list shm_tab;   /* 元素是共享内存段的附加记录，也就是struct attachment */
+#endif
 };
 
 void userprog_init(void);
 
 pid_t process_execute(const char* file_name);
+#ifdef VM
+struct intr_frame;
+pid_t process_fork(const struct intr_frame*);
+#endif
 bool setup_stack(void**, void*);
 int process_wait(pid_t);
 
@@ -13,6 +13,7 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/highmem.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
@@ -22,6 +23,9 @@
 #include "threads/vaddr.h"
 #include "userprog/filesys_lock.h"
 #include "bitmap.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
 
 /* 用于在父子用户进程之间传递参数的 */
 struct init_pcb {
@@ -30,6 +34,12 @@ struct init_pcb {
   struct semaphore* editing;
   char* cmd_line;
   bool processed; /* 是否处理过 cmd_line*/
+#ifdef VM
+  const struct intr_frame* fork_frame; /* fork()的调用者的中断帧，exec时为NULL */
+  struct thread* forker;               /* 调用fork()的线程 */
+  size_t rss_soft;                     /* 继承自父进程的驻留集软上限 */
+  size_t rss_hard;                     /* 继承自父进程的驻留集硬上限 */
+#endif
 };
 
 struct semaphore* filesys_sema = NULL; /* 定义全局临时文件系统锁 */
@@ -37,6 +47,13 @@ struct semaphore* filesys_sema = NULL; /* 定义全局临时文件系统锁 */
 static bool load(const char* file_name, void (**eip)(void), void** esp);
 static void init_process(struct process* new_pcb, struct init_pcb* init_pcb);
 static thread_func start_process NO_RETURN;
+static struct child_process* add_child(struct process* pcb);
+#ifdef VM
+static thread_func start_fork NO_RETURN;
+static bool fork_files(struct process* child, struct process* parent);
+static bool fork_syncs(struct process* child, struct process* parent, struct thread* forker);
+static void fork_cleanup(struct process* child);
+#endif
 
 /* Initializes user programs in the system by ensuring the main
    thread has a minimal PCB so that it can execute and wait for
@@ -111,7 +128,6 @@ pid_t process_execute(const char* file_name) {
   char* fn_copy;
   tid_t tid;
   struct process* pcb = thread_current()->pcb;
-  struct list* children = &(pcb->children);
   struct lock* children_lock = &(pcb->children_lock);
 
   // 文件全局信号量？
@@ -124,35 +140,24 @@ pid_t process_execute(const char* file_name) {
 
   bool success = false;
   /* 向自己的进程表中加入新进程 */
-  struct child_process* child_elem = NULL;
-  malloc_type(child_elem);
+  struct child_process* child_elem = add_child(pcb);
   success = child_elem != NULL;
   if (!success) {
+    palloc_free_page(fn_copy);
     return TID_ERROR;
   }
-  sema_init(&(child_elem->waiting), 0);
-  child_elem->pid = -1;
-  child_elem->child = NULL;
-  child_elem->exited = false;
-  child_elem->exited_code = -2; /* 初始退出码为-2 */
-  lock_acquire(children_lock);
-  list_push_front(children, &(child_elem->elem));
-  lock_release(children_lock);
-  malloc_type(child_elem->editing);
-  success = child_elem->editing != NULL;
-  if (!success) {
-    free(child_elem);
-    return TID_ERROR;
-  }
-  sema_init(child_elem->editing, 1);
 
   /* 初始化init_pcb（即start_process的参数） */
   struct init_pcb* init_pcb_ = NULL;
   malloc_type(init_pcb_);
   success = success && init_pcb_ != NULL;
   if (!success) {
+    lock_acquire(children_lock);
+    list_remove(&(child_elem->elem));
+    lock_release(children_lock);
     free(child_elem->editing);
     free(child_elem);
+    palloc_free_page(fn_copy);
     return TID_ERROR;
   }
   success = init_pcb_ != NULL;
@@ -160,6 +165,12 @@ pid_t process_execute(const char* file_name) {
   init_pcb_->self = child_elem;
   init_pcb_->parent = pcb;
   init_pcb_->cmd_line = fn_copy;
+#ifdef VM
+  init_pcb_->fork_frame = NULL;
+  init_pcb_->forker = NULL;
+  init_pcb_->rss_soft = pcb->spt.rss_soft;
+  init_pcb_->rss_hard = pcb->spt.rss_hard;
+#endif
 
   /* file_name的第一个空格设置为\0 拷贝系统调用参数到内核 */
   strlcpy(fn_copy, file_name, PGSIZE);
@@ -415,6 +426,313 @@ done:
   NOT_REACHED();
 }
 
+/**
+ * @brief 新建一个子进程表元素，加入PCB的子进程表
+ *
+ * @return struct child_process* 内存不足时返回NULL
+ */
+static struct child_process* add_child(struct process* pcb) {
+  struct child_process* child_elem = NULL;
+
+  malloc_type(child_elem);
+  if (child_elem == NULL)
+    return NULL;
+  malloc_type(child_elem->editing);
+  if (child_elem->editing == NULL) {
+    free(child_elem);
+    return NULL;
+  }
+  sema_init(child_elem->editing, 1);
+  sema_init(&(child_elem->waiting), 0);
+  child_elem->pid = -1;
+  child_elem->child = NULL;
+  child_elem->exited = false;
+  child_elem->exited_code = -2; /* 初始退出码为-2 */
+
+  lock_acquire(&(pcb->children_lock));
+  list_push_front(&(pcb->children), &(child_elem->elem));
+  lock_release(&(pcb->children_lock));
+  return child_elem;
+}
+
+#ifdef VM
+/**
+ * @brief 复制当前进程，子进程从IF_处返回，fork()在子进程中返回0
+ *
+ * @details 与process_execute()一样，子进程在start_fork()中初始化完毕之前
+ * editing一直保持为0，handler_fork()借此等待子进程完成复制，
+ * 在此之前IF_（位于调用者的内核栈上）一直有效
+ *
+ * 子进程只有一个线程，即调用fork()的线程的副本，它继承该线程的栈槽
+ *
+ * @param if_ 调用者进入系统调用时的中断帧
+ * @return pid_t 子进程的ID，创建线程失败时返回TID_ERROR
+ */
+pid_t process_fork(const struct intr_frame* if_) {
+  struct thread* t = thread_current();
+  struct process* pcb = t->pcb;
+  struct child_process* child_elem;
+  struct init_pcb* init_pcb_ = NULL;
+  tid_t tid;
+
+  child_elem = add_child(pcb);
+  if (child_elem == NULL)
+    return TID_ERROR;
+  malloc_type(init_pcb_);
+  if (init_pcb_ == NULL)
+    goto fail;
+  init_pcb_->parent = pcb;
+  init_pcb_->self = child_elem;
+  init_pcb_->editing = child_elem->editing;
+  init_pcb_->cmd_line = NULL;
+  init_pcb_->processed = false;
+  init_pcb_->fork_frame = if_;
+  init_pcb_->forker = t;
+  init_pcb_->rss_soft = pcb->spt.rss_soft;
+  init_pcb_->rss_hard = pcb->spt.rss_hard;
+
+  sema_down(child_elem->editing);
+  tid = thread_create(pcb->process_name, PRI_DEFAULT, start_fork, init_pcb_);
+  child_elem->pid = tid;
+  if (tid != TID_ERROR)
+    return tid;
+
+  sema_up(child_elem->editing);
+  free(init_pcb_);
+fail:
+  lock_acquire(&(pcb->children_lock));
+  list_remove(&(child_elem->elem));
+  lock_release(&(pcb->children_lock));
+  free(child_elem->editing);
+  free(child_elem);
+  return TID_ERROR;
+}
+
+/**
+ * @brief fork()出的子进程的线程函数：复制父进程的地址空间、文件描述符表、
+ * 用户锁和信号量，随后从父进程的中断帧返回用户态
+ *
+ * @details 父进程的页面以写时复制的方式共享（spt_fork()），
+ * 其他线程的栈在子进程中不存在，因此也不被继承
+ * 内存映射文件同样不被继承
+ */
+static void start_fork(void* init_pcb_) {
+  struct init_pcb* init_pcb = (struct init_pcb*)init_pcb_;
+  struct child_process* self = init_pcb->self;
+  struct semaphore* editing = init_pcb->editing;
+  struct process* parent = init_pcb->parent;
+  struct thread* forker = init_pcb->forker;
+  struct thread* t = thread_current();
+  struct intr_frame if_;
+  struct process* new_pcb;
+  bool success = false;
+
+  /* 父进程阻塞在handler_fork()中，其中断帧依然有效 */
+  memcpy(&if_, init_pcb->fork_frame, sizeof if_);
+  if_.eax = 0;
+
+  new_pcb = malloc(sizeof(struct process));
+  if (new_pcb == NULL)
+    goto done;
+  init_process(new_pcb, init_pcb);
+  new_pcb->exec = NULL;
+  new_pcb->stacks = bitmap_create(MAX_THREADS);
+  new_pcb->pagedir = pagedir_create();
+  if (new_pcb->stacks == NULL || new_pcb->pagedir == NULL)
+    goto fail;
+
+  sema_down(filesys_sema);
+  new_pcb->exec = file_reopen(parent->exec);
+  if (new_pcb->exec != NULL)
+    file_deny_write(new_pcb->exec);
+  sema_up(filesys_sema);
+  if (new_pcb->exec == NULL)
+    goto fail;
+
+  if (!spt_fork(&new_pcb->spt, new_pcb->pagedir, &parent->spt, parent->pagedir, new_pcb->exec))
+    goto fail;
+
+  /* 只保留调用fork()的线程的栈槽 */
+  lock_acquire(&parent->pcb_lock);
+  for (size_t i = 0; i < MAX_THREADS; i++)
+    if (i != forker->stack_no && bitmap_test(parent->stacks, i)) {
+      uint8_t* top = (uint8_t*)PHYS_BASE - i * STACK_SIZE;
+      spt_remove_range(&new_pcb->spt, new_pcb->pagedir, top - STACK_SIZE, top);
+    }
+  lock_release(&parent->pcb_lock);
+  bitmap_set(new_pcb->stacks, forker->stack_no, true);
+  t->stack_no = forker->stack_no;
+
+  success = fork_files(new_pcb, parent) && fork_syncs(new_pcb, parent, forker);
+
+fail:
+  if (!success) {
+    fork_cleanup(new_pcb);
+    t->pcb = NULL;
+    free(new_pcb);
+    free_parent_self(self, -1);
+  }
+done:
+  free(init_pcb);
+  if (!success) {
+    /* 与start_process()相同，exited==false且exited_code==-1表示初始化失败 */
+    self->exited = false;
+    sema_up(editing);
+    thread_exit();
+    NOT_REACHED();
+  }
+  self->pid = t->tid;
+  self->child = t->pcb;
+  self->exited = false;
+  sema_up(editing);
+
+  process_activate();
+  asm volatile("movl %0, %%esp ; jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED();
+}
+
+/**
+ * @brief 复制父进程的文件描述符表，描述符的编号与文件位置保持不变
+ *
+ * @details 每个描述符都重新打开一次，此后父子进程的读写位置互不影响
+ */
+static bool fork_files(struct process* child, struct process* parent) {
+  struct file_desc* pos = NULL;
+  bool success = true;
+
+  lock_acquire(&parent->files_lock);
+  sema_down(filesys_sema);
+  list_for_each_entry(pos, &parent->files_tab, elem) {
+    struct file_desc* copy = malloc(sizeof(struct file_desc));
+    if (copy == NULL) {
+      success = false;
+      break;
+    }
+    copy->file = file_reopen(pos->file);
+    if (copy->file == NULL) {
+      free(copy);
+      success = false;
+      break;
+    }
+    rw_lock_acquire(&pos->lock, RW_READER);
+    file_seek(copy->file, file_tell(pos->file));
+    rw_lock_release(&pos->lock, RW_READER);
+    rw_lock_init(&copy->lock);
+    copy->file_desc = pos->file_desc;
+    list_push_back(&child->files_tab, &copy->elem);
+  }
+  child->files_next_desc = parent->files_next_desc;
+  sema_up(filesys_sema);
+  lock_release(&parent->files_lock);
+  return success;
+}
+
+/**
+ * @brief 复制父进程注册的用户锁与信号量
+ *
+ * @details 信号量保留当前的值；FORKER持有的锁在子进程中由其主线程持有，
+ * 其他线程持有的锁在子进程中是未被持有的，因为这些线程并不存在
+ * FORKER阻塞在fork()中，不会在此期间获取或释放锁
+ */
+static bool fork_syncs(struct process* child, struct process* parent, struct thread* forker) {
+  void* batch[16];
+  unsigned long indexes[16];
+  unsigned long first;
+  size_t cnt, i;
+  bool success = true;
+
+  rw_lock_acquire(&parent->locks_lock, RW_READER);
+  first = 0;
+  do {
+    cnt = radix_gang_lookup(&parent->locks_tab, first, 16, batch, indexes);
+    for (i = 0; i < cnt && success; i++) {
+      struct registered_lock* lock_pos = batch[i];
+      struct registered_lock* copy = NULL;
+
+      malloc_type(copy);
+      success = copy != NULL;
+      if (!success)
+        break;
+      copy->lid = lock_pos->lid;
+      lock_init(&copy->lock);
+      success = radix_insert(&child->locks_tab, indexes[i], copy);
+      if (!success)
+        free(copy);
+      else if (lock_pos->lock.holder == forker)
+        lock_acquire(&copy->lock);
+    }
+    if (cnt > 0)
+      first = indexes[cnt - 1] + 1;
+  } while (success && cnt == 16);
+  rw_lock_release(&parent->locks_lock, RW_READER);
+  if (!success)
+    return false;
+
+  rw_lock_acquire(&parent->semas_lock, RW_READER);
+  first = 0;
+  do {
+    cnt = radix_gang_lookup(&parent->semas_tab, first, 16, batch, indexes);
+    for (i = 0; i < cnt && success; i++) {
+      struct registered_sema* sema_pos = batch[i];
+      struct registered_sema* copy = NULL;
+
+      malloc_type(copy);
+      success = copy != NULL;
+      if (!success)
+        break;
+      copy->sid = sema_pos->sid;
+      sema_init(&copy->sema, sema_pos->sema.value);
+      success = radix_insert(&child->semas_tab, indexes[i], copy);
+      if (!success)
+        free(copy);
+    }
+    if (cnt > 0)
+      first = indexes[cnt - 1] + 1;
+  } while (success && cnt == 16);
+  rw_lock_release(&parent->semas_lock, RW_READER);
+  return success;
+}
+
+/* 释放复制失败的用户锁注册项，作为radix_destroy的回调 */
+static void free_forked_lock(unsigned long index UNUSED, void* item, void* aux UNUSED) {
+  struct registered_lock* lock_pos = item;
+
+  if (lock_held_by_current_thread(&lock_pos->lock))
+    lock_release(&lock_pos->lock);
+  free(lock_pos);
+}
+
+/* 释放复制失败的用户信号量注册项，作为radix_destroy的回调 */
+static void free_forked_sema(unsigned long index UNUSED, void* item, void* aux UNUSED) {
+  free(item);
+}
+
+/**
+ * @brief 释放start_fork()中已经复制的资源，CHILD本身由调用者释放
+ */
+static void fork_cleanup(struct process* child) {
+  uint32_t* pd = child->pagedir;
+  struct file_desc* file_pos = NULL;
+
+  if (pd != NULL) {
+    /* 与进程退出时一样，先切换回内核页目录再销毁 */
+    child->pagedir = NULL;
+    pagedir_activate(NULL);
+    spt_destroy(&child->spt, pd);
+    pagedir_destroy(pd);
+  }
+  list_clean_each(file_pos, &(child->files_tab), elem, {
+    file_close(file_pos->file);
+    free(file_pos);
+  });
+  radix_destroy(&child->locks_tab, free_forked_lock, NULL);
+  radix_destroy(&child->semas_tab, free_forked_sema, NULL);
+  file_close(child->exec);
+  if (child->stacks != NULL)
+    bitmap_destroy(child->stacks);
+}
+#endif
+
 /* Waits for process with PID child_pid to die and returns its exit status.
    If it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If child_pid is invalid or if it was not a
@@ -640,7 +958,9 @@ done:
 
 /* load() helpers. */
 
-static bool install_page(void* upage, void* kpage, bool writable);
+#ifndef VM
+static bool install_page(void* upage, uintptr_t frame, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -705,7 +1025,9 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek(file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) {
     /* Calculate how to fill this page.
          We will read PAGE_READ_BYTES bytes from FILE
@@ -713,23 +1035,35 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
     size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+    /* 只在补充页表中登记，第一次访问时才由page_fault()载入 */
+    struct spt* spt = &thread_current()->pcb->spt;
+    if (!(page_read_bytes > 0 ? spt_add_file(spt, upage, file, ofs, page_read_bytes, writable)
+                              : spt_add_zero(spt, upage, writable)))
+      return false;
+    ofs += page_read_bytes;
+#else
+
     /* Get a page of memory. */
-    uint8_t* kpage = palloc_get_page(PAL_USER);
-    if (kpage == NULL)
+    uintptr_t frame = palloc_get_frame(PAL_USER);
+    uint8_t* kpage;
+    bool loaded;
+    if (frame == 0)
       return false;
 
     /* Load this page. */
-    if (file_read(file, kpage, page_read_bytes) != (int)page_read_bytes) {
-      palloc_free_page(kpage);
-      return false;
-    }
-    memset(kpage + page_read_bytes, 0, page_zero_bytes);
+    kpage = kmap(frame);
+    loaded = file_read(file, kpage, page_read_bytes) == (int)page_read_bytes;
+    if (loaded)
+      memset(kpage + page_read_bytes, 0, page_zero_bytes);
+    kunmap(kpage);
 
     /* Add the page to the process's address space. */
-    if (!install_page(upage, kpage, writable)) {
-      palloc_free_page(kpage);
+    if (!loaded || !install_page(upage, frame, writable)) {
+      palloc_free_frame(frame);
       return false;
     }
+#endif
 
     /* Advance. */
     read_bytes -= page_read_bytes;
@@ -742,7 +1076,9 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
 /* Create a minimal stack by mapping a zeroed page begin from 
    the TOP of user virtual memory. */
 bool setup_stack(void** esp, void* top) {
-  uint8_t* kpage;
+#ifndef VM
+  uintptr_t frame;
+#endif
   bool success = false;
 
   enum intr_level old_level = intr_disable();
@@ -751,14 +1087,23 @@ bool setup_stack(void** esp, void* top) {
     goto done;
   }
 #endif
-  kpage = palloc_get_page(PAL_USER | PAL_ZERO);
-  if (kpage != NULL) {
-    success = install_page(((uint8_t*)top) - PGSIZE, kpage, true);
+#ifdef VM
+  /* 栈顶的第一页只登记不载入，随后写入参数时才由Page Fault载入
+     栈槽中的其余页面由page_fault()按需登记，参见exception.c中的grow_stack() */
+  struct process* pcb = thread_current()->pcb;
+  success = spt_add_zero(&pcb->spt, ((uint8_t*)top) - PGSIZE, true);
+  if (success)
+    *esp = top;
+#else
+  frame = palloc_get_frame(PAL_USER | PAL_ZERO);
+  if (frame != 0) {
+    success = install_page(((uint8_t*)top) - PGSIZE, frame, true);
     if (success)
       *esp = top;
     else
-      palloc_free_page(kpage);
+      palloc_free_frame(frame);
   }
+#endif
 #ifdef USERPROG
 done:
 #endif
@@ -767,23 +1112,25 @@ done:
   return success;
 }
 
-/* Adds a mapping from user virtual address UPAGE to kernel
-   virtual address KPAGE to the page table.
+#ifndef VM
+/* Adds a mapping from user virtual address UPAGE to the page
+   frame at physical address FRAME to the page table.
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   FRAME should probably be a user frame obtained with
+   palloc_get_frame().
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
-static bool install_page(void* upage, void* kpage, bool writable) {
+static bool install_page(void* upage, uintptr_t frame, bool writable) {
   struct thread* t = thread_current();
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page(t->pcb->pagedir, upage) == NULL &&
-          pagedir_set_page(t->pcb->pagedir, upage, kpage, writable));
+  return (pagedir_get_frame(t->pcb->pagedir, upage) == 0 &&
+          pagedir_set_frame(t->pcb->pagedir, upage, frame, writable));
 }
+#endif
 
 /* Returns true if t is the main thread of the process p */
 bool is_main_thread(struct thread* t, struct process* p) { return p->main_thread == t; }
@@ -859,11 +1206,26 @@ static void init_process(struct process* new_pcb, struct init_pcb* init_pcb) {
 
   // 初始化进程锁列表
   rw_lock_init(&new_pcb->locks_lock);
-  list_init(&(new_pcb->locks_tab));
+  radix_init(&(new_pcb->locks_tab));
 
   // 初始化进程信号量列表
   rw_lock_init(&new_pcb->semas_lock);
-  list_init(&(new_pcb->semas_tab));
+  radix_init(&(new_pcb->semas_tab));
+
+#ifdef VM
+  // 初始化补充页表
+  spt_init(&new_pcb->spt);
+  /* 驻留集上限像ulimit一样由exec和fork的子进程继承 */
+  frame_set_limits(&new_pcb->spt, init_pcb->rss_soft, init_pcb->rss_hard);
+
+  // 初始化内存映射表
+  list_init(&new_pcb->maps_tab);
+  lock_init(&new_pcb->maps_lock);
+  new_pcb->maps_next_id = 0;
+
+  // 初始化共享内存附加表
+  list_init(&new_pcb->shm_tab);
+#endif
 
   // 初始化线程系统相关字段
   list_init(&(new_pcb->threads));
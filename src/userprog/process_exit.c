@@ -39,6 +39,7 @@ inline static void set_exit_code(struct process *, int32_t);
 inline static void exit_helper(struct thread *, struct list *, bool);
 inline static void exit_helper_remove_from_list(struct thread *);
 static void pthread_exit(void);
+static void free_registered(unsigned long, void *, void *);
 
 /**
  * @brief 执行退出检查或直接退出
@@ -140,8 +141,13 @@ static void pthread_exit(void) {
   /* 释放pos的用户栈 */
   void *stack = ((void *)PHYS_BASE - t->stack_no * STACK_SIZE) - PGSIZE;
   bitmap_set(t->pcb->stacks, t->stack_no, false);
-  palloc_free_page(pagedir_get_page(t->pcb->pagedir, stack));
+#ifdef VM
+  /* 栈可能已经增长到了栈槽中的多个页面 */
+  spt_remove_range(&t->pcb->spt, t->pcb->pagedir, stack + PGSIZE - STACK_SIZE, stack + PGSIZE);
+#else
+  palloc_free_frame(pagedir_get_frame(t->pcb->pagedir, stack));
   pagedir_clear_page(t->pcb->pagedir, stack);
+#endif
   process_activate();
 
   t->pcb->active_threads--;
@@ -426,6 +432,10 @@ static NO_INLINE void process_exit_tail(struct process *pcb, struct thread *tcb)
          that's been freed (and cleared). */
     pcb_to_free->pagedir = NULL;
     pagedir_activate(NULL);
+#ifdef VM
+    /* 物理帧登记在帧表中，需要先通过补充页表释放 */
+    spt_destroy(&pcb_to_free->spt, pd);
+#endif
     pagedir_destroy(pd);
   }
 
@@ -462,19 +472,17 @@ static NO_INLINE void process_exit_tail(struct process *pcb, struct thread *tcb)
     file_close(file_pos->file);
     free(file_pos);
   });
+#ifdef VM
+  /* 被修改过的映射页已经在spt_destroy中写回 */
+  mmap_destroy(pcb_to_free);
+  shm_destroy(pcb_to_free);
+#endif
 
   while (!list_empty(&cur->lock_queue))
     list_pop_front(&cur->lock_queue);
 
-  if (!list_empty(&pcb_to_free->locks_tab)) {
-    struct registered_lock *lock_pos = NULL;
-    list_clean_each(lock_pos, &(pcb_to_free->locks_tab), elem, { free(lock_pos); });
-  }
-
-  if (!list_empty(&pcb_to_free->semas_tab)) {
-    struct registered_sema *sema_pos = NULL;
-    list_clean_each(sema_pos, &(pcb_to_free->semas_tab), elem, { free(sema_pos); });
-  }
+  radix_destroy(&pcb_to_free->locks_tab, free_registered, NULL);
+  radix_destroy(&pcb_to_free->semas_tab, free_registered, NULL);
 
   struct child_process *child = NULL;
   struct semaphore *child_editing = NULL;
@@ -507,6 +515,9 @@ static NO_INLINE void process_exit_tail(struct process *pcb, struct thread *tcb)
   thread_exit();
 }
 
+/* 释放用户锁、信号量注册项，作为radix_destroy的回调 */
+static void free_registered(unsigned long index UNUSED, void *item, void *aux UNUSED) { free(item); }
+
 /* 子进程退出时 由子进程清除父子共同资源 同时设置返回值*/
 void free_parent_self(struct child_process *self, int exit_code) {
   if (self->exited) {
@@ -9,6 +9,9 @@
 #include "threads/thread.h"
 #include "userprog/filesys_lock.h"
 #include "userprog/process.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
 #include <stdio.h>
 #include <syscall-nr.h>
 
@@ -28,6 +31,20 @@ static int handler_seek(uint32_t *args, struct process *pcb);
 static int handler_close(uint32_t *args, struct process *pcb);
 static int handler_tell(uint32_t *args, struct process *pcb);
 static double handler_compute_e(uint32_t *args, struct process *pcb);
+static pid_t check_child(pid_t pid, struct process *pcb);
+#ifdef VM
+static pid_t handler_fork(struct intr_frame *f, struct process *pcb);
+static mapid_t handler_mmap(uint32_t *args, struct process *pcb);
+static void handler_munmap(uint32_t *args, struct process *pcb);
+static shmid_t handler_shm_create(uint32_t *args, struct process *pcb);
+static void *handler_shm_attach(uint32_t *args, struct process *pcb);
+static bool handler_shm_detach(uint32_t *args, struct process *pcb);
+static bool handler_shm_remove(uint32_t *args, struct process *pcb);
+static bool handler_rss_limit(uint32_t *args, struct process *pcb);
+static bool handler_rss_stat(uint32_t *args, struct process *pcb);
+static bool handler_madvise(uint32_t *args, struct process *pcb);
+static bool handler_vm_stat(uint32_t *args, struct process *pcb);
+#endif
 
 /* Poj2 system call */
 static tid_t handler_pthread_create(stub_fun sfun, pthread_fun tfun, void *arg, struct process *pcb);
@@ -62,6 +79,9 @@ static void syscall_handler(struct intr_frame *f UNUSED) {
   uint32_t *args = ((uint32_t *)f->esp);
   struct process *pcb = thread_current()->pcb;
 
+  /* 内核代表用户访问栈上的缓冲区时可能触发栈增长，届时需要用户的栈指针 */
+  thread_current()->user_esp = f->esp;
+
   /*
    * The following print statement, if uncommented, will print out the syscall
    * number whenever a process enters a system call. You might find it useful
@@ -248,6 +268,84 @@ static void syscall_handler(struct intr_frame *f UNUSED) {
     f->eax = thread_current()->tid;
     break;
 
+#ifdef VM
+  case SYS_FORK:
+    f->eax = handler_fork(f, pcb);
+    break;
+
+  case SYS_MMAP:
+    beneath = check_boundary(args + 3);
+    if (beneath) {
+      f->eax = check_fd(args[1], pcb) ? handler_mmap(args, pcb) : MAP_FAILED;
+    }
+    break;
+
+  case SYS_MUNMAP:
+    beneath = check_boundary(args + 1);
+    if (beneath) {
+      handler_munmap(args, pcb);
+    }
+    break;
+
+  case SYS_SHM_CREATE:
+    beneath = check_boundary(args + 2);
+    if (beneath) {
+      f->eax = handler_shm_create(args, pcb);
+    }
+    break;
+
+  case SYS_SHM_ATTACH:
+    beneath = check_boundary(args + 2);
+    if (beneath) {
+      f->eax = (uint32_t)handler_shm_attach(args, pcb);
+    }
+    break;
+
+  case SYS_SHM_DETACH:
+    beneath = check_boundary(args + 1);
+    if (beneath) {
+      f->eax = handler_shm_detach(args, pcb);
+    }
+    break;
+
+  case SYS_SHM_REMOVE:
+    beneath = check_boundary(args + 1);
+    if (beneath) {
+      f->eax = handler_shm_remove(args, pcb);
+    }
+    break;
+
+  case SYS_RSS_LIMIT:
+    beneath = check_boundary(args + 2);
+    if (beneath) {
+      f->eax = handler_rss_limit(args, pcb);
+    }
+    break;
+
+  case SYS_RSS_STAT:
+    beneath = check_boundary(args + 1) && (void *)args[1] != NULL &&
+              check_buffer((void *)args[1], sizeof(struct rss_stat));
+    if (beneath) {
+      f->eax = handler_rss_stat(args, pcb);
+    }
+    break;
+
+  case SYS_MADVISE:
+    beneath = check_boundary(args + 3);
+    if (beneath) {
+      f->eax = handler_madvise(args, pcb);
+    }
+    break;
+
+  case SYS_VM_STAT:
+    beneath = check_boundary(args + 1) && (void *)args[1] != NULL &&
+              check_buffer((void *)args[1], sizeof(struct vm_stat));
+    if (beneath) {
+      f->eax = handler_vm_stat(args, pcb);
+    }
+    break;
+#endif
+
   default:
     printf("Unknown system call number: %d\n", args[0]);
     process_exit_normal(-1);
@@ -271,8 +369,12 @@ static double handler_compute_e(uint32_t *args, struct process *pcb) {
 }
 
 static pid_t handler_exec(uint32_t *args, struct process *pcb) {
+  return check_child(process_execute((const char *)args[1]), pcb);
+}
 
-  pid_t result = process_execute((const char *)args[1]);
+/* 等待刚刚创建的子进程PID完成初始化，初始化失败时将其移出子进程表并返回-1 */
+static pid_t check_child(pid_t pid, struct process *pcb) {
+  pid_t result = pid;
   if (result == -1) {
     /* 线程初始化失败 */
     return result;
@@ -484,9 +586,17 @@ static int handler_read(uint32_t *args, struct process *pcb) {
   lock_release(files_tab_lock);
 
   if (found) {
+#ifdef VM
+    /* 读盘期间用户缓冲区不能被换出；钉不住的话照常访问，出错时由page_fault处理 */
+    bool pinned = page_pin(&pcb->spt, pcb->pagedir, (void *)args[2], args[3], true);
+#endif
     rw_lock_acquire(&pos->lock, RW_READER);
     off = file_read(pos->file, (void *)args[2], args[3]);
     rw_lock_release(&pos->lock, RW_READER);
+#ifdef VM
+    if (pinned)
+      page_unpin(&pcb->spt, (void *)args[2], args[3]);
+#endif
   }
   return off;
 }
@@ -516,13 +626,126 @@ static int handler_write(uint32_t *args, struct process *pcb) {
   lock_release(files_tab_lock);
 
   if (found) {
+#ifdef VM
+    bool pinned = page_pin(&pcb->spt, pcb->pagedir, (void *)args[2], args[3], false);
+#endif
     // rw_lock_acquire(&pos->lock, RW_WRITER);
     off = file_write(pos->file, (void *)args[2], args[3]);
     // rw_lock_release(&pos->lock, RW_WRITER);
+#ifdef VM
+    if (pinned)
+      page_unpin(&pcb->spt, (void *)args[2], args[3]);
+#endif
   }
   return off;
 }
 
+#ifdef VM
+/**
+ * @brief 复制当前进程，子进程中返回0
+ *
+ * @details 子进程从F的副本返回用户态，因此需要等它复制完成之后才能返回
+ */
+static pid_t handler_fork(struct intr_frame *f, struct process *pcb) {
+  return check_child(process_fork(f), pcb);
+}
+
+/**
+ * @brief 将文件描述符args[1]对应的文件映射到args[2]处，args[3]为MAP_*标志位
+ *
+ * @details 映射使用file_reopen得到的独立文件，此后关闭或者删除文件都不影响映射
+ */
+static mapid_t handler_mmap(uint32_t *args, struct process *pcb) {
+  uint32_t fd = args[1];
+  struct list *files_tab = &(pcb->files_tab);
+  struct lock *files_tab_lock = &(pcb->files_lock);
+  struct file_desc *pos = NULL;
+  struct file *file;
+  mapid_t id;
+
+  if (fd < 3) {
+    return MAP_FAILED;
+  }
+
+  bool found = false;
+  lock_acquire(files_tab_lock);
+  list_for_each_entry(pos, files_tab, elem) {
+    if (pos->file_desc == fd) {
+      found = true;
+      break;
+    }
+  }
+  lock_release(files_tab_lock);
+  if (!found) {
+    return MAP_FAILED;
+  }
+
+  rw_lock_acquire(&pos->lock, RW_READER);
+  file = file_reopen(pos->file);
+  rw_lock_release(&pos->lock, RW_READER);
+  if (file == NULL) {
+    return MAP_FAILED;
+  }
+
+  id = mmap_map(pcb, file, (void *)args[2], args[3]);
+  if (id == MAP_FAILED) {
+    file_close(file);
+  }
+  return id;
+}
+
+/* 撤销映射args[1]，不存在的映射直接忽略 */
+static void handler_munmap(uint32_t *args, struct process *pcb) { mmap_unmap(pcb, args[1]); }
+
+/* 创建或者找到键为args[1]、大小至少为args[2]字节的共享内存段 */
+static shmid_t handler_shm_create(uint32_t *args, struct process *pcb UNUSED) {
+  return shm_create((int)args[1], args[2]);
+}
+
+/* 将段args[1]附加到地址args[2]处，失败时返回NULL */
+static void *handler_shm_attach(uint32_t *args, struct process *pcb) {
+  return shm_attach(pcb, (shmid_t)args[1], (void *)args[2]);
+}
+
+/* 撤销附加在地址args[1]处的段 */
+static bool handler_shm_detach(uint32_t *args, struct process *pcb) {
+  return shm_detach(pcb, (void *)args[1]);
+}
+
+/* 删除段args[1]，已有的附加依然有效 */
+static bool handler_shm_remove(uint32_t *args, struct process *pcb UNUSED) {
+  return shm_remove((shmid_t)args[1]);
+}
+
+/* 将进程的驻留集软上限和硬上限设置为args[1]和args[2]页，0表示不限制 */
+static bool handler_rss_limit(uint32_t *args, struct process *pcb) {
+  return frame_set_limits(&pcb->spt, args[1], args[2]);
+}
+
+/* 将进程的驻留集统计数据复制到用户缓冲区args[1]中 */
+static bool handler_rss_stat(uint32_t *args, struct process *pcb) {
+  struct rss_stat st;
+
+  frame_get_rss(&pcb->spt, &st);
+  *(struct rss_stat *)args[1] = st;
+  return true;
+}
+
+/* 按照建议args[3]处理[args[1], args[1] + args[2])中的页面 */
+static bool handler_madvise(uint32_t *args, struct process *pcb) {
+  return page_advise(&pcb->spt, pcb->pagedir, (void *)args[1], args[2], (int)args[3]);
+}
+
+/* 将全系统的换页统计数据复制到用户缓冲区args[1]中 */
+static bool handler_vm_stat(uint32_t *args, struct process *pcb UNUSED) {
+  struct vm_stat st;
+
+  frame_get_vm_stat(&st);
+  *(struct vm_stat *)args[1] = st;
+  return true;
+}
+#endif
+
 static tid_t handler_pthread_create(stub_fun sfun, pthread_fun tfun, void *arg, struct process *pcb) {
   DISABLE_INTR({
     pcb->in_kernel_threads++;
@@ -558,24 +781,16 @@ static tid_t handler_pthread_join(tid_t tid, struct process *pcb) { return pthre
  */
 static bool handler_lock_init(lock_t *lock, struct process *pcb) {
   struct rw_lock *locks_lock = &(pcb->locks_lock);
-  struct list *locks_tab = &(pcb->locks_tab);
+  struct radix_tree *locks_tab = &(pcb->locks_tab);
 
   rw_lock_acquire(locks_lock, RW_WRITER);
 
-  struct registered_lock *lock_pos = NULL;
-  bool found = false;
-  list_for_each_entry(lock_pos, locks_tab, elem) {
-    if (lock_pos->lid == lock) {
-      found = true;
-      break;
-    }
-  }
-
-  if (found) {
+  if (radix_lookup(locks_tab, (unsigned long)lock) != NULL) {
     rw_lock_release(locks_lock, RW_WRITER);
     return false;
   }
 
+  struct registered_lock *lock_pos = NULL;
   malloc_type(lock_pos);
   barrier();
 
@@ -586,7 +801,11 @@ static bool handler_lock_init(lock_t *lock, struct process *pcb) {
 
   lock_pos->lid = lock;
   lock_init(&(lock_pos->lock));
-  list_push_front(locks_tab, &(lock_pos->elem));
+  if (!radix_insert(locks_tab, (unsigned long)lock, lock_pos)) {
+    free(lock_pos);
+    rw_lock_release(locks_lock, RW_WRITER);
+    return false;
+  }
 
   rw_lock_release(locks_lock, RW_WRITER);
 
@@ -603,19 +822,11 @@ static bool handler_lock_init(lock_t *lock, struct process *pcb) {
  */
 static bool handler_lock_acquire(lock_t *lock, struct process *pcb) {
   struct rw_lock *locks_lock = &(pcb->locks_lock);
-  struct list *locks_tab = &(pcb->locks_tab);
   rw_lock_acquire(locks_lock, RW_READER);
 
-  struct registered_lock *lock_pos = NULL;
-  bool found = false;
-  list_for_each_entry(lock_pos, locks_tab, elem) {
-    if (lock_pos->lid == lock) {
-      found = true;
-      break;
-    }
-  }
+  struct registered_lock *lock_pos = radix_lookup(&(pcb->locks_tab), (unsigned long)lock);
 
-  if (!found || lock_held_by_current_thread(&lock_pos->lock)) {
+  if (lock_pos == NULL || lock_held_by_current_thread(&lock_pos->lock)) {
     rw_lock_release(locks_lock, RW_READER);
     return false;
   }
@@ -635,19 +846,11 @@ static bool handler_lock_acquire(lock_t *lock, struct process *pcb) {
  */
 static bool handler_lock_release(lock_t *lock, struct process *pcb) {
   struct rw_lock *locks_lock = &(pcb->locks_lock);
-  struct list *locks_tab = &(pcb->locks_tab);
   rw_lock_acquire(locks_lock, RW_READER);
 
-  struct registered_lock *lock_pos = NULL;
-  bool found = false;
-  list_for_each_entry(lock_pos, locks_tab, elem) {
-    if (lock_pos->lid == lock) {
-      found = true;
-      break;
-    }
-  }
+  struct registered_lock *lock_pos = radix_lookup(&(pcb->locks_tab), (unsigned long)lock);
 
-  if (!found || !lock_held_by_current_thread(&(lock_pos->lock))) {
+  if (lock_pos == NULL || !lock_held_by_current_thread(&(lock_pos->lock))) {
     rw_lock_release(locks_lock, RW_READER);
     return false;
   }
@@ -660,24 +863,21 @@ static bool handler_lock_release(lock_t *lock, struct process *pcb) {
 static bool handler_sema_init(sema_t *sema, int val, struct process *pcb) {
   if (val < 0)
     return false;
+#ifdef VM
+  /* 位于共享内存段中的信号量登记在段中，所有附加者共用 */
+  if (shm_contains(pcb, sema))
+    return shm_sema_init(pcb, sema, val);
+#endif
   struct rw_lock *semas_lock = &(pcb->semas_lock);
-  struct list *semas_tab = &(pcb->semas_tab);
+  struct radix_tree *semas_tab = &(pcb->semas_tab);
   rw_lock_acquire(semas_lock, RW_WRITER);
 
-  struct registered_sema *sema_pos = NULL;
-  bool found = false;
-  list_for_each_entry(sema_pos, semas_tab, elem) {
-    if (sema_pos->sid == sema) {
-      found = true;
-      break;
-    }
-  }
-
-  if (found) {
+  if (radix_lookup(semas_tab, (unsigned long)sema) != NULL) {
     rw_lock_release(semas_lock, RW_WRITER);
     return false;
   }
 
+  struct registered_sema *sema_pos = NULL;
   malloc_type(sema_pos);
   barrier();
   if (sema_pos == NULL) {
@@ -686,26 +886,26 @@ static bool handler_sema_init(sema_t *sema, int val, struct process *pcb) {
   }
   sema_pos->sid = sema;
   sema_init(&(sema_pos->sema), val);
-  list_push_front(semas_tab, &(sema_pos->elem));
+  if (!radix_insert(semas_tab, (unsigned long)sema, sema_pos)) {
+    free(sema_pos);
+    rw_lock_release(semas_lock, RW_WRITER);
+    return false;
+  }
   rw_lock_release(semas_lock, RW_WRITER);
   return true;
 }
 
 static bool handler_sema_down(sema_t *sema, struct process *pcb) {
+#ifdef VM
+  if (shm_contains(pcb, sema))
+    return shm_sema_down(pcb, sema);
+#endif
   struct rw_lock *semas_lock = &(pcb->semas_lock);
-  struct list *semas_tab = &(pcb->semas_tab);
   rw_lock_acquire(semas_lock, RW_READER);
 
-  struct registered_sema *sema_pos = NULL;
-  bool found = false;
-  list_for_each_entry(sema_pos, semas_tab, elem) {
-    if (sema_pos->sid == sema) {
-      found = true;
-      break;
-    }
-  }
+  struct registered_sema *sema_pos = radix_lookup(&(pcb->semas_tab), (unsigned long)sema);
 
-  if (!found) {
+  if (sema_pos == NULL) {
     rw_lock_release(semas_lock, RW_READER);
     return false;
   }
@@ -716,20 +916,16 @@ static bool handler_sema_down(sema_t *sema, struct process *pcb) {
 }
 
 static bool handler_sema_up(sema_t *sema, struct process *pcb) {
+#ifdef VM
+  if (shm_contains(pcb, sema))
+    return shm_sema_up(pcb, sema);
+#endif
   struct rw_lock *semas_lock = &(pcb->semas_lock);
-  struct list *semas_tab = &(pcb->semas_tab);
   rw_lock_acquire(semas_lock, RW_READER);
 
-  struct registered_sema *sema_pos = NULL;
-  bool found = false;
-  list_for_each_entry(sema_pos, semas_tab, elem) {
-    if (sema_pos->sid == sema) {
-      found = true;
-      break;
-    }
-  }
+  struct registered_sema *sema_pos = radix_lookup(&(pcb->semas_tab), (unsigned long)sema);
 
-  if (!found) {
+  if (sema_pos == NULL) {
     rw_lock_release(semas_lock, RW_READER);
     return false;
   }
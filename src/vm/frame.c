@@ -0,0 +1,552 @@
+/**
+ * @file frame.c
+ * @brief 帧表与页面换出
+ *
+ * @details 所有存放用户页面的物理帧都登记在帧表中，帧表同时也是时钟（二次机会）
+ * 算法的环：指针依次扫过各个帧，页面最近被访问过（页表项的Accessed位为1）
+ * 就清除该位并给它第二次机会，否则将其选为牺牲者，由page_evict()写回交换区
+ * 或者直接丢弃
+ *
+ * 物理内存不足时，palloc会调用这里注册的回收函数，换出若干页面并将物理帧
+ * 归还给palloc，所以用户页面和内核页面都可以借此超售内存
+ *
+ * 同页合并线程（merge.c）使用另一个独立的扫描指针依次检查各个匿名页面
+ *
+ * 帧表同时统计每个进程的驻留集（补充页表中的rss），进程可以为其设置上限：
+ * 达到软上限之后，为它分配物理帧时先换出它自己的页面（局部替换），找不到
+ * 可以换出的页面才从全局分配；达到硬上限之后只能换出自己的页面，否则分配失败
+ * 其他进程的分配需要换出页面时，也优先从超过上限的进程中挑选牺牲者，
+ * 一个进程耗尽内存不会再导致无关进程的exec失败
+ *
+ * 共享帧（share.c）不在帧表中，但同样计入每个映射了它的进程的驻留集，
+ * 由page.c在映射和解除映射时调用frame_charge()结算；映射之前先调用
+ * frame_make_room()，因此也受上限的约束。零页不占用额外的内存，不计入驻留集
+ *
+ * 锁的顺序：页面所属的补充页表锁 -> frame_lock
+ * 换出其他进程的页面时需要反过来获取补充页表锁，因此只使用lock_try_acquire，
+ * 获取失败就跳过该帧
+ */
+
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/highmem.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "userprog/exception.h"
+#include "userprog/pagedir.h"
+#include "vm/merge.h"
+#include "vm/page.h"
+#include "vm/prefetch.h"
+
+static struct lock frame_lock;  /* 保护帧表与时钟指针 */
+static struct list frames;      /* 帧表，时钟环 */
+static struct list_elem* hand;  /* 时钟指针 */
+static struct list_elem* scan;  /* 同页合并的扫描指针 */
+static size_t frame_cnt;        /* 帧表中的帧数 */
+static size_t over_cnt;         /* 驻留集超过上限的进程数 */
+
+/* 统计数据 */
+static long long evictions;      /* 换出的页面数 */
+static long long evict_failures; /* 分配物理帧时找不到可以换出的页面的次数 */
+static long long local_evictions; /* 达到上限的进程换出自己页面的次数 */
+static long long over_evictions;  /* 从超过上限的进程中换出页面的次数 */
+static long long hard_failures;   /* 达到硬上限且没有可以换出的页面的分配次数 */
+static size_t rss_max;            /* 所有进程驻留集的最大值 */
+
+static struct frame* evict(struct spt* only);
+static struct frame* evict_from(struct spt* only, bool over_only);
+static struct frame* pick_victim(struct spt* only, bool over_only, bool* locked);
+static uintptr_t reuse(struct frame* victim, bool zero);
+static size_t frame_reclaim(size_t page_cnt);
+static void unlink_frame(struct frame*);
+static void charge(struct spt*, int delta);
+static void check_limits(struct spt*, bool* at_soft, bool* at_hard);
+static size_t soft_limit(const struct spt*);
+static bool over_limit(const struct spt*);
+
+/**
+ * @brief 初始化帧表，并向palloc注册回收函数
+ */
+void frame_init(void) {
+  lock_init(&frame_lock);
+  list_init(&frames);
+  hand = NULL;
+  scan = NULL;
+  palloc_register_reclaim(frame_reclaim);
+}
+
+/**
+ * @brief 为补充页表SPT中的用户页面分配一个物理帧
+ *
+ * @details 物理内存不足时换出一个页面，使用其物理帧
+ * SPT的驻留集达到上限时先换出SPT自己的页面；达到硬上限而找不到
+ * 可以换出的页面时分配失败
+ * 返回的帧尚未加入帧表，不会被换出，调用者填充其内容之后调用
+ * frame_install()将其加入帧表
+ *
+ * @param spt 页面所属的补充页表，调用者必须持有其锁
+ * @param zero 是否需要将物理帧清零
+ * @return struct frame* 内存不足且没有可以换出的页面时返回NULL
+ */
+struct frame* frame_alloc(struct spt* spt, bool zero) {
+  struct frame* f = malloc(sizeof *f);
+  bool at_soft, at_hard;
+
+  if (f == NULL)
+    return NULL;
+  f->paddr = 0;
+
+  check_limits(spt, &at_soft, &at_hard);
+  if (at_soft) {
+    struct frame* victim = evict(spt);
+    if (victim != NULL) {
+      f->paddr = reuse(victim, zero);
+      spt->local_evictions++;
+      local_evictions++;
+    } else if (at_hard) {
+      hard_failures++;
+      free(f);
+      return NULL;
+    }
+  }
+
+  if (f->paddr == 0)
+    f->paddr = palloc_get_frame(PAL_USER | (zero ? PAL_ZERO : 0));
+  if (f->paddr == 0) {
+    struct frame* victim = evict(NULL);
+    if (victim == NULL) {
+      evict_failures++;
+      free(f);
+      return NULL;
+    }
+    f->paddr = reuse(victim, zero);
+  }
+  f->page = NULL;
+  f->spt = NULL;
+  f->pd = NULL;
+  f->pin_cnt = 0;
+  f->candidate = false;
+  return f;
+}
+
+/**
+ * @brief 为已经存放着页面内容的物理帧PADDR创建帧表项
+ *
+ * @details 用于接管fork()之后不再被共享的物理帧，与frame_alloc()一样，
+ * 返回的帧需要由frame_install()加入帧表
+ *
+ * @return struct frame* 内存不足时返回NULL
+ */
+struct frame* frame_adopt(uintptr_t paddr) {
+  struct frame* f = malloc(sizeof *f);
+
+  if (f == NULL)
+    return NULL;
+  f->paddr = paddr;
+  f->page = NULL;
+  f->spt = NULL;
+  f->pd = NULL;
+  f->pin_cnt = 0;
+  f->candidate = false;
+  return f;
+}
+
+/**
+ * @brief 将F登记为页面P的物理帧并加入帧表，此后F可以被换出
+ *
+ * @details 调用者必须持有SPT的锁，且P已经安装在页目录PD中
+ */
+void frame_install(struct frame* f, struct page* p, struct spt* spt, uint32_t* pd) {
+  f->page = p;
+  f->spt = spt;
+  f->pd = pd;
+
+  lock_acquire(&frame_lock);
+  /* 放在时钟指针之前，指针转满一圈才会再次检查它 */
+  if (hand != NULL && hand != list_end(&frames))
+    list_insert(hand, &f->elem);
+  else
+    list_push_back(&frames, &f->elem);
+  frame_cnt++;
+  charge(spt, 1);
+  lock_release(&frame_lock);
+}
+
+/**
+ * @brief 释放物理帧F
+ *
+ * @details F已经登记过的话，调用者必须持有其所属补充页表的锁，
+ * 并且已经将页面从页目录中移除
+ */
+void frame_free(struct frame* f) {
+  if (f != NULL)
+    palloc_free_frame(frame_detach(f));
+}
+
+/**
+ * @brief 释放帧表项F，但保留其物理帧并交给调用者
+ *
+ * @details 与frame_free()的要求相同，用于fork()时将私有页面转为共享页面
+ * @return uintptr_t 物理帧的物理地址
+ */
+uintptr_t frame_detach(struct frame* f) {
+  uintptr_t paddr = f->paddr;
+
+  if (f->page != NULL) {
+    lock_acquire(&frame_lock);
+    unlink_frame(f);
+    lock_release(&frame_lock);
+  }
+  merge_forget(f);
+  free(f);
+  return paddr;
+}
+
+/**
+ * @brief 钉住物理帧F，在frame_unpin()之前不会被换出
+ *
+ * @details 内核直接访问用户缓冲区期间使用，调用者必须持有其所属补充页表的锁
+ */
+void frame_pin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  f->pin_cnt++;
+  lock_release(&frame_lock);
+}
+
+/**
+ * @brief 撤销一次frame_pin()
+ */
+void frame_unpin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  ASSERT(f->pin_cnt > 0);
+  f->pin_cnt--;
+  lock_release(&frame_lock);
+}
+
+/**
+ * @brief 为合并线程转动扫描指针，取出下一个存放匿名页面的帧
+ *
+ * @details 跳过被钉住的帧、其他类型的页面，以及补充页表锁被其他线程持有的帧
+ * 返回的帧已经被钉住，其补充页表锁由当前线程持有，调用者检查完毕之后
+ * 解除钉住（帧仍然存在的话）并释放该锁
+ *
+ * @return struct frame* 扫过整个帧表仍然找不到时返回NULL
+ */
+struct frame* frame_scan(void) {
+  struct frame* found = NULL;
+  size_t i;
+
+  lock_acquire(&frame_lock);
+  for (i = 0; i < frame_cnt && found == NULL; i++) {
+    struct frame* f;
+
+    if (scan == NULL || scan == list_end(&frames))
+      scan = list_begin(&frames);
+    f = list_entry(scan, struct frame, elem);
+    scan = list_next(scan);
+
+    if (f->pin_cnt > 0 || !lock_try_acquire(&f->spt->lock))
+      continue;
+    if (f->page->type == PAGE_ANON) {
+      f->pin_cnt++;
+      found = f;
+    } else
+      lock_release(&f->spt->lock);
+  }
+  lock_release(&frame_lock);
+  return found;
+}
+
+/**
+ * @brief SPT的驻留集达到上限时先换出它自己的一个页面，为即将映射的共享帧腾出位置
+ *
+ * @details 与frame_alloc()遵守同样的上限，换出的物理帧直接归还给palloc
+ * 调用者必须持有SPT的锁
+ * @return false 达到硬上限且没有可以换出的页面
+ */
+bool frame_make_room(struct spt* spt) {
+  struct frame* victim;
+  bool at_soft, at_hard;
+
+  check_limits(spt, &at_soft, &at_hard);
+  if (!at_soft)
+    return true;
+  victim = evict(spt);
+  if (victim != NULL) {
+    palloc_free_frame(reuse(victim, false));
+    spt->local_evictions++;
+    local_evictions++;
+    return true;
+  }
+  if (at_hard) {
+    hard_failures++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 将SPT映射的共享帧计入（DELTA为正）或者移出（DELTA为负）其驻留集
+ */
+void frame_charge(struct spt* spt, int delta) {
+  lock_acquire(&frame_lock);
+  charge(spt, delta);
+  lock_release(&frame_lock);
+}
+
+/**
+ * @brief 设置补充页表SPT所属进程的驻留集上限（页数）
+ *
+ * @details 只设置了硬上限的话，软上限与之相同。已经超过新上限的驻留集
+ * 不会被立即换出，而是在之后的分配中逐渐收缩
+ *
+ * @param soft 软上限，0表示不限制
+ * @param hard 硬上限，0表示不限制
+ * @return false 两个上限都不为0而软上限大于硬上限
+ */
+bool frame_set_limits(struct spt* spt, size_t soft, size_t hard) {
+  bool was;
+
+  if (soft != 0 && hard != 0 && soft > hard)
+    return false;
+
+  lock_acquire(&frame_lock);
+  was = over_limit(spt);
+  spt->rss_soft = soft;
+  spt->rss_hard = hard;
+  if (over_limit(spt) && !was)
+    over_cnt++;
+  else if (!over_limit(spt) && was)
+    over_cnt--;
+  lock_release(&frame_lock);
+  return true;
+}
+
+/**
+ * @brief 将补充页表SPT所属进程的驻留集统计数据复制到ST中
+ */
+void frame_get_rss(struct spt* spt, struct rss_stat* st) {
+  lock_acquire(&frame_lock);
+  st->rss = spt->rss;
+  st->peak = spt->rss_peak;
+  st->soft = spt->rss_soft;
+  st->hard = spt->rss_hard;
+  st->local_evictions = spt->local_evictions;
+  lock_release(&frame_lock);
+}
+
+/* 收集全系统的换页统计数据，各计数器没有加锁读取，只是近似值 */
+void frame_get_vm_stat(struct vm_stat* st) {
+  st->page_faults = exception_page_faults();
+  st->evictions = evictions;
+  block_get_stats(block_get_role(BLOCK_FILESYS), &st->fs_reads, &st->fs_writes);
+  block_get_stats(block_get_role(BLOCK_SWAP), &st->swap_reads, &st->swap_writes);
+}
+
+/* 打印帧表的统计数据 */
+void frame_print_stats(void) {
+  printf("Frames: %zu in use, %lld evicted, %lld evictions failed\n", frame_cnt, evictions,
+         evict_failures);
+  printf("RSS: largest %zu pages, %lld local evictions, %lld evictions from processes over "
+         "limit, %lld allocations refused at hard limit\n",
+         rss_max, local_evictions, over_evictions, hard_failures);
+}
+
+/**
+ * @brief 选出一个页面并将其换出
+ *
+ * @details ONLY不为NULL时只从ONLY的页面中挑选；否则有进程的驻留集超过上限的话
+ * 先从这些进程的页面中挑选，找不到再从所有页面中挑选
+ *
+ * @return struct frame* 牺牲者的帧表项，已经从帧表中移除，其物理帧可以直接复用；
+ * 没有可以换出的页面时返回NULL
+ */
+static struct frame* evict(struct spt* only) {
+  struct frame* f = NULL;
+
+  if (only == NULL && over_cnt > 0) {
+    f = evict_from(NULL, true);
+    if (f != NULL)
+      over_evictions++;
+  }
+  if (f == NULL)
+    f = evict_from(only, false);
+  return f;
+}
+
+/**
+ * @brief 使用时钟算法从ONLY（为NULL时不限）的页面中选出一个页面并将其换出
+ *
+ * @param over_only 是否只考虑驻留集超过上限的进程的页面
+ * @return struct frame* 与evict()相同
+ */
+static struct frame* evict_from(struct spt* only, bool over_only) {
+  size_t attempts;
+
+  lock_acquire(&frame_lock);
+  attempts = frame_cnt;
+  lock_release(&frame_lock);
+
+  do {
+    bool locked, evicted;
+    struct frame* f;
+
+    lock_acquire(&frame_lock);
+    f = pick_victim(only, over_only, &locked);
+    lock_release(&frame_lock);
+    if (f == NULL)
+      break;
+
+    evicted = page_evict(f->page, f->pd);
+    if (!evicted) {
+      /* 换不出去（比如交换区已满），放回帧表 */
+      lock_acquire(&frame_lock);
+      list_push_back(&frames, &f->elem);
+      frame_cnt++;
+      charge(f->spt, 1);
+      lock_release(&frame_lock);
+    } else
+      merge_forget(f);
+    if (locked)
+      lock_release(&f->spt->lock);
+    if (evicted) {
+      evictions++;
+      return f;
+    }
+  } while (attempts-- > 0);
+
+  return NULL;
+}
+
+/**
+ * @brief 转动时钟指针，选出一个牺牲者
+ *
+ * @details 跳过不属于ONLY（不为NULL时）的帧、OVER_ONLY时驻留集没有超过上限的
+ * 进程的帧、被钉住的帧、最近被访问过的帧（同时清除其Accessed位），
+ * 以及补充页表锁被其他线程持有的帧
+ * 选中的帧会被移出帧表，其补充页表锁由当前线程持有；
+ * *LOCKED表示该锁是否为本函数获取的，需要由调用者释放
+ * 调用者必须持有frame_lock
+ *
+ * @return struct frame* 转两圈仍然找不到时返回NULL
+ */
+static struct frame* pick_victim(struct spt* only, bool over_only, bool* locked) {
+  size_t i;
+
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  for (i = 0; i < 2 * frame_cnt; i++) {
+    struct frame* f;
+
+    if (hand == NULL || hand == list_end(&frames))
+      hand = list_begin(&frames);
+    f = list_entry(hand, struct frame, elem);
+    hand = list_next(hand);
+
+    if ((only != NULL && f->spt != only) || (over_only && !over_limit(f->spt)))
+      continue;
+    if (f->pin_cnt > 0)
+      continue;
+    if (pagedir_is_accessed(f->pd, f->page->upage)) {
+      pagedir_set_accessed(f->pd, f->page->upage, false);
+      /* 访问位被清除之前结算预读的页面 */
+      if (f->page->prefetched) {
+        f->page->prefetched = false;
+        prefetch_hit();
+      }
+      continue;
+    }
+    if (lock_held_by_current_thread(&f->spt->lock))
+      *locked = false;
+    else if (lock_try_acquire(&f->spt->lock))
+      *locked = true;
+    else
+      continue;
+
+    unlink_frame(f);
+    return f;
+  }
+  return NULL;
+}
+
+/**
+ * @brief palloc的回收函数：换出至多PAGE_CNT个页面，将物理帧归还给palloc
+ *
+ * @return size_t 归还的物理帧数
+ */
+static size_t frame_reclaim(size_t page_cnt) {
+  size_t freed;
+
+  for (freed = 0; freed < page_cnt; freed++) {
+    struct frame* f = evict(NULL);
+    if (f == NULL)
+      break;
+    palloc_free_frame(f->paddr);
+    free(f);
+  }
+  return freed;
+}
+
+/* 将F移出帧表，同时调整指向它的指针，调用者必须持有frame_lock */
+static void unlink_frame(struct frame* f) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  if (hand == &f->elem)
+    hand = list_next(hand);
+  if (scan == &f->elem)
+    scan = list_next(scan);
+  list_remove(&f->elem);
+  frame_cnt--;
+  charge(f->spt, -1);
+}
+
+/* 释放牺牲者VICTIM的帧表项，返回其物理帧以供复用，ZERO时将其清零 */
+static uintptr_t reuse(struct frame* victim, bool zero) {
+  uintptr_t paddr = victim->paddr;
+
+  free(victim);
+  if (zero) {
+    void* kpage = kmap(paddr);
+    memset(kpage, 0, PGSIZE);
+    kunmap(kpage);
+  }
+  return paddr;
+}
+
+/* 将SPT的驻留集调整DELTA页，同时维护峰值与超过上限的进程数，
+   调用者必须持有frame_lock */
+static void charge(struct spt* spt, int delta) {
+  bool was = over_limit(spt);
+
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  spt->rss += delta;
+  if (spt->rss > spt->rss_peak)
+    spt->rss_peak = spt->rss;
+  if (spt->rss > rss_max)
+    rss_max = spt->rss;
+  if (over_limit(spt) && !was)
+    over_cnt++;
+  else if (!over_limit(spt) && was)
+    over_cnt--;
+}
+
+/* SPT的驻留集是否已经达到软上限和硬上限 */
+static void check_limits(struct spt* spt, bool* at_soft, bool* at_hard) {
+  lock_acquire(&frame_lock);
+  *at_soft = soft_limit(spt) != 0 && spt->rss >= soft_limit(spt);
+  *at_hard = spt->rss_hard != 0 && spt->rss >= spt->rss_hard;
+  lock_release(&frame_lock);
+}
+
+/* SPT的软上限，只设置了硬上限时与之相同，0表示不限制 */
+static size_t soft_limit(const struct spt* spt) {
+  return spt->rss_soft != 0 ? spt->rss_soft : spt->rss_hard;
+}
+
+/* SPT的驻留集是否超过了（软）上限 */
+static bool over_limit(const struct spt* spt) {
+  return soft_limit(spt) != 0 && spt->rss > soft_limit(spt);
+}
@@ -0,0 +1,66 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct page;
+struct spt;
+
+/* 帧表项
+ *
+ * 每个存放用户页面的物理帧对应一个帧表项，所有帧表项组成一个环，
+ * 时钟算法在其上转动，寻找可以被换出的页面
+ */
+struct frame {
+  uintptr_t paddr;       /* 物理帧的物理地址 */
+  struct page* page;     /* 存放在此帧中的页面 */
+  struct spt* spt;       /* 页面所属的补充页表 */
+  uint32_t* pd;          /* 页面所属的页目录 */
+  unsigned pin_cnt;      /* 被钉住的次数，大于0时不可换出 */
+  struct list_elem elem; /* 帧表（时钟环）元素 */
+
+  /* 同页合并（merge.c）使用，由页面所属补充页表的锁保护 */
+  unsigned checksum; /* 上次扫描时页面内容的散列值 */
+  bool candidate;    /* 是否登记在候选页面表中 */
+};
+
+/* 进程驻留集的统计数据，由rss_stat系统调用复制给用户进程 */
+struct rss_stat {
+  size_t rss;               /* 驻留的页面数 */
+  size_t peak;              /* 驻留页面数的峰值 */
+  size_t soft;              /* 软上限，0表示不限制 */
+  size_t hard;              /* 硬上限，0表示不限制 */
+  unsigned local_evictions; /* 因达到上限而换出自己页面的次数 */
+};
+
+/* 全系统的换页统计数据，由vm_stat系统调用复制给用户进程，供性能测试使用
+ * 磁盘读写的单位为扇区 */
+struct vm_stat {
+  unsigned long long page_faults; /* 缺页异常次数 */
+  unsigned long long evictions;   /* 换出的页面数 */
+  unsigned long long fs_reads;    /* 从文件系统设备读取的扇区数 */
+  unsigned long long fs_writes;   /* 写入文件系统设备的扇区数 */
+  unsigned long long swap_reads;  /* 从交换设备读取的扇区数 */
+  unsigned long long swap_writes; /* 写入交换设备的扇区数 */
+};
+
+void frame_init(void);
+struct frame* frame_alloc(struct spt*, bool zero);
+struct frame* frame_adopt(uintptr_t paddr);
+void frame_install(struct frame*, struct page*, struct spt*, uint32_t* pd);
+void frame_free(struct frame*);
+uintptr_t frame_detach(struct frame*);
+void frame_pin(struct frame*);
+void frame_unpin(struct frame*);
+struct frame* frame_scan(void);
+bool frame_make_room(struct spt*);
+void frame_charge(struct spt*, int delta);
+bool frame_set_limits(struct spt*, size_t soft, size_t hard);
+void frame_get_rss(struct spt*, struct rss_stat*);
+void frame_get_vm_stat(struct vm_stat*);
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
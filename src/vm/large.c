@@ -0,0 +1,327 @@
+/**
+ * @file large.c
+ * @brief 用户进程的4 MB大页
+ *
+ * @details 用户地址空间原本全部由4 KB页面组成，遍历大数组的程序（比如矩阵乘法）
+ * 每4 KB就要经历一次缺页，并且TLB很快就会被占满。启用-large-pages选项并且
+ * CPU支持PSE时，可写全零页面第一次被写入时检查它所在的、按4 MB对齐的区域：
+ * 1024个页面都是尚未被写入过的可写全零页面的话，从palloc申请一段同样按4 MB
+ * 对齐的连续物理帧，以一个大页映射整个区域
+ *
+ * 物理内存碎片化、找不到这样的连续物理帧时，退回到普通的4 KB页面
+ *
+ * 大页整体不可换出。物理内存不足时，这里注册的回收函数将一个大页拆分为
+ * 普通页面，它们进入帧表之后就可以被逐个换出；删除大页中的部分页面
+ * （比如释放线程栈）时同样先拆分。fork()时子进程得到大页内容的普通副本
+ *
+ * 锁的顺序：补充页表锁 -> large_lock，回收时只用lock_try_acquire获取补充页表锁
+ */
+
+#include "vm/large.h"
+#include <debug.h>
+#include <radix.h>
+#include <stdio.h>
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/share.h"
+
+/* 一个大页覆盖的字节数 */
+#define LARGE_SIZE ((uintptr_t)PTSPAN)
+
+static bool enabled;             /* 是否使用大页 */
+static struct lock large_lock;   /* 保护全局大页链表 */
+static struct list larges;       /* 所有进程的大页，回收时从中挑选 */
+
+/* 统计数据 */
+static long long mapped;    /* 映射过的大页数 */
+static long long fallbacks; /* 找不到连续物理帧、退回普通页面的次数 */
+static long long splits;    /* 拆分为普通页面的大页数 */
+static size_t in_use;       /* 现存的大页数 */
+
+typedef bool page_action(struct page*, void* aux);
+
+static size_t walk(struct spt*, void* base, page_action*, void* aux);
+static page_action eligible, adopt, attach_frame, detach_frame, install, release;
+static void release_large(struct large*);
+static void unlink_large(struct large*);
+static size_t large_reclaim(size_t page_cnt);
+
+/**
+ * @brief 初始化大页链表，ENABLE为true并且CPU支持PSE时启用大页
+ */
+void large_init(bool enable) {
+  lock_init(&large_lock);
+  list_init(&larges);
+  enabled = enable && cpu_has_pse;
+  if (enabled)
+    palloc_register_reclaim(large_reclaim);
+}
+
+/**
+ * @brief 可写全零页面P即将被写入，尝试以大页映射其所在的整个区域
+ *
+ * @details 区域中的页面全部是尚未被写入的可写全零页面时（映射了零页的也可以），
+ * 申请连续的物理帧并安装大页。调用者必须持有SPT的锁
+ *
+ * @return true 大页映射成功，P已经可以写入
+ * @return false 未启用大页、区域不符合条件或者找不到连续的物理帧，
+ * 调用者应当退回到普通页面
+ */
+bool large_map(struct spt* spt, uint32_t* pd, struct page* p) {
+  void* base = (void*)((uintptr_t)p->upage & ~(LARGE_SIZE - 1));
+  struct large* l;
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  if (!enabled || walk(spt, base, eligible, NULL) != PALLOC_LARGE_PAGES)
+    return false;
+
+  l = malloc(sizeof *l);
+  if (l == NULL)
+    return false;
+  l->paddr = palloc_get_large_frame(PAL_USER | PAL_ZERO);
+  if (l->paddr == 0) {
+    fallbacks++;
+    free(l);
+    return false;
+  }
+  l->base = base;
+  l->spt = spt;
+  l->pd = pd;
+  l->pin_cnt = 0;
+
+  walk(spt, base, adopt, l);
+  pagedir_set_large(pd, base, l->paddr, true);
+  list_push_back(&spt->larges, &l->spt_elem);
+  lock_acquire(&large_lock);
+  list_push_back(&larges, &l->elem);
+  in_use++;
+  lock_release(&large_lock);
+  mapped++;
+  return true;
+}
+
+/**
+ * @brief 大页中的页面P所在的物理帧
+ */
+uintptr_t large_frame(const struct page* p) {
+  return p->large->paddr + ((uintptr_t)p->upage - (uintptr_t)p->large->base);
+}
+
+/**
+ * @brief 将大页L拆分为1024个普通页面，它们各自进入帧表，此后可以被换出
+ *
+ * @details 调用者必须持有L所属补充页表的锁
+ * @return false L中有页面被钉住，或者内存不足，L保持原样
+ */
+bool large_split(struct large* l) {
+  struct spt* spt = l->spt;
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  if (l->pin_cnt > 0)
+    return false;
+  if (walk(spt, l->base, attach_frame, l) != PALLOC_LARGE_PAGES
+      || !pagedir_split_large(l->pd, l->base)) {
+    walk(spt, l->base, detach_frame, NULL);
+    return false;
+  }
+  walk(spt, l->base, install, l);
+  unlink_large(l);
+  free(l);
+  splits++;
+  return true;
+}
+
+/**
+ * @brief 即将删除[START, END)中的页面，处理与之重叠的大页
+ *
+ * @details 完全位于范围内的大页直接释放，其页面不再属于大页；
+ * 部分重叠的大页被拆分，拆分失败的话其页面仍然属于大页，调用者应当跳过它们
+ * 调用者必须持有SPT的锁
+ */
+void large_unmap_range(struct spt* spt, void* start, void* end) {
+  struct list_elem* e = list_begin(&spt->larges);
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  while (e != list_end(&spt->larges)) {
+    struct large* l = list_entry(e, struct large, spt_elem);
+    uint8_t* base = l->base;
+
+    e = list_next(e);
+    if (base >= (uint8_t*)end || base + LARGE_SIZE <= (uint8_t*)start)
+      continue;
+    if (base >= (uint8_t*)start && base + LARGE_SIZE <= (uint8_t*)end)
+      release_large(l);
+    else
+      large_split(l);
+  }
+}
+
+/**
+ * @brief 拆分与[START, END)重叠的所有大页，用于保留表项、只释放内容的场合
+ *
+ * @details 与large_unmap_range()不同，完全位于范围内的大页也只拆分不释放，
+ * 拆分出的页面仍然持有各自的物理帧，由调用者逐页释放并更新表项。
+ * 拆分失败的大页保持原样，调用者应当跳过其页面
+ * 调用者必须持有SPT的锁
+ */
+void large_split_range(struct spt* spt, void* start, void* end) {
+  struct list_elem* e = list_begin(&spt->larges);
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  while (e != list_end(&spt->larges)) {
+    struct large* l = list_entry(e, struct large, spt_elem);
+    uint8_t* base = l->base;
+
+    e = list_next(e);
+    if (base < (uint8_t*)end && base + LARGE_SIZE > (uint8_t*)start)
+      large_split(l);
+  }
+}
+
+/**
+ * @brief 释放SPT的所有大页，由spt_destroy()在释放页面之前调用
+ *
+ * @details 调用者必须持有SPT的锁
+ */
+void large_destroy(struct spt* spt) {
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  while (!list_empty(&spt->larges))
+    release_large(list_entry(list_front(&spt->larges), struct large, spt_elem));
+}
+
+/* 打印大页的统计数据 */
+void large_print_stats(void) {
+  printf("Large pages: %lld mapped, %lld fell back to 4 kB pages, %lld split, %zu in use\n",
+         mapped, fallbacks, splits, in_use);
+}
+
+/**
+ * @brief 依次对区域[BASE, BASE + 4 MB)中的每个表项调用ACTION
+ *
+ * @details 遇到缺失的表项或者ACTION返回false时停止
+ * @return size_t 成功处理的表项数，等于PALLOC_LARGE_PAGES表示整个区域都处理完毕
+ */
+static size_t walk(struct spt* spt, void* base, page_action* action, void* aux) {
+  struct page* batch[16];
+  unsigned long indexes[16];
+  unsigned long next = pg_no(base);
+  unsigned long end = next + PALLOC_LARGE_PAGES;
+  size_t cnt, i;
+
+  while (next < end) {
+    cnt = radix_gang_lookup(&spt->pages, next, 16, (void**)batch, indexes);
+    if (cnt == 0)
+      break;
+    for (i = 0; i < cnt && next < end; i++, next++)
+      if (indexes[i] != next || !action(batch[i], aux))
+        return next - pg_no(base);
+  }
+  return next - pg_no(base);
+}
+
+/* P是否可以成为大页的一部分：尚未被写入的可写全零页面 */
+static bool eligible(struct page* p, void* aux UNUSED) {
+  return p->type == PAGE_ZERO && p->writable && p->frame == NULL && p->large == NULL
+         && (p->share == NULL || share_is_zero(p->share));
+}
+
+/* 将P并入大页AUX，映射了零页的话先将其移除 */
+static bool adopt(struct page* p, void* l_) {
+  struct large* l = l_;
+
+  if (p->share != NULL) {
+    pagedir_clear_page(l->pd, p->upage);
+    share_put(p->share);
+    p->share = NULL;
+  }
+  p->type = PAGE_ANON;
+  p->large = l;
+  return true;
+}
+
+/* 为大页中的页面P创建指向其物理帧的帧表项 */
+static bool attach_frame(struct page* p, void* aux UNUSED) {
+  p->frame = frame_adopt(large_frame(p));
+  return p->frame != NULL;
+}
+
+/* 撤销attach_frame() */
+static bool detach_frame(struct page* p, void* aux UNUSED) {
+  if (p->frame != NULL) {
+    frame_detach(p->frame);
+    p->frame = NULL;
+  }
+  return true;
+}
+
+/* 拆分完成，P成为普通页面，其帧表项加入帧表 */
+static bool install(struct page* p, void* l_) {
+  struct large* l = l_;
+
+  p->large = NULL;
+  frame_install(p->frame, p, l->spt, l->pd);
+  return true;
+}
+
+/* P所属的大页被释放，P成为没有内容的普通页面，随后被删除 */
+static bool release(struct page* p, void* aux UNUSED) {
+  p->large = NULL;
+  return true;
+}
+
+/* 移除并释放大页L及其物理帧，调用者必须持有L所属补充页表的锁 */
+static void release_large(struct large* l) {
+  pagedir_clear_large(l->pd, l->base);
+  walk(l->spt, l->base, release, NULL);
+  palloc_free_large_frame(l->paddr);
+  unlink_large(l);
+  free(l);
+}
+
+/* 将L从补充页表和全局的大页链表中移除 */
+static void unlink_large(struct large* l) {
+  list_remove(&l->spt_elem);
+  lock_acquire(&large_lock);
+  list_remove(&l->elem);
+  in_use--;
+  lock_release(&large_lock);
+}
+
+/**
+ * @brief palloc的回收函数：拆分一个大页
+ *
+ * @details 拆分本身并不释放物理帧，但拆分出的页面进入帧表之后，
+ * 分配物理帧时的换出就可以选中它们。跳过有页面被钉住的大页，
+ * 以及补充页表锁被占用（包括被当前线程持有）的大页
+ *
+ * @return size_t 总是0
+ */
+static size_t large_reclaim(size_t page_cnt UNUSED) {
+  struct large* victim = NULL;
+  struct list_elem* e;
+
+  lock_acquire(&large_lock);
+  for (e = list_begin(&larges); e != list_end(&larges); e = list_next(e)) {
+    struct large* l = list_entry(e, struct large, elem);
+    if (l->pin_cnt == 0 && !lock_held_by_current_thread(&l->spt->lock)
+        && lock_try_acquire(&l->spt->lock)) {
+      victim = l;
+      break;
+    }
+  }
+  lock_release(&large_lock);
+
+  if (victim != NULL) {
+    struct spt* spt = victim->spt;
+    large_split(victim);
+    lock_release(&spt->lock);
+  }
+  return 0;
+}
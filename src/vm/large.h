@@ -0,0 +1,42 @@
+#ifndef VM_LARGE_H
+#define VM_LARGE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct page;
+struct spt;
+
+/* 4 MB大页
+ *
+ * 按4 MB对齐、1024个页面全部作为可写全零页面登记在补充页表中的区域
+ * （比如大数组所在的.bss），第一次被写入时整个映射为一个PSE大页：
+ * 之后访问其中的任何页面都不会再缺页，并且整个区域只占用一个TLB表项
+ *
+ * 大页中的页面为PAGE_ANON，large指向本结构体，它们没有各自的帧表项，
+ * 因此不会被单独换出。内存不足，或者其中部分页面被删除时，大页被拆分为
+ * 1024个普通页面，各自进入帧表
+ *
+ * 由所属补充页表的锁保护
+ */
+struct large {
+  void* base;                /* 起始用户虚拟地址，按4 MB对齐 */
+  uintptr_t paddr;           /* 物理帧的起始物理地址，按4 MB对齐 */
+  struct spt* spt;           /* 所属的补充页表 */
+  uint32_t* pd;              /* 所属的页目录 */
+  unsigned pin_cnt;          /* 被page_pin()钉住的页面数，大于0时不可拆分 */
+  struct list_elem spt_elem; /* 补充页表的大页链表元素 */
+  struct list_elem elem;     /* 全局大页链表元素 */
+};
+
+void large_init(bool enabled);
+bool large_map(struct spt*, uint32_t* pd, struct page*);
+uintptr_t large_frame(const struct page*);
+bool large_split(struct large*);
+void large_unmap_range(struct spt*, void* start, void* end);
+void large_split_range(struct spt*, void* start, void* end);
+void large_destroy(struct spt*);
+void large_print_stats(void);
+
+#endif /* vm/large.h */
@@ -0,0 +1,281 @@
+/**
+ * @file merge.c
+ * @brief 相同匿名页面的合并
+ *
+ * @details 多个进程（或者同一进程的多个缓冲区）常常存放着内容完全相同的匿名页面，
+ * 比如fork()之后各自写入了相同数据的页面、被重新清零的缓冲区。合并线程以最低的
+ * 优先级在后台依次扫描帧表中的匿名页面，找到内容相同的页面之后只保留一个
+ * 物理帧，由它们只读地共同映射，之后的写入与fork()一样触发写时复制
+ *
+ * 扫描到的页面自上次扫描之后被写过（页表项的Dirty位为1）时，说明内容还在变化，
+ * 合并了也很快会被复制回去，因此只清除Dirty位，留到下一轮再检查。
+ * 内容稳定的页面计算散列值：
+ * - 全零的页面直接改为映射零页
+ * - 与合并页面表（share.c）中的某个页面相同时映射该页面
+ * - 否则在候选页面表中查找散列值相同的页面，二者内容确实相同的话，
+ *   由候选页面的物理帧创建新的合并页面，二者都改为映射它；
+ *   没有这样的候选页面时将自己登记为候选页面
+ *
+ * 合并之前先用page_freeze()将页面从页目录中移除，再次确认Dirty位为0，
+ * 散列和比较期间进程写入的页面因此不会被错误地合并
+ *
+ * 扫描由-merge=PAGES启动选项控制：每批最多检查PAGES个页面，然后休眠
+ * MERGE_INTERVAL个tick；0（默认）表示不启动合并线程
+ *
+ * 锁的顺序：补充页表锁 -> merge_lock，获取候选页面的补充页表锁时只使用lock_try_acquire
+ */
+
+#include "vm/merge.h"
+#include <debug.h>
+#include <ohash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/highmem.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/share.h"
+
+/* 候选页面表的槽数，以散列值直接定位，同一槽中只保留最先登记的页面
+ * 候选页面表不分配内存，所以回收内存的路径上也可以调用merge_forget() */
+#define MERGE_SLOTS 512
+
+static struct frame* candidates[MERGE_SLOTS]; /* 候选页面表 */
+static struct lock merge_lock;                /* 保护候选页面表 */
+static size_t pages_per_pass;                 /* 每批扫描的页面数 */
+
+/* 统计数据 */
+static long long scanned;       /* 检查过的页面数 */
+static long long volatile_cnt;  /* 其中因为被写过而跳过的页面数 */
+static long long merged_cnt;    /* 改为映射合并页面的页面数 */
+static long long zero_cnt;      /* 改为映射零页的页面数 */
+static int64_t ticks_spent;     /* 合并线程扫描所用的时间 */
+
+static thread_func merge_thread NO_RETURN;
+static bool scan_page(void);
+static bool merge(struct frame*, unsigned checksum, bool zero);
+static bool merge_pair(struct frame*, struct frame* c, unsigned checksum);
+static struct frame* claim_candidate(struct frame*, unsigned checksum);
+static bool same_content(uintptr_t, uintptr_t);
+static bool is_zero(const void* kpage);
+
+/**
+ * @brief 初始化候选页面表，PAGE_CNT不为0时启动合并线程
+ *
+ * @param page_cnt 每批扫描的页面数
+ */
+void merge_init(size_t page_cnt) {
+  lock_init(&merge_lock);
+  pages_per_pass = page_cnt;
+  if (page_cnt > 0)
+    thread_create("merge", PRI_MIN, merge_thread, NULL);
+}
+
+/**
+ * @brief 帧F即将被释放或者换出，将其移出候选页面表
+ *
+ * @details 调用者必须持有F所属补充页表的锁
+ */
+void merge_forget(struct frame* f) {
+  size_t slot;
+
+  if (!f->candidate)
+    return;
+  slot = f->checksum % MERGE_SLOTS;
+  lock_acquire(&merge_lock);
+  ASSERT(candidates[slot] == f);
+  candidates[slot] = NULL;
+  f->candidate = false;
+  lock_release(&merge_lock);
+}
+
+/* 打印同页合并的统计数据 */
+void merge_print_stats(void) {
+  printf("Merge: %lld pages scanned, %lld skipped as still changing, %lld merged, "
+         "%lld into the zero page, %lld ticks spent\n",
+         scanned, volatile_cnt, merged_cnt, zero_cnt, ticks_spent);
+}
+
+/**
+ * @brief 合并线程：每批扫描pages_per_pass个页面，然后休眠
+ */
+static void merge_thread(void* aux UNUSED) {
+  for (;;) {
+    int64_t start = timer_ticks();
+    size_t i;
+
+    for (i = 0; i < pages_per_pass; i++)
+      if (!scan_page())
+        break;
+    ticks_spent += timer_elapsed(start);
+    timer_sleep(MERGE_INTERVAL);
+  }
+}
+
+/**
+ * @brief 检查扫描指针处的下一个匿名页面，可能的话将其合并
+ *
+ * @return false 帧表中没有可以检查的页面
+ */
+static bool scan_page(void) {
+  struct frame* f = frame_scan();
+  struct spt* spt;
+  uint32_t* pd;
+  void* upage;
+  unsigned checksum;
+  bool zero;
+  void* kpage;
+
+  if (f == NULL)
+    return false;
+  spt = f->spt;
+  pd = f->pd;
+  upage = f->page->upage;
+  scanned++;
+
+  if (pagedir_is_dirty(pd, upage)) {
+    /* 上次扫描之后被写过，内容还在变化；匿名页面换出时总是写入交换区，可以清除Dirty位 */
+    pagedir_set_dirty(pd, upage, false);
+    merge_forget(f);
+    frame_unpin(f);
+    volatile_cnt++;
+  } else {
+    kpage = kmap(f->paddr);
+    checksum = ohash_bytes(kpage, PGSIZE);
+    zero = is_zero(kpage);
+    kunmap(kpage);
+    if (!merge(f, checksum, zero))
+      frame_unpin(f);
+  }
+  lock_release(&spt->lock);
+  return true;
+}
+
+/**
+ * @brief 尝试将钉住的帧F中的页面合并到零页、合并页面或者候选页面中
+ *
+ * @details 调用者必须持有F所属补充页表的锁
+ * @return true 页面已经合并，F随之被释放
+ */
+static bool merge(struct frame* f, unsigned checksum, bool zero) {
+  struct frame* c;
+  struct spt* c_spt;
+  struct share* s;
+  bool success;
+
+  s = zero ? share_zero() : share_find_merged(f->paddr, checksum);
+  if (s != NULL) {
+    if (page_freeze(f->page, f->pd)) {
+      page_merge(f->page, f->pd, s);
+      if (zero)
+        zero_cnt++;
+      else
+        merged_cnt++;
+      return true;
+    }
+    share_put(s);
+    return false;
+  }
+
+  /* 已经是候选页面的话，等待内容相同的其他页面找到它 */
+  if (f->candidate)
+    return false;
+  c = claim_candidate(f, checksum);
+  if (c == NULL)
+    return false;
+  c_spt = c->spt;
+  success = merge_pair(f, c, checksum);
+  if (c_spt != f->spt)
+    lock_release(&c_spt->lock);
+  return success;
+}
+
+/**
+ * @brief 确认候选页面C与F的内容相同之后，由C的物理帧创建合并页面，二者都改为映射它
+ *
+ * @details 调用者必须同时持有F与C所属补充页表的锁
+ * @return true 页面已经合并，F与C均被释放
+ */
+static bool merge_pair(struct frame* f, struct frame* c, unsigned checksum) {
+  struct share* s;
+
+  if (c->pin_cnt > 0 || c->page->type != PAGE_ANON)
+    return false;
+  if (!page_freeze(c->page, c->pd))
+    return false;
+  if (!page_freeze(f->page, f->pd)) {
+    page_thaw(c->page, c->pd);
+    return false;
+  }
+
+  /* 分配内存时可能换出页面，钉住C */
+  frame_pin(c);
+  s = same_content(f->paddr, c->paddr) ? share_add_merged(c->paddr, checksum) : NULL;
+  frame_unpin(c);
+  if (s == NULL) {
+    page_thaw(f->page, f->pd);
+    page_thaw(c->page, c->pd);
+    return false;
+  }
+
+  page_merge(c->page, c->pd, s);
+  share_dup(s);
+  page_merge(f->page, f->pd, s);
+  merged_cnt += 2;
+  return true;
+}
+
+/**
+ * @brief 在候选页面表中查找散列值为CHECKSUM的页面，并获取其补充页表锁
+ *
+ * @details 找到的页面被移出候选页面表，其补充页表锁由调用者持有
+ * （与F的相同时不会再次获取）；没有这样的页面并且槽位空闲时将F登记为候选页面
+ * 调用者必须持有F所属补充页表的锁
+ *
+ * @return struct frame* 找不到或者无法获取其补充页表锁时返回NULL
+ */
+static struct frame* claim_candidate(struct frame* f, unsigned checksum) {
+  size_t slot = checksum % MERGE_SLOTS;
+  struct frame* c;
+
+  lock_acquire(&merge_lock);
+  c = candidates[slot];
+  if (c == NULL) {
+    f->checksum = checksum;
+    f->candidate = true;
+    candidates[slot] = f;
+  } else if (c->checksum == checksum
+             && (c->spt == f->spt || lock_try_acquire(&c->spt->lock))) {
+    candidates[slot] = NULL;
+    c->candidate = false;
+  } else
+    c = NULL;
+  lock_release(&merge_lock);
+  return c;
+}
+
+/* 物理帧A与B的内容是否相同 */
+static bool same_content(uintptr_t a, uintptr_t b) {
+  void* pa = kmap(a);
+  void* pb = kmap(b);
+  bool same = memcmp(pa, pb, PGSIZE) == 0;
+
+  kunmap(pb);
+  kunmap(pa);
+  return same;
+}
+
+/* KPAGE是否全零 */
+static bool is_zero(const void* kpage) {
+  const uint32_t* words = kpage;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *words; i++)
+    if (words[i] != 0)
+      return false;
+  return true;
+}
@@ -0,0 +1,15 @@
+#ifndef VM_MERGE_H
+#define VM_MERGE_H
+
+#include <stddef.h>
+
+struct frame;
+
+/* 合并线程每扫描一批页面之后休眠的时间（ticks） */
+#define MERGE_INTERVAL 10
+
+void merge_init(size_t page_cnt);
+void merge_forget(struct frame*);
+void merge_print_stats(void);
+
+#endif /* vm/merge.h */
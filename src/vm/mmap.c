@@ -0,0 +1,124 @@
+/**
+ * @file mmap.c
+ * @brief 文件内存映射
+ *
+ * @details mmap将整个文件映射到用户虚拟地址空间中的连续页面上，
+ * 之后用户进程可以像访问内存一样访问文件，而不必通过read()在内核
+ * 缓冲区与用户缓冲区之间复制数据
+ *
+ * 映射本身只是一组PAGE_MMAP补充页表项，页面的载入与写回由page.c负责，
+ * 本文件只维护进程的映射表
+ */
+
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+static struct mapping* find_mapping(struct process*, mapid_t);
+
+/**
+ * @brief 将FILE映射到进程PCB的用户虚拟地址ADDR处
+ *
+ * @details 映射失败的情形：ADDR为0或者没有页对齐、文件长度为0、
+ * 映射范围与已有页面（代码、数据、栈、其他映射）重叠，
+ * 或者落入了线程栈所在的区域
+ *
+ * @param file 由调用者file_reopen得到，映射成功后归映射所有，失败时由调用者关闭
+ * @param flags MAP_*标志位
+ * @return mapid_t 映射标识符，失败时返回MAP_FAILED
+ */
+mapid_t mmap_map(struct process* pcb, struct file* file, void* addr, int flags) {
+  struct mapping* m;
+  off_t length = file_length(file);
+  size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+  uint8_t* stacks = (uint8_t*)PHYS_BASE - MAX_THREADS * STACK_SIZE;
+  size_t i;
+
+  if (addr == NULL || pg_ofs(addr) != 0 || length == 0 || (flags & ~MAP_SEQUENTIAL) != 0)
+    return MAP_FAILED;
+  if ((uintptr_t)addr + page_cnt * PGSIZE > (uintptr_t)stacks ||
+      (uintptr_t)addr + page_cnt * PGSIZE < (uintptr_t)addr)
+    return MAP_FAILED;
+
+  m = malloc(sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  stream_init(&m->stream, flags & MAP_SEQUENTIAL);
+
+  /* 逐页登记，与已有页面重叠时登记失败，撤销已经登记的页面 */
+  for (i = 0; i < page_cnt; i++) {
+    off_t ofs = i * PGSIZE;
+    uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+    if (!spt_add_mmap(&pcb->spt, (uint8_t*)addr + ofs, file, ofs, read_bytes, &m->stream)) {
+      spt_remove_range(&pcb->spt, pcb->pagedir, addr, (uint8_t*)addr + ofs);
+      free(m);
+      return MAP_FAILED;
+    }
+  }
+
+  m->file = file;
+  m->addr = addr;
+  m->page_cnt = page_cnt;
+  lock_acquire(&pcb->maps_lock);
+  m->id = pcb->maps_next_id++;
+  list_push_back(&pcb->maps_tab, &m->elem);
+  lock_release(&pcb->maps_lock);
+  return m->id;
+}
+
+/**
+ * @brief 撤销映射ID，被修改过的页面写回文件
+ *
+ * @return true 撤销成功
+ * @return false 没有这个映射
+ */
+bool mmap_unmap(struct process* pcb, mapid_t id) {
+  struct mapping* m;
+
+  lock_acquire(&pcb->maps_lock);
+  m = find_mapping(pcb, id);
+  if (m != NULL)
+    list_remove(&m->elem);
+  lock_release(&pcb->maps_lock);
+  if (m == NULL)
+    return false;
+
+  spt_remove_range(&pcb->spt, pcb->pagedir, m->addr,
+                   (uint8_t*)m->addr + m->page_cnt * PGSIZE);
+  file_close(m->file);
+  free(m);
+  return true;
+}
+
+/**
+ * @brief 释放进程的所有映射
+ *
+ * @details 进程退出时调用，必须在spt_destroy()之后：页面的写回
+ * 已经在那里完成，这里只关闭文件并释放映射表项
+ */
+void mmap_destroy(struct process* pcb) {
+  struct mapping* m = NULL;
+
+  list_clean_each(m, &pcb->maps_tab, elem, {
+    file_close(m->file);
+    free(m);
+  });
+}
+
+/* 在映射表中查找ID，调用者必须持有maps_lock */
+static struct mapping* find_mapping(struct process* pcb, mapid_t id) {
+  struct mapping* m = NULL;
+
+  ASSERT(lock_held_by_current_thread(&pcb->maps_lock));
+  list_for_each_entry(m, &pcb->maps_tab, elem) {
+    if (m->id == id)
+      return m;
+  }
+  return NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "vm/prefetch.h"
+
+struct file;
+struct process;
+
+/* 内存映射标识符，在进程内唯一 */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t)-1)
+
+/* mmap的标志位 */
+#define MAP_SEQUENTIAL 0x1 /* 映射将被顺序访问，第一次缺页就开始预读 */
+
+/* 内存映射表项
+ *
+ * 映射建立时只在补充页表中为每一页登记一条PAGE_MMAP表项，
+ * 页面在第一次被访问时才从文件读入；被修改过的页面在换出、
+ * munmap以及进程退出时写回文件，没有被修改过的页面直接丢弃
+ *
+ * 映射上的缺页构成顺序访问流时，后续页面由预读线程异步载入（prefetch.c）
+ */
+struct mapping {
+  mapid_t id;            /* 映射标识符 */
+  struct file* file;     /* 后备文件，由file_reopen得到，与文件描述符无关 */
+  void* addr;            /* 映射的起始用户虚拟地址 */
+  size_t page_cnt;       /* 映射占据的页数 */
+  struct stream stream;  /* 顺序访问流，映射的所有页面都指向它 */
+  struct list_elem elem; /* 进程映射表元素 */
+};
+
+mapid_t mmap_map(struct process*, struct file*, void* addr, int flags);
+bool mmap_unmap(struct process*, mapid_t);
+void mmap_destroy(struct process*);
+
+#endif /* vm/mmap.h */
@@ -0,0 +1,1154 @@
+/**
+ * @file page.c
+ * @brief 补充页表与按需调页
+ *
+ * @details 进程载入时不再为可执行文件的每一页分配物理帧并读入内容，
+ * 而只是在补充页表中记录每一页的来源（文件偏移、全零）
+ * 用户进程（或者代表它访问用户内存的内核）第一次访问某一页时触发
+ * Page Fault，page_fault()调用page_load()找到对应的补充页表项，
+ * 分配物理帧、填充内容并且安装到页目录中，随后重新执行出错的指令
+ *
+ * 只被访问了一小部分页面的大型程序因此只需要为这部分页面付出
+ * 读盘时间和物理内存
+ *
+ * 物理内存不足时，帧表（frame.c）选出牺牲者并调用page_evict()将其换出，
+ * 被换出的页面再次被访问时同样由page_load()换入
+ *
+ * 内存映射文件（mmap.c）的页面同样在这里载入，被修改过的页面
+ * 在换出或者释放时写回文件。顺序访问映射文件时，缺页还会触发
+ * 后台预读（prefetch.c），由预读线程调用page_prefetch()载入后续页面
+ *
+ * 可执行文件的页面被读访问时不再分配私有的物理帧，而是映射运行同一程序的
+ * 所有进程共用的只读副本（share.c）。可写页面第一次被写入时才复制出私有的
+ * 物理帧（写时复制），之后与其他私有页面一样可以被换出
+ *
+ * 全零页面（.bss、栈）也是如此：读访问映射全局的零页，只有写入时才分配
+ * 并清零物理帧，很大但很少被用到的静态缓冲区因此几乎不占用物理内存
+ * 启用了大页的话，整个4 MB区域都是全零页面时改为映射一个大页（large.c）
+ *
+ * 可执行文件的页面缺页时，同一组相邻页面中已经在共享页面表中的那些
+ * 也一并映射（fault-around），它们不需要读盘，却可以省下各自的一次缺页
+ *
+ * fork()时spt_fork()复制父进程的补充页表：已经载入的私有页面转为匿名共享页面，
+ * 父子进程都只读地映射它，之后的写入与可执行文件的页面一样触发写时复制
+ *
+ * 合并线程（merge.c）找到内容相同的匿名页面时，先用page_freeze()将其从页目录中
+ * 移除，确认内容没有改变之后再由page_merge()改为映射同一个共享副本
+ *
+ * 共享内存段（shm.c）的页面载入时映射段的物理帧，所有附加者共用，不会被换出
+ *
+ * 进程可以用madvise()为一段内存给出建议（page_advise()）：随机访问的页面不做
+ * fault-around和预读，顺序访问的页面以最大窗口预读，并清除已经越过的页面的访问位，
+ * 让它们先于其他页面被换出；还可以要求在后台载入一段内存，或者立即释放其物理帧
+ */
+
+#include "vm/page.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/highmem.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/large.h"
+#include "vm/prefetch.h"
+#include "vm/share.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+
+static struct page* lookup(struct spt*, const void* upage);
+static bool load(struct spt*, uint32_t* pd, struct page*, bool write);
+static bool unshare(struct spt*, uint32_t* pd, struct page*);
+static bool add(struct spt*, struct page*);
+static void release_page(unsigned long, void*, void*);
+static void fault_around(struct spt*, uint32_t* pd, struct page*);
+static void drop_behind(struct spt*, uint32_t* pd, struct page*);
+static bool drop_page(struct spt*, struct page*, uint32_t* pd);
+static void settle_prefetch(struct page*, uint32_t* pd);
+static void write_back(struct page*, uint32_t* pd);
+static bool fork_page(struct spt* dst, uint32_t* dst_pd, struct page*, uint32_t* src_pd,
+                      struct file* exec);
+
+/* fault-around的范围：缺页页面所在的、按此页数对齐的一组页面 */
+#define FAULT_AROUND_PAGES 16
+
+/* MADV_SEQUENTIAL的页面缺页时，清除其后方此页数处页面的访问位 */
+#define DROP_BEHIND_PAGES 16
+
+/* 统计数据 */
+static long long file_loads; /* 从文件载入的页面数 */
+static long long zero_loads; /* 以全零页载入的页面数 */
+static long long swap_loads; /* 从交换区换入的页面数 */
+static long long cow_copies; /* 写时复制的页面数 */
+static long long zero_maps;   /* 映射了零页的页面数 */
+static long long zero_copies; /* 其中后来被写入的页面数 */
+static long long mmap_loads;     /* 从映射文件载入的页面数 */
+static long long prefetch_loads; /* 其中由预读线程载入的页面数 */
+static long long mmap_writes;    /* 写回映射文件的页面数 */
+static long long around_hits;    /* fault-around映射的已缓存页面数 */
+static long long around_misses;  /* fault-around时不在缓存中而跳过的页面数 */
+static long long fork_shares;    /* fork()时转为共享的私有页面数 */
+static long long fork_copies;    /* fork()时直接复制的页面数（钉住的页面、大页与交换槽） */
+static long long fork_takes;     /* 写入时只剩一个持有者，不需要复制的共享页面数 */
+static long long advise_drops;   /* MADV_DONTNEED释放的页面数 */
+static long long advise_queued;  /* MADV_WILLNEED提交预读的页面数 */
+static long long drop_behinds;   /* drop-behind清除了访问位的页面数 */
+
+/**
+ * @brief 初始化补充页表
+ *
+ * @param spt 不可以是NULL
+ */
+void spt_init(struct spt* spt) {
+  radix_init(&spt->pages);
+  lock_init(&spt->lock);
+  spt->last = NULL;
+  list_init(&spt->larges);
+  spt->zero_maps = 0;
+  spt->zero_copies = 0;
+  spt->rss = 0;
+  spt->rss_peak = 0;
+  spt->rss_soft = 0;
+  spt->rss_hard = 0;
+  spt->local_evictions = 0;
+}
+
+/**
+ * @brief 释放补充页表中的所有表项，以及它们占用的物理帧和交换槽
+ *
+ * @details 页面同时从页目录PD中移除，此后pagedir_destroy只需要释放页表本身
+ *
+ * @param spt
+ * @param pd 页目录，不能是当前正在使用的页目录
+ */
+void spt_destroy(struct spt* spt, uint32_t* pd) {
+  /* 预读线程可能还持有指向SPT和PD的请求 */
+  prefetch_cancel(spt);
+  lock_acquire(&spt->lock);
+  large_destroy(spt);
+  radix_destroy(&spt->pages, release_page, pd);
+  /* 帧表中的页面随帧表项结算，剩下的是映射过的共享页面 */
+  frame_charge(spt, -(int)spt->rss);
+  spt->last = NULL;
+  zero_maps += spt->zero_maps;
+  zero_copies += spt->zero_copies;
+  lock_release(&spt->lock);
+}
+
+/**
+ * @brief 登记一个从文件载入的页面
+ *
+ * @param upage 用户虚拟页地址，必须页对齐
+ * @param file 后备文件，在页面存在期间必须保持打开
+ * @param ofs 页面内容在文件中的偏移
+ * @param read_bytes 从文件读取的字节数，不超过PGSIZE，剩余部分补零
+ * @return true 登记成功
+ * @return false 内存不足，或者该页已经被登记过了
+ */
+bool spt_add_file(struct spt* spt, void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                  bool writable) {
+  struct page* p;
+
+  ASSERT(read_bytes <= PGSIZE);
+  p = malloc(sizeof *p);
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->type = PAGE_FILE;
+  p->writable = writable;
+  p->frame = NULL;
+  p->advice = MADV_NORMAL;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->stream = NULL;
+  p->prefetched = false;
+  p->swap_slot = SWAP_ERROR;
+  p->share = NULL;
+  p->large = NULL;
+  p->segment = NULL;
+  return add(spt, p);
+}
+
+/**
+ * @brief 登记一个全零页面
+ *
+ * @return true 登记成功
+ * @return false 内存不足，或者该页已经被登记过了
+ */
+bool spt_add_zero(struct spt* spt, void* upage, bool writable) {
+  struct page* p = malloc(sizeof *p);
+
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->type = PAGE_ZERO;
+  p->writable = writable;
+  p->frame = NULL;
+  p->advice = MADV_NORMAL;
+  p->file = NULL;
+  p->ofs = 0;
+  p->read_bytes = 0;
+  p->stream = NULL;
+  p->prefetched = false;
+  p->swap_slot = SWAP_ERROR;
+  p->share = NULL;
+  p->large = NULL;
+  p->segment = NULL;
+  return add(spt, p);
+}
+
+/**
+ * @brief 登记一个内存映射文件的页面
+ *
+ * @param file 映射的后备文件，在页面存在期间必须保持打开
+ * @param read_bytes 页面中属于文件的字节数，只有这部分会被写回
+ * @param stream 映射的顺序访问流，在页面存在期间必须有效
+ * @return true 登记成功
+ * @return false 内存不足，或者该页已经被登记过了
+ */
+bool spt_add_mmap(struct spt* spt, void* upage, struct file* file, off_t ofs,
+                  uint32_t read_bytes, struct stream* stream) {
+  struct page* p;
+
+  ASSERT(read_bytes <= PGSIZE);
+  p = malloc(sizeof *p);
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->type = PAGE_MMAP;
+  p->writable = true;
+  p->frame = NULL;
+  p->advice = MADV_NORMAL;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->stream = stream;
+  p->prefetched = false;
+  p->swap_slot = SWAP_ERROR;
+  p->share = NULL;
+  p->large = NULL;
+  p->segment = NULL;
+  return add(spt, p);
+}
+
+/**
+ * @brief 登记一个共享内存段的页面
+ *
+ * @param segment 页面所属的段，在页面存在期间必须保持附加
+ * @param ofs 页面在段内的偏移
+ * @return true 登记成功
+ * @return false 内存不足，或者该页已经被登记过了
+ */
+bool spt_add_shm(struct spt* spt, void* upage, struct segment* segment, off_t ofs) {
+  struct page* p = malloc(sizeof *p);
+
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->type = PAGE_SHM;
+  p->writable = true;
+  p->frame = NULL;
+  p->advice = MADV_NORMAL;
+  p->file = NULL;
+  p->ofs = ofs;
+  p->read_bytes = 0;
+  p->stream = NULL;
+  p->prefetched = false;
+  p->swap_slot = SWAP_ERROR;
+  p->share = NULL;
+  p->large = NULL;
+  p->segment = segment;
+  return add(spt, p);
+}
+
+/**
+ * @brief 将补充页表SRC中的页面复制到新的补充页表DST中，用于fork()
+ *
+ * @details 已经载入私有物理帧的页面转为匿名共享页面，父子进程只读地映射
+ * 同一个物理帧，任何一方写入时复制出私有的副本，最后一个持有者写入时直接
+ * 接管物理帧。已经映射了共享页面的页面增加一个引用，被换出的页面复制
+ * 一份交换槽，尚未载入的页面只复制表项
+ *
+ * 内存映射文件和共享内存段的页面不被继承；被钉住的页面（另一个线程的系统调用正在访问）
+ * 不能替换其物理帧，直接为子进程复制一份
+ *
+ * @param dst_pd DST所属的页目录，尚未被使用
+ * @param src_pd SRC所属的页目录，其中的私有页面被改为只读
+ * @param exec 子进程的可执行文件，DST中的PAGE_FILE页面改为从它读取
+ * @return false 内存或者交换区不足，已经复制的表项随spt_destroy()释放
+ */
+bool spt_fork(struct spt* dst, uint32_t* dst_pd, struct spt* src, uint32_t* src_pd,
+              struct file* exec) {
+  struct page* batch[16];
+  unsigned long indexes[16];
+  unsigned long first = 0;
+  size_t cnt, i;
+  bool success = true;
+
+  lock_acquire(&src->lock);
+  lock_acquire(&dst->lock);
+  do {
+    cnt = radix_gang_lookup(&src->pages, first, 16, (void**)batch, indexes);
+    for (i = 0; i < cnt && success; i++)
+      success = fork_page(dst, dst_pd, batch[i], src_pd, exec);
+    if (cnt > 0)
+      first = indexes[cnt - 1] + 1;
+  } while (success && cnt == 16);
+  lock_release(&dst->lock);
+  lock_release(&src->lock);
+  return success;
+}
+
+/**
+ * @brief 从补充页表中删除UPAGE的表项（如果有的话）
+ *
+ * @details 同时将页面从页目录PD中移除，并释放其物理帧或交换槽
+ */
+void spt_remove(struct spt* spt, uint32_t* pd, void* upage) {
+  struct page* p;
+
+  lock_acquire(&spt->lock);
+  large_unmap_range(spt, upage, (uint8_t*)upage + PGSIZE);
+  p = lookup(spt, upage);
+  /* 所在的大页无法拆分的话只能保留该页面 */
+  if (p != NULL && p->large == NULL) {
+    radix_delete(&spt->pages, pg_no(upage));
+    if (spt->last == p)
+      spt->last = NULL;
+    release_page(0, p, pd);
+  }
+  lock_release(&spt->lock);
+}
+
+/**
+ * @brief 删除[START, END)范围内的所有表项，用于释放整个线程栈
+ *
+ * @details 与逐页调用spt_remove()不同，只会访问实际存在的表项，
+ * 栈槽中未被使用的部分不需要任何代价
+ *
+ * @param start 必须页对齐
+ * @param end 必须页对齐
+ */
+void spt_remove_range(struct spt* spt, uint32_t* pd, void* start, void* end) {
+  struct page* batch[16];
+  unsigned long indexes[16];
+  unsigned long first = pg_no(start);
+  size_t cnt, i;
+
+  ASSERT(pg_ofs(start) == 0 && pg_ofs(end) == 0);
+
+  lock_acquire(&spt->lock);
+  large_unmap_range(spt, start, end);
+  for (;;) {
+    cnt = radix_gang_lookup(&spt->pages, first, 16, (void**)batch, indexes);
+    for (i = 0; i < cnt && indexes[i] < pg_no(end); i++) {
+      if (batch[i]->large != NULL)
+        continue;
+      radix_delete(&spt->pages, indexes[i]);
+      if (spt->last == batch[i])
+        spt->last = NULL;
+      release_page(indexes[i], batch[i], pd);
+    }
+    if (cnt < 16 || i < cnt)
+      break;
+    first = indexes[cnt - 1] + 1;
+  }
+  lock_release(&spt->lock);
+}
+
+/**
+ * @brief 查找用户虚拟地址UADDR所在页面的补充页表项
+ *
+ * @return struct page* 没有找到时返回NULL
+ */
+struct page* spt_find(struct spt* spt, const void* uaddr) {
+  struct page* p;
+
+  lock_acquire(&spt->lock);
+  p = lookup(spt, pg_round_down(uaddr));
+  lock_release(&spt->lock);
+  return p;
+}
+
+/**
+ * @brief 将UADDR所在的页面载入物理内存，并安装到页目录PD中
+ *
+ * @details 由page_fault()调用，也可用于提前载入页面
+ * 页面已经被（比如同一进程的另一个线程）载入时直接返回true
+ * 写入只读映射的共享页面时，为其复制出私有的物理帧
+ * 新载入可执行文件的页面时执行fault-around，新载入映射页时更新其顺序访问流，
+ * 被建议为MADV_RANDOM的页面两者都不做；MADV_SEQUENTIAL的页面还会执行drop-behind
+ *
+ * @param write 出错的访问是否为写操作
+ * @return true 页面已经就绪，可以重新执行出错的指令
+ * @return false 没有对应的表项、对只读页面执行写操作，或者内存不足
+ */
+bool page_load(struct spt* spt, uint32_t* pd, void* uaddr, bool write) {
+  struct page* p;
+  bool present, success = false;
+
+  lock_acquire(&spt->lock);
+  p = lookup(spt, pg_round_down(uaddr));
+  if (p != NULL && (!write || p->writable)) {
+    present = p->frame != NULL || p->share != NULL;
+    success = load(spt, pd, p, write);
+    if (success && !present && p->advice != MADV_RANDOM) {
+      if (p->type == PAGE_FILE)
+        fault_around(spt, pd, p);
+      else if (p->type == PAGE_MMAP)
+        prefetch_fault(spt, pd, p);
+    }
+    if (success && !present && p->advice == MADV_SEQUENTIAL)
+      drop_behind(spt, pd, p);
+  }
+  lock_release(&spt->lock);
+  return success;
+}
+
+/**
+ * @brief 换出页面P，其物理帧随后可以被复用
+ *
+ * @details 由帧表调用，调用者必须持有P所属补充页表的锁
+ * 未被修改过的文件页直接丢弃，被修改过的映射页写回文件，其他页面写入交换区
+ *
+ * @param pd P所属的页目录
+ * @return true 换出成功，P->frame被置为NULL，但帧表项并没有被释放
+ * @return false 交换区已满或者不存在，P保持原样
+ */
+bool page_evict(struct page* p, uint32_t* pd) {
+  bool dirty;
+  void* kpage;
+  size_t slot;
+
+  ASSERT(p->frame != NULL);
+
+  /* 先取消映射，此后进程访问该页面会在page_load()中等待补充页表锁 */
+  pagedir_clear_page(pd, p->upage);
+  dirty = pagedir_is_dirty(pd, p->upage);
+  settle_prefetch(p, pd);
+
+  if ((p->type == PAGE_FILE || p->type == PAGE_MMAP) && !dirty) {
+    p->frame = NULL;
+    return true;
+  }
+  if (p->type == PAGE_MMAP) {
+    write_back(p, pd);
+    p->frame = NULL;
+    return true;
+  }
+
+  kpage = kmap(p->frame->paddr);
+  slot = swap_out(kpage);
+  kunmap(kpage);
+  if (slot == SWAP_ERROR) {
+    /* 页表项被清除之后依然是不存在的，可以重新安装 */
+    pagedir_set_frame(pd, p->upage, p->frame->paddr, p->writable);
+    pagedir_set_dirty(pd, p->upage, dirty);
+    return false;
+  }
+
+  p->type = PAGE_SWAP;
+  p->swap_slot = slot;
+  p->frame = NULL;
+  return true;
+}
+
+/**
+ * @brief 按照madvise()的建议ADVICE处理[ADDR, ADDR + LEN)中的页面
+ *
+ * @details MADV_NORMAL、MADV_RANDOM和MADV_SEQUENTIAL记录在范围内的每个页面中，
+ * 影响之后的缺页处理；MADV_WILLNEED将范围交给预读线程在后台载入；
+ * MADV_DONTNEED立即释放范围内页面的物理帧、共享副本和交换槽：
+ * 匿名页面转为全零页，下次访问时补零；可执行文件的页面即使已经被写入、换出，
+ * 下次访问时也重新从文件读取；被修改过的映射页先写回文件，之后同样从文件读取。
+ * 被钉住的页面、无法拆分的大页中的页面
+ * 以及共享内存段的页面保持原样
+ *
+ * 范围中没有登记的页面直接忽略
+ *
+ * @param addr 必须页对齐
+ * @param len 向上取整到整页
+ * @return false ADDR没有页对齐、范围超出用户地址空间，或者ADVICE无效
+ */
+bool page_advise(struct spt* spt, uint32_t* pd, void* addr, size_t len, int advice) {
+  uint8_t* start = addr;
+  uint8_t* end = start + ROUND_UP(len, PGSIZE);
+  struct page* batch[16];
+  unsigned long indexes[16];
+  unsigned long first = pg_no(start);
+  size_t cnt, i;
+
+  if (pg_ofs(start) != 0 || end < start || end > (uint8_t*)PHYS_BASE)
+    return false;
+  if (advice < MADV_NORMAL || advice > MADV_DONTNEED)
+    return false;
+  if (end == start)
+    return true;
+
+  if (advice == MADV_WILLNEED) {
+    if (prefetch_range(spt, pd, start, (end - start) / PGSIZE))
+      advise_queued += (end - start) / PGSIZE;
+    return true;
+  }
+
+  lock_acquire(&spt->lock);
+  /* 直接释放大页会留下没有内容的匿名页面表项，因此只拆分，再由drop_page()逐页释放 */
+  if (advice == MADV_DONTNEED)
+    large_split_range(spt, start, end);
+  for (;;) {
+    cnt = radix_gang_lookup(&spt->pages, first, 16, (void**)batch, indexes);
+    for (i = 0; i < cnt && indexes[i] < pg_no(end); i++) {
+      if (advice != MADV_DONTNEED)
+        batch[i]->advice = advice;
+      else if (drop_page(spt, batch[i], pd))
+        advise_drops++;
+    }
+    if (cnt < 16 || i < cnt)
+      break;
+    first = indexes[cnt - 1] + 1;
+  }
+  lock_release(&spt->lock);
+  return true;
+}
+
+/**
+ * @brief 载入并钉住用户缓冲区[UADDR, UADDR + SIZE)占据的所有页面
+ *
+ * @details 内核访问用户缓冲区期间（比如读写文件时），这些页面不会被换出
+ * 结束访问后必须调用page_unpin()
+ *
+ * 可写页面总是被载入私有的物理帧，以免钉住期间被写时复制替换掉；
+ * 只读的共享页面本来就不会被换出，不需要钉住
+ *
+ * @param write 内核是否会写入缓冲区
+ * @return true 所有页面均已钉住
+ * @return false 缓冲区中有无效的页面，此时没有任何页面被钉住
+ */
+bool page_pin(struct spt* spt, uint32_t* pd, const void* uaddr, size_t size, bool write) {
+  const uint8_t* start = pg_round_down(uaddr);
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+  const uint8_t* upage;
+
+  for (upage = start; upage < end; upage += PGSIZE) {
+    struct page* p;
+    bool pinned = false;
+
+    lock_acquire(&spt->lock);
+    p = lookup(spt, upage);
+    if (p != NULL && (!write || p->writable) && load(spt, pd, p, write || p->writable)) {
+      if (p->frame != NULL)
+        frame_pin(p->frame);
+      else if (p->large != NULL)
+        p->large->pin_cnt++;
+      pinned = true;
+    }
+    lock_release(&spt->lock);
+
+    if (!pinned) {
+      page_unpin(spt, start, upage - start);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 撤销page_pin()
+ */
+void page_unpin(struct spt* spt, const void* uaddr, size_t size) {
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+  const uint8_t* upage;
+
+  for (upage = pg_round_down(uaddr); upage < end; upage += PGSIZE) {
+    struct page* p;
+
+    lock_acquire(&spt->lock);
+    p = lookup(spt, upage);
+    if (p != NULL && p->frame != NULL)
+      frame_unpin(p->frame);
+    else if (p != NULL && p->large != NULL)
+      p->large->pin_cnt--;
+    lock_release(&spt->lock);
+  }
+}
+
+/**
+ * @brief 从页目录中移除私有页面P，使其内容在合并期间不会被进程修改
+ *
+ * @details 页面自上次清除Dirty位之后被写过的话，其内容可能已经与合并线程
+ * 检查过的不同，此时恢复映射并返回false；成功之后必须调用page_merge()
+ * 或者page_thaw()。进程在此期间访问该页面会在page_load()中等待补充页表锁
+ * 调用者必须持有P所属补充页表的锁
+ */
+bool page_freeze(struct page* p, uint32_t* pd) {
+  ASSERT(p->frame != NULL);
+
+  pagedir_clear_page(pd, p->upage);
+  if (!pagedir_is_dirty(pd, p->upage))
+    return true;
+  /* 页表项被清除之后依然是不存在的，可以重新安装 */
+  pagedir_set_frame(pd, p->upage, p->frame->paddr, p->writable);
+  pagedir_set_dirty(pd, p->upage, true);
+  return false;
+}
+
+/**
+ * @brief 撤销page_freeze()，重新安装P的物理帧
+ */
+void page_thaw(struct page* p, uint32_t* pd) {
+  pagedir_set_frame(pd, p->upage, p->frame->paddr, p->writable);
+}
+
+/**
+ * @brief 将page_freeze()过的页面P改为只读地映射内容相同的共享页面S
+ *
+ * @details S的一个引用转交给P，之后P与fork()留下的匿名共享页面一样在写入时复制
+ * S由P的物理帧创建时只释放帧表项，否则连同物理帧一起释放，
+ * S代替P的物理帧计入驻留集（零页除外）
+ * 调用者必须持有P所属补充页表的锁
+ */
+void page_merge(struct page* p, uint32_t* pd, struct share* s) {
+  struct frame* f = p->frame;
+  struct spt* spt = f->spt;
+
+  /* 页表已经存在，只读地重新安装不会失败 */
+  pagedir_set_frame(pd, p->upage, s->paddr, false);
+  p->frame = NULL;
+  p->share = s;
+  if (f->paddr == s->paddr)
+    frame_detach(f);
+  else
+    frame_free(f);
+  if (!share_is_zero(s))
+    frame_charge(spt, 1);
+}
+
+/* 打印按需调页的统计数据 */
+void page_print_stats(void) {
+  printf("Paging: %lld pages loaded from files, %lld zero-filled, %lld from swap, "
+         "%lld copied on write\n",
+         file_loads, zero_loads, swap_loads, cow_copies);
+  printf("Zero page: mapped by %lld pages of exited processes, %lld of them later written\n",
+         zero_maps, zero_copies);
+  printf("Mmap: %lld pages loaded (%lld by prefetch), %lld written back\n", mmap_loads,
+         prefetch_loads, mmap_writes);
+  printf("Fault-around: %lld cached pages mapped, %lld neighbours not cached\n", around_hits,
+         around_misses);
+  printf("Fork: %lld pages shared copy-on-write, %lld copied eagerly, "
+         "%lld taken over without copying\n",
+         fork_shares, fork_copies, fork_takes);
+  printf("Advice: %lld pages dropped, %lld pages queued for prefetch, %lld dropped behind\n",
+         advise_drops, advise_queued, drop_behinds);
+}
+
+/**
+ * @brief 查找UPAGE的表项，优先检查最近一次命中的表项
+ *
+ * @details 调用者必须持有spt->lock
+ */
+static struct page* lookup(struct spt* spt, const void* upage) {
+  struct page* p = spt->last;
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  if (p == NULL || p->upage != upage) {
+    p = radix_lookup(&spt->pages, pg_no(upage));
+    if (p != NULL)
+      spt->last = p;
+  }
+  return p;
+}
+
+/**
+ * @brief 确保页面P位于物理内存中，并安装在页目录PD中
+ *
+ * @details 可执行文件的页面和全零页面在不需要写入时映射共享的只读副本，
+ * 需要写入时载入私有的物理帧，已经映射了共享副本的话将其复制一份
+ * 调用者必须持有spt->lock
+ *
+ * @param write 是否需要写入页面
+ */
+static bool load(struct spt* spt, uint32_t* pd, struct page* p, bool write) {
+  struct frame* f;
+  void* kpage;
+
+  ASSERT(lock_held_by_current_thread(&spt->lock));
+  if (p->type == PAGE_SHM)
+    return shm_load(p, pd);
+  if (p->frame != NULL || p->large != NULL)
+    return true;
+  /* 限制了驻留集的进程不使用大页，以免一次占用整整1024个物理帧 */
+  if (write && p->type == PAGE_ZERO && spt->rss_soft == 0 && spt->rss_hard == 0 &&
+      large_map(spt, pd, p))
+    return true;
+  if (p->share != NULL)
+    return write ? unshare(spt, pd, p) : true;
+
+  if (p->type == PAGE_FILE && !write) {
+    /* 共享副本同样计入驻留集 */
+    if (!frame_make_room(spt))
+      return false;
+    p->share = share_get(p->file, p->ofs, p->read_bytes);
+    if (p->share != NULL) {
+      if (pagedir_set_frame(pd, p->upage, p->share->paddr, false)) {
+        frame_charge(spt, 1);
+        return true;
+      }
+      share_put(p->share);
+      p->share = NULL;
+    }
+    /* 共享失败的话退回到私有的物理帧 */
+  }
+  if (p->type == PAGE_ZERO && !write) {
+    p->share = share_zero();
+    if (pagedir_set_frame(pd, p->upage, p->share->paddr, false)) {
+      spt->zero_maps++;
+      return true;
+    }
+    share_put(p->share);
+    p->share = NULL;
+  }
+
+  f = frame_alloc(spt, p->type == PAGE_ZERO);
+  if (f == NULL)
+    return false;
+
+  switch (p->type) {
+    case PAGE_FILE:
+    case PAGE_MMAP:
+      kpage = kmap(f->paddr);
+      if (file_read_at(p->file, kpage, p->read_bytes, p->ofs) != (off_t)p->read_bytes) {
+        kunmap(kpage);
+        frame_free(f);
+        return false;
+      }
+      memset((uint8_t*)kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+      kunmap(kpage);
+      if (p->type == PAGE_MMAP)
+        mmap_loads++;
+      else
+        file_loads++;
+      break;
+    case PAGE_ZERO:
+      zero_loads++;
+      break;
+    case PAGE_SWAP:
+      kpage = kmap(f->paddr);
+      swap_in(p->swap_slot, kpage);
+      kunmap(kpage);
+      swap_loads++;
+      break;
+    default:
+      NOT_REACHED();
+  }
+
+  if (!pagedir_set_frame(pd, p->upage, f->paddr, p->writable)) {
+    frame_free(f);
+    return false;
+  }
+  if (p->type == PAGE_SWAP) {
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_ERROR;
+  }
+  if (p->type == PAGE_ZERO || p->type == PAGE_SWAP)
+    p->type = PAGE_ANON;
+  p->frame = f;
+  frame_install(f, p, spt, pd);
+  return true;
+}
+
+/**
+ * @brief 为映射了共享副本的页面P复制出私有的物理帧，并以可写方式重新安装
+ *
+ * @details 映射了零页的页面不需要复制，直接分配清零的物理帧即可；
+ * fork()留下的匿名共享页面如果只剩下P一个持有者，直接接管其物理帧；
+ * 接管之后不能再失败，所以先为其分配帧表项
+ *
+ * 私有的物理帧代替共享副本计入驻留集，所以分配之前先将共享副本移出驻留集，
+ * 失败时再计入，已经达到上限的进程也可以写入自己映射的共享页面
+ * 调用者必须持有spt->lock
+ */
+static bool unshare(struct spt* spt, uint32_t* pd, struct page* p) {
+  bool zero = share_is_zero(p->share);
+  bool take = false;
+  struct frame* f;
+  void *src, *dst;
+
+  ASSERT(p->writable);
+  if (!zero)
+    frame_charge(spt, -1);
+  if (!zero && p->share->inode == NULL) {
+    f = frame_adopt(p->share->paddr);
+    if (f == NULL)
+      goto fail;
+    take = share_take(p->share);
+    if (!take)
+      frame_detach(f);
+  }
+
+  if (!take) {
+    f = frame_alloc(spt, zero);
+    if (f == NULL)
+      goto fail;
+    if (!zero) {
+      src = kmap(p->share->paddr);
+      dst = kmap(f->paddr);
+      memcpy(dst, src, PGSIZE);
+      kunmap(dst);
+      kunmap(src);
+    }
+  }
+
+  pagedir_clear_page(pd, p->upage);
+  if (!pagedir_set_frame(pd, p->upage, f->paddr, true)) {
+    /* 接管的帧原本就映射在UPAGE处，页表一定存在 */
+    ASSERT(!take);
+    pagedir_set_frame(pd, p->upage, p->share->paddr, false);
+    frame_free(f);
+    goto fail;
+  }
+  if (take)
+    fork_takes++;
+  else
+    share_put(p->share);
+  p->share = NULL;
+  p->frame = f;
+  frame_install(f, p, spt, pd);
+  if (zero) {
+    p->type = PAGE_ANON;
+    spt->zero_copies++;
+    zero_loads++;
+  } else if (!take)
+    cow_copies++;
+  return true;
+
+fail:
+  if (!zero)
+    frame_charge(spt, 1);
+  return false;
+}
+
+/**
+ * @brief 将表项P插入补充页表，失败时释放P
+ */
+static bool add(struct spt* spt, struct page* p) {
+  bool success;
+
+  ASSERT(pg_ofs(p->upage) == 0);
+  ASSERT(is_user_vaddr(p->upage));
+
+  lock_acquire(&spt->lock);
+  success = radix_insert(&spt->pages, pg_no(p->upage), p);
+  lock_release(&spt->lock);
+  if (!success)
+    free(p);
+  return success;
+}
+
+/**
+ * @brief 释放补充页表项P及其占用的物理帧或交换槽，作为radix_destroy的回调
+ *
+ * @param pd_ P所属的页目录，物理帧需要先从中移除
+ */
+static void release_page(unsigned long index UNUSED, void* p_, void* pd_) {
+  struct page* p = p_;
+  uint32_t* pd = pd_;
+
+  ASSERT(p->large == NULL);
+  if (p->frame != NULL) {
+    pagedir_clear_page(pd, p->upage);
+    settle_prefetch(p, pd);
+    if (p->type == PAGE_MMAP && pagedir_is_dirty(pd, p->upage))
+      write_back(p, pd);
+    frame_free(p->frame);
+  } else if (p->share != NULL || p->type == PAGE_SHM) {
+    pagedir_clear_page(pd, p->upage);
+    if (p->share != NULL)
+      share_put(p->share);
+  } else if (p->type == PAGE_SWAP)
+    swap_free(p->swap_slot);
+  free(p);
+}
+
+/**
+ * @brief 可执行文件的页面P刚刚被载入，一并映射其相邻页面中已经被缓存的那些
+ *
+ * @details 相邻页面指与P位于同一组按FAULT_AROUND_PAGES对齐的页面中，
+ * 来自同一文件且尚未载入的PAGE_FILE页面。其内容已经在共享页面表中的话
+ * 只读地映射共享副本，不需要读盘；不在表中的页面留给它们自己的缺页
+ * 调用者必须持有spt->lock
+ */
+static void fault_around(struct spt* spt, uint32_t* pd, struct page* p) {
+  uint8_t* start = (uint8_t*)((uintptr_t)p->upage & ~(FAULT_AROUND_PAGES * PGSIZE - 1));
+  unsigned i;
+
+  /* 映射的页面计入驻留集，限制了驻留集的进程不为用不到的页面换出自己的页面 */
+  if (spt->rss_soft != 0 || spt->rss_hard != 0)
+    return;
+  for (i = 0; i < FAULT_AROUND_PAGES; i++) {
+    uint8_t* upage = start + i * PGSIZE;
+    struct page* q;
+    struct share* s;
+
+    if (upage == p->upage)
+      continue;
+    /* 不经过lookup()，以免替换掉最近命中的表项P */
+    q = radix_lookup(&spt->pages, pg_no(upage));
+    if (q == NULL || q->type != PAGE_FILE || q->file != p->file || q->frame != NULL ||
+        q->share != NULL)
+      continue;
+    s = share_lookup(q->file, q->ofs, q->read_bytes);
+    if (s == NULL) {
+      around_misses++;
+      continue;
+    }
+    if (!pagedir_set_frame(pd, q->upage, s->paddr, false)) {
+      share_put(s);
+      continue;
+    }
+    q->share = s;
+    frame_charge(spt, 1);
+    around_hits++;
+  }
+}
+
+/**
+ * @brief MADV_SEQUENTIAL的页面P刚刚被载入，清除其后方页面的访问位（drop-behind）
+ *
+ * @details 顺序扫描时已经被越过的页面很可能不会再被访问，清除访问位之后
+ * 时钟算法不再给它们第二次机会，下一次需要换出页面时它们首先被换出，
+ * 而不是其他进程正在使用的页面
+ * 调用者必须持有spt->lock
+ */
+static void drop_behind(struct spt* spt, uint32_t* pd, struct page* p) {
+  struct page* q;
+
+  if (pg_no(p->upage) < DROP_BEHIND_PAGES)
+    return;
+  /* 不经过lookup()，以免替换掉最近命中的表项P */
+  q = radix_lookup(&spt->pages, pg_no(p->upage) - DROP_BEHIND_PAGES);
+  if (q != NULL && q->frame != NULL && q->advice == MADV_SEQUENTIAL &&
+      pagedir_is_accessed(pd, q->upage)) {
+    pagedir_set_accessed(pd, q->upage, false);
+    drop_behinds++;
+  }
+}
+
+/**
+ * @brief 为MADV_DONTNEED释放页面P的物理帧、共享副本或者交换槽，保留表项
+ *
+ * @details 调用者必须持有P所属补充页表SPT的锁，大页已经被拆分
+ * @return false P被钉住、仍在大页中，或者是共享内存段的页面，没有被释放
+ */
+static bool drop_page(struct spt* spt, struct page* p, uint32_t* pd) {
+  if (p->large != NULL || p->type == PAGE_SHM || (p->frame != NULL && p->frame->pin_cnt > 0))
+    return false;
+
+  if (p->frame != NULL) {
+    pagedir_clear_page(pd, p->upage);
+    settle_prefetch(p, pd);
+    if (p->type == PAGE_MMAP && pagedir_is_dirty(pd, p->upage))
+      write_back(p, pd);
+    frame_free(p->frame);
+    p->frame = NULL;
+  } else if (p->share != NULL) {
+    pagedir_clear_page(pd, p->upage);
+    if (!share_is_zero(p->share))
+      frame_charge(spt, -1);
+    share_put(p->share);
+    p->share = NULL;
+  } else if (p->type == PAGE_SWAP) {
+    swap_free(p->swap_slot);
+    p->swap_slot = SWAP_ERROR;
+  } else
+    return false;
+
+  /* 来自可执行文件的页面以后重新从文件读取，其他页面补零 */
+  if (p->type == PAGE_ANON || p->type == PAGE_SWAP)
+    p->type = p->file != NULL ? PAGE_FILE : PAGE_ZERO;
+  return true;
+}
+
+/**
+ * @brief 由预读线程调用，载入[UPAGE, UPAGE + PAGE_CNT * PGSIZE)中尚未载入的映射页
+ *
+ * @details 遇到不是映射页的页面或者载入失败时停止。每载入一页就释放一次
+ * 补充页表锁，进程的缺页不必等待整个窗口读完
+ *
+ * 预读的页面访问位为0，并被标记为预读页面：时钟算法发现它被访问过时
+ * 计为命中，没有被访问就被换出或者释放时计为未命中，并缩小预读窗口
+ *
+ * @param advised 是否为MADV_WILLNEED的请求：此时可执行文件的页面与被换出的页面
+ * 也一并载入，其他类型的页面直接跳过，只在遇到空洞时停止
+ */
+void page_prefetch(struct spt* spt, uint32_t* pd, void* upage, size_t page_cnt, bool advised) {
+  uint8_t* u = upage;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++, u += PGSIZE) {
+    struct page* p;
+    bool success = true;
+
+    if (!is_user_vaddr(u))
+      break;
+    lock_acquire(&spt->lock);
+    p = lookup(spt, u);
+    if (p == NULL || (!advised && p->type != PAGE_MMAP))
+      success = false;
+    else if (p->frame == NULL && p->share == NULL && p->large == NULL &&
+             (p->type == PAGE_MMAP || p->type == PAGE_FILE || p->type == PAGE_SWAP)) {
+      success = load(spt, pd, p, false);
+      if (success && p->type == PAGE_MMAP) {
+        p->prefetched = true;
+        prefetch_loads++;
+      }
+    }
+    lock_release(&spt->lock);
+    if (!success)
+      break;
+  }
+}
+
+/**
+ * @brief 页面P即将离开物理内存，结算其预读是否命中
+ *
+ * @details P已经从页目录PD中移除，但访问位依然可以读取
+ * 调用者必须持有P所属补充页表的锁
+ */
+static void settle_prefetch(struct page* p, uint32_t* pd) {
+  if (!p->prefetched)
+    return;
+  p->prefetched = false;
+  if (pagedir_is_accessed(pd, p->upage))
+    prefetch_hit();
+  else
+    prefetch_miss(p->stream);
+}
+
+/**
+ * @brief 将映射页P的内容写回文件
+ *
+ * @details 只写回属于文件的READ_BYTES字节，映射不会改变文件长度
+ * 写回之后清除脏位，页面可以继续留在内存中
+ */
+static void write_back(struct page* p, uint32_t* pd) {
+  void* kpage;
+
+  ASSERT(p->type == PAGE_MMAP && p->frame != NULL);
+  kpage = kmap(p->frame->paddr);
+  file_write_at(p->file, kpage, p->read_bytes, p->ofs);
+  kunmap(kpage);
+  pagedir_set_dirty(pd, p->upage, false);
+  mmap_writes++;
+}
+
+/**
+ * @brief 为子进程复制父进程的页面P，插入补充页表DST
+ *
+ * @details 调用者必须同时持有P所属的补充页表和DST的锁
+ * 分配内存时可能换出P，因此在为Q分配内存之后才读取P的状态；之后再分配内存时
+ * P的帧总是钉住的（复制已被钉住的帧，或者share_anon()前后的frame_pin()），
+ * 回收大页时也会跳过调用者自己的补充页表中的大页
+ *
+ * 页面被修改过的话，其内容与可执行文件不再一致，父子进程中的
+ * PAGE_FILE页面都转为PAGE_ANON，以免换出时被丢弃
+ */
+static bool fork_page(struct spt* dst, uint32_t* dst_pd, struct page* p, uint32_t* src_pd,
+                      struct file* exec) {
+  struct page* q;
+  void *src, *kpage;
+
+  if (p->type == PAGE_MMAP || p->type == PAGE_SHM)
+    return true;
+  q = malloc(sizeof *q);
+  if (q == NULL)
+    return false;
+  *q = *p;
+  q->frame = NULL;
+  q->share = NULL;
+  q->large = NULL;
+  q->swap_slot = SWAP_ERROR;
+  if (p->file != NULL)
+    q->file = exec;
+
+  if (p->large != NULL || (p->frame != NULL && p->frame->pin_cnt > 0)) {
+    /* 钉住的帧只会在持有补充页表锁时被解除钉住，此时可以安全地读取；
+     * 大页不能以4 KB为单位共享，子进程同样得到普通页面的副本 */
+    struct frame* f = frame_alloc(dst, false);
+
+    if (f == NULL)
+      goto fail;
+    src = kmap(p->large != NULL ? large_frame(p) : p->frame->paddr);
+    kpage = kmap(f->paddr);
+    memcpy(kpage, src, PGSIZE);
+    kunmap(kpage);
+    kunmap(src);
+    if (pagedir_is_dirty(src_pd, p->upage))
+      q->type = PAGE_ANON;
+    if (!pagedir_set_frame(dst_pd, q->upage, f->paddr, q->writable)) {
+      frame_free(f);
+      goto fail;
+    }
+    q->frame = f;
+    frame_install(f, q, dst, dst_pd);
+    fork_copies++;
+  } else if (p->frame != NULL) {
+    struct frame* f = p->frame;
+    struct spt* spt = f->spt;
+    struct share* s;
+
+    frame_pin(f);
+    s = share_anon(f->paddr);
+    frame_unpin(f);
+    if (s == NULL)
+      goto fail;
+    if (pagedir_is_dirty(src_pd, p->upage))
+      p->type = q->type = PAGE_ANON;
+
+    /* 页表已经存在，只读地重新安装不会失败 */
+    pagedir_clear_page(src_pd, p->upage);
+    frame_detach(f);
+    pagedir_set_frame(src_pd, p->upage, s->paddr, false);
+    p->frame = NULL;
+    p->share = s;
+    /* 共享副本代替物理帧计入父进程的驻留集 */
+    frame_charge(spt, 1);
+    fork_shares++;
+  } else if (p->type == PAGE_SWAP) {
+    kpage = palloc_get_page(0);
+    if (kpage == NULL)
+      goto fail;
+    swap_in(p->swap_slot, kpage);
+    q->swap_slot = swap_out(kpage);
+    palloc_free_page(kpage);
+    if (q->swap_slot == SWAP_ERROR)
+      goto fail;
+    fork_copies++;
+  }
+
+  if (p->share != NULL) {
+    share_dup(p->share);
+    if (!pagedir_set_frame(dst_pd, q->upage, p->share->paddr, false)) {
+      share_put(p->share);
+      goto fail;
+    }
+    q->share = p->share;
+    /* 子进程的驻留集与父进程相同，父进程已经遵守了同样的上限 */
+    if (!share_is_zero(q->share))
+      frame_charge(dst, 1);
+  }
+
+  if (!radix_insert(&dst->pages, pg_no(q->upage), q)) {
+    release_page(0, q, dst_pd);
+    return false;
+  }
+  return true;
+
+fail:
+  free(q);
+  return false;
+}
@@ -0,0 +1,142 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <list.h>
+#include <radix.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct frame;
+struct large;
+struct segment;
+struct share;
+struct stream;
+
+/* madvise()的建议，前三种是记录在页面中的访问模式，后两种是一次性的操作 */
+#define MADV_NORMAL 0     /* 默认的访问模式 */
+#define MADV_RANDOM 1     /* 随机访问：缺页时不做fault-around和预读 */
+#define MADV_SEQUENTIAL 2 /* 顺序访问：以最大窗口预读，已经访问过的页面尽早换出 */
+#define MADV_WILLNEED 3   /* 即将访问：立即在后台载入页面 */
+#define MADV_DONTNEED 4   /* 不再需要：立即释放物理帧，匿名页面下次访问时补零 */
+
+/* 补充页表项的类型，决定了页面不在内存中时如何生成其内容 */
+enum page_type {
+  PAGE_FILE, /* 从文件的指定偏移读取，一页中剩余部分补零（可执行文件段） */
+  PAGE_ZERO, /* 全零页（.bss、栈） */
+  PAGE_ANON, /* 匿名页：内容只存在于物理帧中，换出时写入交换区 */
+  PAGE_SWAP, /* 已经被换出到交换区的页面 */
+  PAGE_MMAP, /* 内存映射文件的页面，被修改过的内容写回文件而不是交换区 */
+  PAGE_SHM   /* 共享内存段的页面，物理帧属于段，所有附加者可写地映射同一个帧 */
+};
+
+/* 补充页表项
+ *
+ * 记录一个用户虚拟页如何被“物化”：页面被访问之前只有这条记录，
+ * 第一次访问触发Page Fault后才分配物理帧并填充内容，随后
+ * frame指向该页所在物理帧的帧表项
+ *
+ * 载入后的PAGE_ZERO页转为PAGE_ANON，因为其内容已经不再是全零了
+ * 页面被换出时，未被修改过的PAGE_FILE页直接丢弃，以后再从文件读取；
+ * 其他页面写入交换区并转为PAGE_SWAP，换入后转为PAGE_ANON
+ *
+ * PAGE_FILE页被读访问时映射所有进程共享的只读副本（share不为NULL），
+ * 可写的PAGE_FILE页第一次被写入时才复制出私有的物理帧
+ * PAGE_ZERO页同理，被写入之前映射全局唯一的零页
+ * fork()之后父子进程的私有页面也以共享副本的形式映射，写入时复制
+ * 合并线程发现内容相同的匿名页面时同样把它们改为映射同一个共享副本
+ *
+ * 整个4 MB区域都是可写全零页面时，第一次写入可能将其整个映射为大页（large.c）
+ *
+ * PAGE_MMAP页始终保持其类型：换出和释放时被修改过的内容写回文件，
+ * 未被修改过的直接丢弃，以后再从文件读取
+ *
+ * madvise()设置的访问模式记录在advice中，决定缺页时是否做fault-around、预读
+ * 以及drop-behind，fork()时随页面一起复制
+ *
+ * PAGE_SHM页同样保持其类型，其物理帧属于共享内存段（shm.c），不在帧表中，
+ * 也不会被换出，frame与share始终为NULL
+ */
+struct page {
+  void* upage;         /* 用户虚拟页地址 */
+  enum page_type type; /* 页面类型 */
+  bool writable;       /* 用户进程是否可以写入 */
+  struct frame* frame; /* 所在物理帧，不在内存中时为NULL */
+  int advice;          /* 访问模式，MADV_NORMAL、MADV_RANDOM或者MADV_SEQUENTIAL */
+
+  /* 仅PAGE_FILE和PAGE_MMAP使用，PAGE_FILE页转为PAGE_ANON、PAGE_SWAP之后仍然保留，
+   * MADV_DONTNEED释放页面时据此将其恢复为PAGE_FILE */
+  struct file* file;   /* 后备文件，与进程或映射共用，不由本结构体关闭 */
+  off_t ofs;           /* 页面内容在文件中的偏移 */
+  uint32_t read_bytes; /* 需要从文件读取的字节数，其余PGSIZE - read_bytes字节补零 */
+
+  /* 仅PAGE_MMAP使用 */
+  struct stream* stream; /* 所属映射的顺序访问流 */
+  bool prefetched;       /* 由预读载入，尚未确认是否被访问 */
+
+  /* 仅PAGE_SHM使用 */
+  struct segment* segment; /* 所属的共享内存段，页面在段内的偏移记录在ofs中 */
+
+  /* 仅PAGE_SWAP使用 */
+  size_t swap_slot; /* 所在的交换槽 */
+
+  /* 除PAGE_MMAP外均可使用 */
+  struct share* share; /* 映射的共享只读副本（PAGE_ZERO为零页），此时frame为NULL */
+
+  /* 仅PAGE_ANON使用 */
+  struct large* large; /* 所在的4 MB大页，此时frame与share均为NULL */
+};
+
+/* 补充页表（Supplemental Page Table）
+ *
+ * 每个进程一张，以用户虚拟页号为键存放在基数树中
+ * 查找的代价只与页号的位数有关，另外缓存最近一次命中的表项，
+ * 连续访问同一页面的Page Fault（比如两个线程同时访问）不必再次查找
+ */
+struct spt {
+  struct radix_tree pages; /* 元素是struct page，键为页号 */
+  struct lock lock;        /* 补充页表锁，载入、换出页面期间一直持有 */
+  struct page* last;       /* 最近一次查找命中的表项 */
+  struct list larges;      /* 此进程的大页（struct large） */
+
+  /* 零页统计，进程退出时计入全局统计 */
+  unsigned zero_maps;   /* 映射了零页的页面数 */
+  unsigned zero_copies; /* 其中后来被写入，分配了物理帧的页面数 */
+
+  /* 进程的驻留集，也就是帧表中属于此进程的私有物理帧以及它映射的共享页面，
+   * 由frame.c在frame_lock的保护下维护；零页与大页不计入其中 */
+  size_t rss;               /* 驻留的页面数 */
+  size_t rss_peak;          /* 驻留页面数的峰值 */
+  size_t rss_soft;          /* 软上限，达到之后优先换出自己的页面，0表示不限制 */
+  size_t rss_hard;          /* 硬上限，达到之后只能换出自己的页面，0表示不限制 */
+  unsigned local_evictions; /* 因达到上限而换出自己页面的次数 */
+};
+
+void spt_init(struct spt*);
+void spt_destroy(struct spt*, uint32_t* pd);
+bool spt_add_file(struct spt*, void* upage, struct file*, off_t ofs, uint32_t read_bytes,
+                  bool writable);
+bool spt_add_zero(struct spt*, void* upage, bool writable);
+bool spt_add_mmap(struct spt*, void* upage, struct file*, off_t ofs, uint32_t read_bytes,
+                  struct stream*);
+bool spt_add_shm(struct spt*, void* upage, struct segment*, off_t ofs);
+bool spt_fork(struct spt* dst, uint32_t* dst_pd, struct spt* src, uint32_t* src_pd,
+              struct file* exec);
+void spt_remove(struct spt*, uint32_t* pd, void* upage);
+void spt_remove_range(struct spt*, uint32_t* pd, void* start, void* end);
+struct page* spt_find(struct spt*, const void* uaddr);
+bool page_load(struct spt*, uint32_t* pd, void* uaddr, bool write);
+bool page_evict(struct page*, uint32_t* pd);
+void page_prefetch(struct spt*, uint32_t* pd, void* upage, size_t page_cnt, bool advised);
+bool page_freeze(struct page*, uint32_t* pd);
+void page_thaw(struct page*, uint32_t* pd);
+void page_merge(struct page*, uint32_t* pd, struct share*);
+bool page_advise(struct spt*, uint32_t* pd, void* addr, size_t len, int advice);
+bool page_pin(struct spt*, uint32_t* pd, const void* uaddr, size_t size, bool write);
+void page_unpin(struct spt*, const void* uaddr, size_t size);
+void page_print_stats(void);
+
+#endif /* vm/page.h */
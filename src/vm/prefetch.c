@@ -0,0 +1,233 @@
+/**
+ * @file prefetch.c
+ * @brief 内存映射文件的顺序预读
+ *
+ * @details 顺序扫描映射文件时，每个页面的第一次访问都要经历一次Page Fault
+ * 和一次同步的读盘。这里为每个映射维护一个顺序访问流（struct stream）：
+ * 缺页的页面紧接着上一次缺页的页面，或者落在上一次预读的范围之内时，
+ * 认为访问是顺序的，随即把接下来的若干页面交给后台的预读线程载入，
+ * 进程继续运行，之后访问到这些页面时不会再缺页
+ *
+ * 预读窗口随访问流自适应：保持顺序时翻倍，直到PREFETCH_MAX_WINDOW；
+ * 预读的页面没有被访问就被换出或者释放时减半；随机访问时归零
+ *
+ * madvise(MADV_WILLNEED)同样通过预读线程在后台载入指定的范围，
+ * 这类请求除了映射页之外还会载入可执行文件的页面和被换出的页面
+ *
+ * 预读请求记录了补充页表和页目录，进程退出时spt_destroy()调用
+ * prefetch_cancel()撤销尚未执行的请求，并等待正在执行的请求完成
+ */
+
+#include "vm/prefetch.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* 队列中最多积压的预读请求数，超过时丢弃新的请求 */
+#define PREFETCH_MAX_REQUESTS 16
+
+/* 预读请求 */
+struct request {
+  struct spt* spt;       /* 页面所属的补充页表 */
+  uint32_t* pd;          /* 页面所属的页目录 */
+  void* upage;           /* 第一个页面 */
+  size_t page_cnt;       /* 页面数 */
+  bool advised;          /* 是否来自MADV_WILLNEED */
+  struct list_elem elem; /* 请求队列元素 */
+};
+
+static struct lock prefetch_lock; /* 保护请求队列与current */
+static struct condition queued;   /* 队列中有新的请求 */
+static struct condition finished; /* 一个请求执行完毕 */
+static struct list requests;      /* 请求队列 */
+static size_t request_cnt;        /* 队列中的请求数 */
+static struct spt* current;       /* 正在执行的请求所属的补充页表 */
+
+/* 统计数据 */
+static long long stream_faults; /* 顺序访问流中的缺页数 */
+static long long random_faults; /* 其他映射页的缺页数 */
+static long long pages_queued;  /* 提交预读的页面数 */
+static long long dropped;       /* 因队列已满被丢弃的请求数 */
+static long long hits;          /* 预读之后被访问的页面数 */
+static long long misses;        /* 预读之后没有被访问就被换出或者释放的页面数 */
+
+static bool submit(struct spt*, uint32_t* pd, void* upage, size_t page_cnt, bool advised);
+static thread_func prefetch_thread NO_RETURN;
+
+/**
+ * @brief 初始化请求队列，并启动预读线程
+ */
+void prefetch_init(void) {
+  lock_init(&prefetch_lock);
+  cond_init(&queued);
+  cond_init(&finished);
+  list_init(&requests);
+  request_cnt = 0;
+  current = NULL;
+  thread_create("prefetch", PRI_DEFAULT, prefetch_thread, NULL);
+}
+
+/**
+ * @brief 初始化顺序访问流
+ *
+ * @param sequential 映射是否声明了MAP_SEQUENTIAL
+ */
+void stream_init(struct stream* s, bool sequential) {
+  s->next = NULL;
+  s->ahead = NULL;
+  s->window = 0;
+  s->sequential = sequential;
+}
+
+/**
+ * @brief 映射页P刚刚因缺页被载入，更新其访问流，需要时提交预读请求
+ *
+ * @details 调用者必须持有SPT的锁
+ */
+void prefetch_fault(struct spt* spt, uint32_t* pd, struct page* p) {
+  struct stream* s = p->stream;
+  uint8_t* upage = p->upage;
+  uint8_t *start, *end;
+  bool in_stream;
+
+  if (s->ahead != NULL)
+    in_stream = upage >= (uint8_t*)s->next && upage <= (uint8_t*)s->ahead;
+  else
+    in_stream = upage == s->next;
+
+  if (p->advice == MADV_SEQUENTIAL) {
+    s->window = PREFETCH_MAX_WINDOW;
+    stream_faults++;
+  } else if (in_stream || s->sequential) {
+    s->window = s->window == 0 ? PREFETCH_MIN_WINDOW : s->window * 2;
+    if (s->window > PREFETCH_MAX_WINDOW)
+      s->window = PREFETCH_MAX_WINDOW;
+    stream_faults++;
+  } else {
+    s->window = 0;
+    s->ahead = NULL;
+    random_faults++;
+  }
+  s->next = upage + PGSIZE;
+  if (s->window == 0)
+    return;
+
+  /* 已经提交过的部分不再重复提交 */
+  start = upage + PGSIZE;
+  if (s->ahead != NULL && (uint8_t*)s->ahead > start)
+    start = s->ahead;
+  end = upage + (s->window + 1) * PGSIZE;
+  if (end <= start)
+    return;
+  s->ahead = end;
+  submit(spt, pd, start, (end - start) / PGSIZE, false);
+}
+
+/**
+ * @brief 为madvise(MADV_WILLNEED)提交预读请求，在后台载入从UPAGE开始的PAGE_CNT个页面
+ *
+ * @return false 内存不足或者队列已满，请求被丢弃
+ */
+bool prefetch_range(struct spt* spt, uint32_t* pd, void* upage, size_t page_cnt) {
+  return submit(spt, pd, upage, page_cnt, true);
+}
+
+/* 预读的页面被访问过了 */
+void prefetch_hit(void) { hits++; }
+
+/**
+ * @brief 访问流S中预读的页面没有被访问就被换出或者释放了，缩小预读窗口
+ *
+ * @details 调用者必须持有S所属补充页表的锁
+ */
+void prefetch_miss(struct stream* s) {
+  misses++;
+  s->window /= 2;
+}
+
+/**
+ * @brief 撤销补充页表SPT尚未执行的预读请求，并等待正在执行的请求完成
+ *
+ * @details 调用者不能持有SPT的锁，返回之后预读线程不会再访问SPT
+ */
+void prefetch_cancel(struct spt* spt) {
+  struct list_elem* e;
+
+  lock_acquire(&prefetch_lock);
+  for (e = list_begin(&requests); e != list_end(&requests);) {
+    struct request* r = list_entry(e, struct request, elem);
+
+    if (r->spt == spt) {
+      e = list_remove(e);
+      request_cnt--;
+      free(r);
+    } else
+      e = list_next(e);
+  }
+  while (current == spt)
+    cond_wait(&finished, &prefetch_lock);
+  lock_release(&prefetch_lock);
+}
+
+/* 打印预读的统计数据 */
+void prefetch_print_stats(void) {
+  printf("Prefetch: %lld sequential faults, %lld random faults, %lld pages queued "
+         "(%lld requests dropped), %lld hits, %lld misses\n",
+         stream_faults, random_faults, pages_queued, dropped, hits, misses);
+}
+
+/* 将预读请求加入队列，队列已满时丢弃 */
+static bool submit(struct spt* spt, uint32_t* pd, void* upage, size_t page_cnt, bool advised) {
+  struct request* r = malloc(sizeof *r);
+  bool success;
+
+  if (r == NULL)
+    return false;
+  r->spt = spt;
+  r->pd = pd;
+  r->upage = upage;
+  r->page_cnt = page_cnt;
+  r->advised = advised;
+
+  lock_acquire(&prefetch_lock);
+  success = request_cnt < PREFETCH_MAX_REQUESTS;
+  if (success) {
+    list_push_back(&requests, &r->elem);
+    request_cnt++;
+    pages_queued += r->page_cnt;
+    cond_signal(&queued, &prefetch_lock);
+  } else
+    dropped++;
+  lock_release(&prefetch_lock);
+  if (!success)
+    free(r);
+  return success;
+}
+
+/* 预读线程：依次执行队列中的请求 */
+static void prefetch_thread(void* aux UNUSED) {
+  for (;;) {
+    struct request* r;
+
+    lock_acquire(&prefetch_lock);
+    while (list_empty(&requests))
+      cond_wait(&queued, &prefetch_lock);
+    r = list_entry(list_pop_front(&requests), struct request, elem);
+    request_cnt--;
+    current = r->spt;
+    lock_release(&prefetch_lock);
+
+    page_prefetch(r->spt, r->pd, r->upage, r->page_cnt, r->advised);
+
+    lock_acquire(&prefetch_lock);
+    current = NULL;
+    cond_broadcast(&finished, &prefetch_lock);
+    lock_release(&prefetch_lock);
+    free(r);
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef VM_PREFETCH_H
+#define VM_PREFETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct page;
+struct spt;
+
+/* 预读窗口的范围（页数） */
+#define PREFETCH_MIN_WINDOW 4
+#define PREFETCH_MAX_WINDOW 32
+
+/* 顺序访问流
+ *
+ * 每个内存映射一个，记录该映射上的缺页是否构成顺序访问
+ * 发现顺序访问之后，缺页时异步地预读接下来WINDOW个页面，
+ * 进程在访问到这些页面时就不会再缺页；访问流继续保持顺序时窗口翻倍，
+ * 预读的页面没有被访问就被换出时窗口减半，随机访问时窗口归零
+ * 被madvise()建议为MADV_SEQUENTIAL的页面缺页时，窗口直接取最大值
+ *
+ * 由所属补充页表的锁保护
+ */
+struct stream {
+  void* next;       /* 顺序访问时预计的下一个缺页页面 */
+  void* ahead;      /* 已经提交预读的页面的末尾（不含），没有时为NULL */
+  unsigned window;  /* 预读窗口，0表示尚未发现顺序访问 */
+  bool sequential;  /* MAP_SEQUENTIAL：第一次缺页就开始预读 */
+};
+
+void prefetch_init(void);
+void stream_init(struct stream*, bool sequential);
+void prefetch_fault(struct spt*, uint32_t* pd, struct page*);
+bool prefetch_range(struct spt*, uint32_t* pd, void* upage, size_t page_cnt);
+void prefetch_hit(void);
+void prefetch_miss(struct stream*);
+void prefetch_cancel(struct spt*);
+void prefetch_print_stats(void);
+
+#endif /* vm/prefetch.h */
@@ -0,0 +1,354 @@
+/**
+ * @file share.c
+ * @brief 进程间共享的可执行文件页面
+ *
+ * @details 同一个程序被exec多次时，每个进程原本都要从磁盘读取并单独
+ * 保存一份代码段和只读数据段。这里的共享页面表以（inode, 偏移, 读取字节数）
+ * 为键缓存这些页面：第一个访问某页的进程负责读盘，之后的进程只需要
+ * 将同一个物理帧只读地映射到自己的页目录中并增加引用计数
+ *
+ * 可写数据段中尚未被写入的页面同样以只读方式共享，第一次写入时由
+ * page.c复制出私有的副本（写时复制）
+ *
+ * 全零的页面（.bss、栈、匿名内存）在被写入之前全部映射同一个零页
+ *
+ * fork()产生的父子进程也借助共享页面共用物理帧：父进程的私有页面被包装成
+ * 匿名共享页面，由双方只读地映射，写入时再由page.c复制（写时复制）
+ *
+ * 合并线程（merge.c）合并的匿名共享页面登记在另一张合并页面表中，
+ * 以内容的散列值查找，以完整的内容比较
+ *
+ * 读取字节数也是键的一部分：代码段的最后一页与数据段的第一页可能
+ * 位于文件的同一页中，但二者读取的字节数不同，内容也就不同
+ */
+
+#include "vm/share.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/highmem.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+static struct ohash shares; /* 共享页面表 */
+static struct ohash merged; /* 合并页面表 */
+static struct lock share_lock; /* 保护共享页面表及其中各项的引用计数 */
+static struct share zero_page;  /* 全零的共享页面 */
+
+/* 统计数据 */
+static long long share_hits;   /* 映射已有共享页面的次数 */
+static long long share_misses; /* 从文件读入共享页面的次数 */
+static size_t anon_cnt;        /* 现存的匿名共享页面数 */
+
+static struct share* find(struct file*, off_t ofs, uint32_t read_bytes);
+static unsigned share_hash(const struct ohash_elem*, void*);
+static bool share_equal(const struct ohash_elem*, const struct ohash_elem*, void*);
+static unsigned merged_hash(const struct ohash_elem*, void*);
+static bool merged_equal(const struct ohash_elem*, const struct ohash_elem*, void*);
+
+/* 初始化共享页面表，并分配零页 */
+void share_init(void) {
+  ohash_init(&shares, share_hash, share_equal, NULL);
+  ohash_init(&merged, merged_hash, merged_equal, NULL);
+  lock_init(&share_lock);
+
+  zero_page.inode = NULL;
+  zero_page.ofs = 0;
+  zero_page.read_bytes = 0;
+  zero_page.paddr = palloc_get_frame(PAL_ASSERT | PAL_ZERO);
+  zero_page.ref_cnt = 1;
+  zero_page.merged = false;
+}
+
+/**
+ * @brief 获取FILE中偏移为OFS、读取READ_BYTES字节的页面的共享副本，引用计数加一
+ *
+ * @details 表中没有该页面时分配物理帧并从文件读入，读盘期间一直持有
+ * share_lock，同时缺失的其他页面需要等待，但同一页面不会被读入两次
+ *
+ * @param file 在返回的页面被释放之前必须保持打开，并且禁止写入
+ * @return struct share* 内存不足或者读取失败时返回NULL
+ */
+struct share* share_get(struct file* file, off_t ofs, uint32_t read_bytes) {
+  struct share* s;
+  void* kpage;
+
+  ASSERT(read_bytes <= PGSIZE);
+  lock_acquire(&share_lock);
+  s = find(file, ofs, read_bytes);
+  if (s != NULL) {
+    s->ref_cnt++;
+    share_hits++;
+    goto done;
+  }
+
+  s = malloc(sizeof *s);
+  if (s == NULL)
+    goto done;
+  s->inode = file_get_inode(file);
+  s->ofs = ofs;
+  s->read_bytes = read_bytes;
+  s->ref_cnt = 1;
+  s->merged = false;
+  s->paddr = palloc_get_frame(PAL_USER);
+  if (s->paddr == 0)
+    goto fail;
+
+  kpage = kmap(s->paddr);
+  if (file_read_at(file, kpage, read_bytes, ofs) != (off_t)read_bytes) {
+    kunmap(kpage);
+    palloc_free_frame(s->paddr);
+    goto fail;
+  }
+  memset((uint8_t*)kpage + read_bytes, 0, PGSIZE - read_bytes);
+  kunmap(kpage);
+
+  if (ohash_insert(&shares, &s->elem) != NULL) {
+    palloc_free_frame(s->paddr);
+    goto fail;
+  }
+  share_misses++;
+  goto done;
+
+fail:
+  free(s);
+  s = NULL;
+done:
+  lock_release(&share_lock);
+  return s;
+}
+
+/**
+ * @brief 与share_get()相同，但只返回已经在共享页面表中的页面，不会读盘
+ *
+ * @details 用于fault-around：顺带映射的相邻页面只有在不需要读盘时才划算
+ * @return struct share* 页面不在表中时返回NULL
+ */
+struct share* share_lookup(struct file* file, off_t ofs, uint32_t read_bytes) {
+  struct share* s;
+
+  lock_acquire(&share_lock);
+  s = find(file, ofs, read_bytes);
+  if (s != NULL) {
+    s->ref_cnt++;
+    share_hits++;
+  }
+  lock_release(&share_lock);
+  return s;
+}
+
+/**
+ * @brief 释放对共享页面S的一个引用，最后一个引用释放时一并释放物理帧
+ *
+ * @details 调用者必须已经将S从自己的页目录中移除
+ */
+void share_put(struct share* s) {
+  bool last;
+
+  lock_acquire(&share_lock);
+  ASSERT(s->ref_cnt > 0);
+  last = --s->ref_cnt == 0;
+  if (last && s->inode != NULL)
+    ohash_delete(&shares, &s->elem);
+  else if (last && s->merged)
+    ohash_delete(&merged, &s->elem);
+  else if (last)
+    anon_cnt--;
+  lock_release(&share_lock);
+
+  if (last) {
+    palloc_free_frame(s->paddr);
+    free(s);
+  }
+}
+
+/**
+ * @brief 将物理帧PADDR包装成匿名共享页面，引用计数为1
+ *
+ * @details 物理帧此后归共享页面所有，调用者必须已经将其移出帧表，
+ * 并且只读地映射它
+ *
+ * @return struct share* 内存不足时返回NULL
+ */
+struct share* share_anon(uintptr_t paddr) {
+  struct share* s = malloc(sizeof *s);
+
+  if (s == NULL)
+    return NULL;
+  s->inode = NULL;
+  s->ofs = 0;
+  s->read_bytes = 0;
+  s->paddr = paddr;
+  s->ref_cnt = 1;
+  s->merged = false;
+
+  lock_acquire(&share_lock);
+  anon_cnt++;
+  lock_release(&share_lock);
+  return s;
+}
+
+/**
+ * @brief 为已经持有的共享页面S再增加一个引用，用于fork()
+ */
+void share_dup(struct share* s) {
+  lock_acquire(&share_lock);
+  ASSERT(s->ref_cnt > 0);
+  s->ref_cnt++;
+  lock_release(&share_lock);
+}
+
+/**
+ * @brief S是只剩下调用者一个引用的匿名共享页面时释放S，但是保留其物理帧并交给调用者
+ *
+ * @details 引用计数的检查和从合并页面表中移除都在share_lock下完成：
+ * 合并线程的share_find_merged()要么已经增加了引用而使接管失败，
+ * 要么之后再也找不到S。S被释放，调用者需要事先记下S->paddr
+ * @return bool 接管成功时返回true，否则S保持不变
+ */
+bool share_take(struct share* s) {
+  bool take;
+
+  if (s->inode != NULL || share_is_zero(s))
+    return false;
+  lock_acquire(&share_lock);
+  take = s->ref_cnt == 1;
+  if (take) {
+    if (s->merged)
+      ohash_delete(&merged, &s->elem);
+    else
+      anon_cnt--;
+  }
+  lock_release(&share_lock);
+  if (take)
+    free(s);
+  return take;
+}
+
+/**
+ * @brief 在合并页面表中查找内容与物理帧PADDR相同的页面，引用计数加一
+ *
+ * @param checksum PADDR中内容的散列值
+ * @return struct share* 没有这样的页面时返回NULL
+ */
+struct share* share_find_merged(uintptr_t paddr, unsigned checksum) {
+  struct share key;
+  struct ohash_elem* e;
+  struct share* s = NULL;
+
+  key.paddr = paddr;
+  key.checksum = checksum;
+  lock_acquire(&share_lock);
+  e = ohash_find(&merged, &key.elem);
+  if (e != NULL) {
+    s = ohash_entry(e, struct share, elem);
+    s->ref_cnt++;
+  }
+  lock_release(&share_lock);
+  return s;
+}
+
+/**
+ * @brief 将物理帧PADDR包装成合并页面并登记在合并页面表中，引用计数为1
+ *
+ * @details 与share_anon()相同，物理帧此后归共享页面所有
+ * @param checksum PADDR中内容的散列值
+ * @return struct share* 内存不足，或者表中已经有内容相同的页面时返回NULL
+ */
+struct share* share_add_merged(uintptr_t paddr, unsigned checksum) {
+  struct share* s = malloc(sizeof *s);
+
+  if (s == NULL)
+    return NULL;
+  s->inode = NULL;
+  s->ofs = 0;
+  s->read_bytes = 0;
+  s->paddr = paddr;
+  s->ref_cnt = 1;
+  s->merged = true;
+  s->checksum = checksum;
+
+  lock_acquire(&share_lock);
+  if (ohash_insert(&merged, &s->elem) != NULL) {
+    free(s);
+    s = NULL;
+  }
+  lock_release(&share_lock);
+  return s;
+}
+
+/**
+ * @brief 获取零页，引用计数加一
+ *
+ * @details 与其他共享页面一样，不再使用时调用share_put()
+ * 零页持有一个永久的引用，不会被释放
+ */
+struct share* share_zero(void) {
+  lock_acquire(&share_lock);
+  zero_page.ref_cnt++;
+  lock_release(&share_lock);
+  return &zero_page;
+}
+
+/* S是否为零页 */
+bool share_is_zero(const struct share* s) { return s == &zero_page; }
+
+/* 打印共享页面的统计数据 */
+void share_print_stats(void) {
+  printf("Share: %lld hits, %lld misses, %zu pages shared now, zero page mapped %u times, "
+         "%zu anonymous pages shared by fork, %zu merged by content\n",
+         share_hits, share_misses, ohash_size(&shares), zero_page.ref_cnt - 1, anon_cnt,
+         ohash_size(&merged));
+}
+
+/* 在共享页面表中查找FILE的对应页面，调用者必须持有share_lock */
+static struct share* find(struct file* file, off_t ofs, uint32_t read_bytes) {
+  struct share key;
+  struct ohash_elem* e;
+
+  ASSERT(lock_held_by_current_thread(&share_lock));
+  key.inode = file_get_inode(file);
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  e = ohash_find(&shares, &key.elem);
+  return e != NULL ? ohash_entry(e, struct share, elem) : NULL;
+}
+
+static unsigned share_hash(const struct ohash_elem* e, void* aux UNUSED) {
+  const struct share* s = ohash_entry(e, struct share, elem);
+  return ohash_int((uintptr_t)s->inode) ^ ohash_int(s->ofs) ^ ohash_int(s->read_bytes << 16);
+}
+
+static bool share_equal(const struct ohash_elem* a_, const struct ohash_elem* b_,
+                        void* aux UNUSED) {
+  const struct share* a = ohash_entry(a_, struct share, elem);
+  const struct share* b = ohash_entry(b_, struct share, elem);
+  return a->inode == b->inode && a->ofs == b->ofs && a->read_bytes == b->read_bytes;
+}
+
+static unsigned merged_hash(const struct ohash_elem* e, void* aux UNUSED) {
+  return ohash_entry(e, struct share, elem)->checksum;
+}
+
+/* 合并页面表以完整的页面内容比较，散列值相同的不同页面不会被混淆 */
+static bool merged_equal(const struct ohash_elem* a_, const struct ohash_elem* b_,
+                         void* aux UNUSED) {
+  const struct share* a = ohash_entry(a_, struct share, elem);
+  const struct share* b = ohash_entry(b_, struct share, elem);
+  void *pa, *pb;
+  bool equal;
+
+  if (a->checksum != b->checksum)
+    return false;
+  if (a->paddr == b->paddr)
+    return true;
+  pa = kmap(a->paddr);
+  pb = kmap(b->paddr);
+  equal = memcmp(pa, pb, PGSIZE) == 0;
+  kunmap(pb);
+  kunmap(pa);
+  return equal;
+}
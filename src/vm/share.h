@@ -0,0 +1,54 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <ohash.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct inode;
+
+/* 共享页面
+ *
+ * 运行同一个可执行文件的多个进程，其只读段以及尚未被写入的可写段
+ * 内容完全相同，因此只需要在物理内存中保留一份。共享页面以
+ * （inode, 文件偏移, 读取字节数）为键登记在全局共享页面表中，
+ * 每个映射了它的进程持有一个引用，最后一个引用释放时物理帧随之释放
+ *
+ * 共享帧只读地映射到各个进程中，不在帧表中登记，因此不会被换出，
+ * 但计入每个映射了它的进程的驻留集（frame.c）
+ *
+ * 全局唯一的零页也是一个共享页面，它不在共享页面表中，引用计数也永远不会归零
+ *
+ * fork()时父进程的私有页面转为匿名共享页面（inode为NULL），同样不在共享页面表中，
+ * 父子进程中的任何一方写入时复制出私有的副本，最后一个持有者写入时直接接管物理帧
+ *
+ * 合并线程（merge.c）发现的内容相同的匿名页面也合并为匿名共享页面，
+ * 它们以页面内容为键登记在合并页面表中，之后内容相同的页面可以直接映射
+ */
+struct share {
+  struct inode* inode;     /* 后备文件的inode，匿名共享页面和零页为NULL */
+  off_t ofs;               /* 页面内容在文件中的偏移 */
+  uint32_t read_bytes;     /* 从文件读取的字节数，其余部分为零 */
+  uintptr_t paddr;         /* 物理帧的物理地址 */
+  unsigned ref_cnt;        /* 映射了此页面的进程数 */
+  bool merged;             /* 是否为合并页面，此时elem属于合并页面表 */
+  unsigned checksum;       /* 合并页面内容的散列值 */
+  struct ohash_elem elem;  /* 共享页面表或者合并页面表元素 */
+};
+
+void share_init(void);
+struct share* share_get(struct file*, off_t ofs, uint32_t read_bytes);
+struct share* share_lookup(struct file*, off_t ofs, uint32_t read_bytes);
+void share_put(struct share*);
+struct share* share_anon(uintptr_t paddr);
+void share_dup(struct share*);
+bool share_take(struct share*);
+struct share* share_find_merged(uintptr_t paddr, unsigned checksum);
+struct share* share_add_merged(uintptr_t paddr, unsigned checksum);
+struct share* share_zero(void);
+bool share_is_zero(const struct share*);
+void share_print_stats(void);
+
+#endif /* vm/share.h */
@@ -0,0 +1,433 @@
+/**
+ * @file shm.c
+ * @brief 共享内存段
+ *
+ * @details 进程之间传递大量数据时，管道或者文件都需要在内核与用户缓冲区之间
+ * 复制两次。共享内存段把同一组物理帧同时映射到多个进程的地址空间中，
+ * 一个进程写入的数据另一个进程直接就能读到，不需要任何复制
+ *
+ * 接口仿照System V：shm_create()按键创建或者找到段，shm_attach()把段附加到
+ * 进程地址空间中的指定位置，shm_detach()撤销附加，shm_remove()删除段。
+ * 被删除的段不能再被附加，但已有的附加依然有效，直到最后一个附加被撤销
+ *
+ * 附加的页面由page.c按需载入：第一次被任何附加者访问时分配清零的物理帧，
+ * 之后其他附加者的缺页直接映射同一个物理帧
+ *
+ * 数据的同步使用已有的用户信号量：sema_init()的地址落在附加的段中时，
+ * 信号量登记在段中而不是进程的信号量表中，键为其在段内的偏移，
+ * 因此不同进程即使把段附加在不同的地址上，也能通过段中同一位置的sema_t
+ * 访问到同一个内核信号量
+ *
+ * 与内存映射一样，附加不会被fork()继承，子进程需要自己附加
+ */
+
+#include "vm/shm.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+static struct list segments; /* 全局段表，元素是尚未被删除的段 */
+static struct lock shm_lock; /* 全局段表锁，同时保护段的引用计数 */
+static shmid_t next_id;      /* 下一段标识符 */
+
+/* 统计数据 */
+static long long created_cnt; /* 创建的段数 */
+static long long attach_cnt;  /* 附加次数 */
+static long long fault_cnt;   /* 分配了物理帧的页面数 */
+
+static struct segment* find_key(int key);
+static struct segment* find_id(shmid_t);
+static struct segment* find_attached(struct process*, const void* uaddr, size_t* ofs);
+static void put_segment(struct segment*);
+static bool covers(const struct attachment*, const void* uaddr);
+static void free_sema(unsigned long, void*, void*);
+
+/**
+ * @brief 初始化全局段表
+ */
+void shm_init(void) {
+  list_init(&segments);
+  lock_init(&shm_lock);
+  next_id = 0;
+}
+
+/**
+ * @brief 创建键为KEY、大小至少为SIZE字节的共享内存段
+ *
+ * @details 键为KEY的段已经存在的话直接返回它，此时其大小必须不小于SIZE
+ *
+ * @return shmid_t 段标识符，SIZE为0或者超过SHM_MAX_PAGES页、已有的段太小，
+ * 以及内存不足时返回SHM_FAILED
+ */
+shmid_t shm_create(int key, size_t size) {
+  size_t page_cnt = DIV_ROUND_UP(size, PGSIZE);
+  struct segment* seg;
+  shmid_t id;
+
+  if (size == 0 || page_cnt > SHM_MAX_PAGES)
+    return SHM_FAILED;
+
+  lock_acquire(&shm_lock);
+  seg = find_key(key);
+  if (seg != NULL) {
+    id = seg->page_cnt >= page_cnt ? seg->id : SHM_FAILED;
+    lock_release(&shm_lock);
+    return id;
+  }
+
+  seg = malloc(sizeof *seg);
+  if (seg != NULL)
+    seg->frames = calloc(page_cnt, sizeof *seg->frames);
+  if (seg == NULL || seg->frames == NULL) {
+    lock_release(&shm_lock);
+    free(seg);
+    return SHM_FAILED;
+  }
+  seg->id = id = next_id++;
+  seg->key = key;
+  seg->page_cnt = page_cnt;
+  radix_init(&seg->semas);
+  lock_init(&seg->lock);
+  seg->ref_cnt = 1;
+  seg->removed = false;
+  list_push_back(&segments, &seg->elem);
+  created_cnt++;
+  lock_release(&shm_lock);
+  return id;
+}
+
+/**
+ * @brief 将段ID附加到进程PCB的用户虚拟地址ADDR处
+ *
+ * @details 附加失败的情形：段不存在或者已经被删除、ADDR为0或者没有页对齐、
+ * 附加范围与已有页面重叠，或者落入了线程栈所在的区域
+ *
+ * @return void* 附加的起始地址，也就是ADDR，失败时返回NULL
+ */
+void* shm_attach(struct process* pcb, shmid_t id, void* addr) {
+  uint8_t* stacks = (uint8_t*)PHYS_BASE - MAX_THREADS * STACK_SIZE;
+  struct segment* seg;
+  struct attachment* a;
+  size_t i;
+
+  if (addr == NULL || pg_ofs(addr) != 0)
+    return NULL;
+
+  lock_acquire(&shm_lock);
+  seg = find_id(id);
+  if (seg != NULL)
+    seg->ref_cnt++;
+  lock_release(&shm_lock);
+  if (seg == NULL)
+    return NULL;
+
+  if ((uintptr_t)addr + seg->page_cnt * PGSIZE > (uintptr_t)stacks ||
+      (uintptr_t)addr + seg->page_cnt * PGSIZE < (uintptr_t)addr)
+    goto fail;
+  a = malloc(sizeof *a);
+  if (a == NULL)
+    goto fail;
+
+  /* 逐页登记，与已有页面重叠时登记失败，撤销已经登记的页面 */
+  for (i = 0; i < seg->page_cnt; i++) {
+    if (!spt_add_shm(&pcb->spt, (uint8_t*)addr + i * PGSIZE, seg, i * PGSIZE)) {
+      spt_remove_range(&pcb->spt, pcb->pagedir, addr, (uint8_t*)addr + i * PGSIZE);
+      free(a);
+      goto fail;
+    }
+  }
+
+  a->seg = seg;
+  a->addr = addr;
+  lock_acquire(&pcb->maps_lock);
+  list_push_back(&pcb->shm_tab, &a->elem);
+  lock_release(&pcb->maps_lock);
+  attach_cnt++;
+  return addr;
+
+fail:
+  put_segment(seg);
+  return NULL;
+}
+
+/**
+ * @brief 撤销进程PCB附加在ADDR处的段
+ *
+ * @param addr 必须是shm_attach()返回的起始地址
+ * @return true 撤销成功
+ * @return false ADDR处没有附加任何段
+ */
+bool shm_detach(struct process* pcb, void* addr) {
+  struct attachment* a = NULL;
+  bool found = false;
+
+  lock_acquire(&pcb->maps_lock);
+  list_for_each_entry(a, &pcb->shm_tab, elem) {
+    if (a->addr == addr) {
+      list_remove(&a->elem);
+      found = true;
+      break;
+    }
+  }
+  lock_release(&pcb->maps_lock);
+  if (!found)
+    return false;
+
+  spt_remove_range(&pcb->spt, pcb->pagedir, a->addr,
+                   (uint8_t*)a->addr + a->seg->page_cnt * PGSIZE);
+  put_segment(a->seg);
+  free(a);
+  return true;
+}
+
+/**
+ * @brief 删除段ID，其键随即可以被新的段使用
+ *
+ * @details 已有的附加依然有效，最后一个附加被撤销时段才被释放
+ *
+ * @return false 段不存在或者已经被删除
+ */
+bool shm_remove(shmid_t id) {
+  struct segment* seg;
+
+  lock_acquire(&shm_lock);
+  seg = find_id(id);
+  if (seg != NULL) {
+    list_remove(&seg->elem);
+    seg->removed = true;
+  }
+  lock_release(&shm_lock);
+  if (seg == NULL)
+    return false;
+  put_segment(seg);
+  return true;
+}
+
+/**
+ * @brief 撤销进程的所有附加
+ *
+ * @details 进程退出时调用，必须在spt_destroy()之后：页面已经从页目录中移除，
+ * 这里只释放附加记录并减少段的引用
+ */
+void shm_destroy(struct process* pcb) {
+  struct attachment* a = NULL;
+
+  list_clean_each(a, &pcb->shm_tab, elem, {
+    put_segment(a->seg);
+    free(a);
+  });
+}
+
+/**
+ * @brief 将共享内存页面P可写地映射到页目录PD中
+ *
+ * @details 由page.c在载入PAGE_SHM页面时调用，调用者必须持有P所属补充页表的锁
+ * 页面第一次被任何附加者访问时才分配清零的物理帧
+ *
+ * @return false 内存不足
+ */
+bool shm_load(struct page* p, uint32_t* pd) {
+  struct segment* seg = p->segment;
+  size_t i = p->ofs / PGSIZE;
+  uintptr_t paddr;
+
+  ASSERT(p->type == PAGE_SHM);
+  if (pagedir_get_frame(pd, p->upage) != 0)
+    return true;
+
+  lock_acquire(&seg->lock);
+  if (seg->frames[i] == 0) {
+    seg->frames[i] = palloc_get_frame(PAL_USER | PAL_ZERO);
+    if (seg->frames[i] != 0)
+      fault_cnt++;
+  }
+  paddr = seg->frames[i];
+  lock_release(&seg->lock);
+
+  return paddr != 0 && pagedir_set_frame(pd, p->upage, paddr, true);
+}
+
+/**
+ * @brief UADDR是否位于进程PCB附加的某个段中
+ */
+bool shm_contains(struct process* pcb, const void* uaddr) {
+  struct attachment* a = NULL;
+  bool found = false;
+
+  lock_acquire(&pcb->maps_lock);
+  list_for_each_entry(a, &pcb->shm_tab, elem) {
+    if (covers(a, uaddr)) {
+      found = true;
+      break;
+    }
+  }
+  lock_release(&pcb->maps_lock);
+  return found;
+}
+
+/**
+ * @brief 在UADDR所在的段中登记初始值为VAL的信号量
+ *
+ * @return false UADDR不在附加的段中、该位置已经登记过信号量，或者内存不足
+ */
+bool shm_sema_init(struct process* pcb, const void* uaddr, int val) {
+  struct semaphore* sema;
+  struct segment* seg;
+  size_t ofs;
+  bool success = false;
+
+  seg = find_attached(pcb, uaddr, &ofs);
+  if (seg == NULL)
+    return false;
+
+  lock_acquire(&seg->lock);
+  if (radix_lookup(&seg->semas, ofs) == NULL) {
+    sema = malloc(sizeof *sema);
+    if (sema != NULL) {
+      sema_init(sema, val);
+      success = radix_insert(&seg->semas, ofs, sema);
+      if (!success)
+        free(sema);
+    }
+  }
+  lock_release(&seg->lock);
+  put_segment(seg);
+  return success;
+}
+
+/**
+ * @brief 对UADDR所在段中登记的信号量执行down
+ *
+ * @details 等待期间持有段的引用，即使所有附加都被撤销，信号量也不会被释放
+ *
+ * @return false UADDR不在附加的段中，或者该位置没有登记信号量
+ */
+bool shm_sema_down(struct process* pcb, const void* uaddr) {
+  struct semaphore* sema;
+  struct segment* seg;
+  size_t ofs;
+
+  seg = find_attached(pcb, uaddr, &ofs);
+  if (seg == NULL)
+    return false;
+
+  lock_acquire(&seg->lock);
+  sema = radix_lookup(&seg->semas, ofs);
+  lock_release(&seg->lock);
+  if (sema != NULL)
+    sema_down(sema);
+  put_segment(seg);
+  return sema != NULL;
+}
+
+/**
+ * @brief 对UADDR所在段中登记的信号量执行up
+ *
+ * @return false UADDR不在附加的段中，或者该位置没有登记信号量
+ */
+bool shm_sema_up(struct process* pcb, const void* uaddr) {
+  struct semaphore* sema;
+  struct segment* seg;
+  size_t ofs;
+
+  seg = find_attached(pcb, uaddr, &ofs);
+  if (seg == NULL)
+    return false;
+
+  lock_acquire(&seg->lock);
+  sema = radix_lookup(&seg->semas, ofs);
+  lock_release(&seg->lock);
+  if (sema != NULL)
+    sema_up(sema);
+  put_segment(seg);
+  return sema != NULL;
+}
+
+/**
+ * @brief 打印共享内存统计数据
+ */
+void shm_print_stats(void) {
+  printf("Shared memory: %lld segments created, %lld attaches, %lld pages faulted in\n",
+         created_cnt, attach_cnt, fault_cnt);
+}
+
+/* 在全局段表中查找键KEY，调用者必须持有shm_lock */
+static struct segment* find_key(int key) {
+  struct segment* seg = NULL;
+
+  ASSERT(lock_held_by_current_thread(&shm_lock));
+  list_for_each_entry(seg, &segments, elem) {
+    if (seg->key == key)
+      return seg;
+  }
+  return NULL;
+}
+
+/* 在全局段表中查找标识符ID，调用者必须持有shm_lock */
+static struct segment* find_id(shmid_t id) {
+  struct segment* seg = NULL;
+
+  ASSERT(lock_held_by_current_thread(&shm_lock));
+  list_for_each_entry(seg, &segments, elem) {
+    if (seg->id == id)
+      return seg;
+  }
+  return NULL;
+}
+
+/* 查找UADDR所在的附加段，增加其引用并将段内偏移存入OFS，
+   用完之后必须调用put_segment() */
+static struct segment* find_attached(struct process* pcb, const void* uaddr, size_t* ofs) {
+  struct attachment* a = NULL;
+  struct segment* seg = NULL;
+
+  lock_acquire(&pcb->maps_lock);
+  list_for_each_entry(a, &pcb->shm_tab, elem) {
+    if (covers(a, uaddr)) {
+      seg = a->seg;
+      *ofs = (const uint8_t*)uaddr - (uint8_t*)a->addr;
+      lock_acquire(&shm_lock);
+      seg->ref_cnt++;
+      lock_release(&shm_lock);
+      break;
+    }
+  }
+  lock_release(&pcb->maps_lock);
+  return seg;
+}
+
+/* 释放段SEG的一个引用，最后一个引用释放时连同物理帧和信号量一起释放 */
+static void put_segment(struct segment* seg) {
+  bool last;
+  size_t i;
+
+  lock_acquire(&shm_lock);
+  ASSERT(seg->ref_cnt > 0);
+  last = --seg->ref_cnt == 0;
+  lock_release(&shm_lock);
+  if (!last)
+    return;
+
+  ASSERT(seg->removed);
+  for (i = 0; i < seg->page_cnt; i++)
+    if (seg->frames[i] != 0)
+      palloc_free_frame(seg->frames[i]);
+  radix_destroy(&seg->semas, free_sema, NULL);
+  free(seg->frames);
+  free(seg);
+}
+
+/* 附加A的范围是否包含UADDR */
+static bool covers(const struct attachment* a, const void* uaddr) {
+  const uint8_t* start = a->addr;
+  return (const uint8_t*)uaddr >= start && (const uint8_t*)uaddr < start + a->seg->page_cnt * PGSIZE;
+}
+
+/* radix_destroy的回调，释放段中的信号量 */
+static void free_sema(unsigned long index UNUSED, void* sema, void* aux UNUSED) { free(sema); }
@@ -0,0 +1,66 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <list.h>
+#include <radix.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct page;
+struct process;
+
+/* 共享内存段标识符，在整个系统内唯一 */
+typedef int shmid_t;
+#define SHM_FAILED ((shmid_t)-1)
+
+/* 单个共享内存段的最大页数，段的物理帧不会被换出 */
+#define SHM_MAX_PAGES 1024
+
+/* 共享内存段
+ *
+ * 段以用户指定的键登记在全局段表中，各进程以相同的键得到同一个段，
+ * 再把它附加到各自地址空间中的任意位置。附加只是在补充页表中为每一页登记
+ * 一条PAGE_SHM表项，页面第一次被访问时才分配清零的物理帧，此后所有附加者
+ * 可写地映射同一个物理帧，写入对其他进程立即可见
+ *
+ * 物理帧属于段而不在帧表中登记，因此不会被换出。每个附加持有一个引用，
+ * 未被删除的段本身再持有一个，最后一个引用释放时物理帧随之释放
+ *
+ * 位于段中的用户信号量同样属于段，以其在段内的偏移为键，所有附加者
+ * 通过各自的地址访问到同一个内核信号量，可以用来同步对共享数据的访问
+ */
+struct segment {
+  shmid_t id;              /* 段标识符 */
+  int key;                 /* 用户指定的键 */
+  size_t page_cnt;         /* 段占据的页数 */
+  uintptr_t* frames;       /* 每页的物理帧，尚未被访问的页面为0 */
+  struct radix_tree semas; /* 段中的信号量（struct semaphore），键为在段内的偏移 */
+  struct lock lock;        /* 保护frames和semas */
+  unsigned ref_cnt;        /* 附加数，未被删除时另加1，由全局段表锁保护 */
+  bool removed;            /* 是否已经被删除，此时不在全局段表中 */
+  struct list_elem elem;   /* 全局段表元素 */
+};
+
+/* 共享内存段的附加记录，每个进程一张附加表 */
+struct attachment {
+  struct segment* seg;   /* 附加的段 */
+  void* addr;            /* 附加的起始用户虚拟地址 */
+  struct list_elem elem; /* 进程附加表元素 */
+};
+
+void shm_init(void);
+shmid_t shm_create(int key, size_t size);
+void* shm_attach(struct process*, shmid_t, void* addr);
+bool shm_detach(struct process*, void* addr);
+bool shm_remove(shmid_t);
+void shm_destroy(struct process*);
+bool shm_load(struct page*, uint32_t* pd);
+bool shm_contains(struct process*, const void* uaddr);
+bool shm_sema_init(struct process*, const void* uaddr, int val);
+bool shm_sema_down(struct process*, const void* uaddr);
+bool shm_sema_up(struct process*, const void* uaddr);
+void shm_print_stats(void);
+
+#endif /* vm/shm.h */
@@ -0,0 +1,124 @@
+/**
+ * @file swap.c
+ * @brief 交换区
+ *
+ * @details 交换区位于扮演BLOCK_SWAP角色的块设备上（见init.c中的-swap选项），
+ * 被划分为一个个大小为一页的交换槽，每个交换槽占据连续的PGSIZE / BLOCK_SECTOR_SIZE个扇区
+ * 交换槽的分配情况记录在位图中
+ *
+ * 换出的页面首先尝试存入压缩内存池（zswap.c），失败时才写入交换设备
+ * 存放在内存池中的页面，其交换槽编号是带有ZSWAP_BIT标志的内存池句柄，
+ * 调用者不需要区分两者
+ *
+ * 内存池已满并且没有交换设备时所有分配都会失败，此时只有未被修改过的文件页可以被换出
+ */
+
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <limits.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* 每个交换槽占据的扇区数 */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* 存放在压缩内存池中的页面，其交换槽编号带有此标志 */
+#define ZSWAP_BIT ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1))
+
+static struct block* swap_block; /* 交换设备，可能为NULL */
+static struct bitmap* used_map;  /* 已经被占用的交换槽 */
+static struct lock swap_lock;    /* 保护used_map */
+
+/* 统计数据 */
+static long long swap_outs; /* 写出的页面数 */
+static long long swap_ins;  /* 读回的页面数 */
+static long long zswap_ins; /* 从压缩内存池取回的页面数 */
+
+/**
+ * @brief 初始化交换区，必须在块设备的角色确定之后调用
+ */
+void swap_init(void) {
+  size_t slot_cnt = 0;
+
+  lock_init(&swap_lock);
+  swap_block = block_get_role(BLOCK_SWAP);
+  if (swap_block != NULL)
+    slot_cnt = block_size(swap_block) / SECTORS_PER_SLOT;
+  used_map = bitmap_create(slot_cnt);
+  if (used_map == NULL)
+    PANIC("swap: bitmap creation failed");
+}
+
+/**
+ * @brief 分配一个交换槽，将KPAGE处的一页写入其中
+ *
+ * @param kpage 页面的内核虚拟地址（可以是kmap()得到的临时映射）
+ * @return size_t 交换槽编号，内存池和交换区都已满（或者不存在）时返回SWAP_ERROR
+ */
+size_t swap_out(const void* kpage) {
+  size_t slot, i;
+
+  slot = zswap_store(kpage);
+  if (slot != SWAP_ERROR)
+    return slot | ZSWAP_BIT;
+
+  lock_acquire(&swap_lock);
+  slot = bitmap_scan_and_flip(used_map, 0, 1, false);
+  lock_release(&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_write(swap_block, slot * SECTORS_PER_SLOT + i, (const uint8_t*)kpage + i * BLOCK_SECTOR_SIZE);
+  swap_outs++;
+  return slot;
+}
+
+/**
+ * @brief 将交换槽SLOT中的页面读入KPAGE
+ *
+ * @details 交换槽并不会被释放，调用者确认页面已经就绪之后再调用swap_free()
+ */
+void swap_in(size_t slot, void* kpage) {
+  size_t i;
+
+  if (slot & ZSWAP_BIT) {
+    zswap_load(slot & ~ZSWAP_BIT, kpage);
+    zswap_ins++;
+    return;
+  }
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_read(swap_block, slot * SECTORS_PER_SLOT + i, (uint8_t*)kpage + i * BLOCK_SECTOR_SIZE);
+  swap_ins++;
+}
+
+/**
+ * @brief 释放交换槽SLOT，其中的内容被丢弃
+ */
+void swap_free(size_t slot) {
+  if (slot & ZSWAP_BIT) {
+    zswap_free(slot & ~ZSWAP_BIT);
+    return;
+  }
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_map, slot));
+  bitmap_reset(used_map, slot);
+  lock_release(&swap_lock);
+}
+
+/* 打印交换区的统计数据 */
+void swap_print_stats(void) {
+  if (used_map == NULL)
+    return;
+  printf("Swap: %zu of %zu slots in use, %lld pages out, %lld in\n",
+         bitmap_count(used_map, 0, bitmap_size(used_map), true), bitmap_size(used_map), swap_outs,
+         swap_ins);
+  zswap_print_stats();
+  if (zswap_ins + swap_ins > 0)
+    printf("Swap: %lld%% of swap-ins served from compressed memory\n",
+           zswap_ins * 100 / (zswap_ins + swap_ins));
+}
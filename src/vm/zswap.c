@@ -0,0 +1,353 @@
+/**
+ * @file zswap.c
+ * @brief 压缩内存交换缓存
+ *
+ * @details 交换设备是PIO方式访问的IDE磁盘，每次只能传输一个扇区，
+ * 换出或换入一页需要毫秒级的时间。被换出的匿名页面因此先尝试压缩后
+ * 存放在内核内存池中，换入时解压即可，只需要微秒级的时间；只有内存池
+ * 已满或者页面压缩效果不好时，才写入交换设备
+ *
+ * 压缩使用LZ77族的简单字节流格式（与LZ4类似），不需要熵编码，
+ * 压缩和解压都只是线性扫描。压缩后的页面加上两个字节的长度头部，
+ * 以CHUNK_SIZE字节为单位存放在内存池某一页中的连续块中，
+ * 句柄由内存池页号和起始块号组成，因此不需要额外的索引结构
+ *
+ * 内存池的页面按需从palloc分配，完全空闲时立即归还，最多page_limit页
+ */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* 内存池每页划分为CHUNK_CNT块，每块CHUNK_SIZE字节 */
+#define CHUNK_SIZE 64
+#define CHUNK_CNT (PGSIZE / CHUNK_SIZE)
+
+/* 压缩后超过此长度的页面不值得存放，交给交换设备 */
+#define MAX_STORE (PGSIZE * 3 / 4)
+
+/* 压缩格式参数 */
+#define LZ_MIN_MATCH 4  /* 最短匹配长度 */
+#define LZ_HASH_BITS 10 /* 匹配查找哈希表的位数 */
+
+/* 内存池中的一页 */
+struct zpage {
+  uint8_t* kpage;      /* 内核虚拟地址，未分配时为NULL */
+  uint64_t used;       /* 已经被占用的块，第i位对应第i块 */
+  unsigned free_cnt;   /* 空闲块数 */
+};
+
+static struct zpage* pool; /* 内存池，共page_limit项 */
+static size_t page_limit;  /* 内存池的最大页数 */
+static size_t page_cnt;    /* 内存池当前已分配的页数 */
+static struct lock zswap_lock; /* 保护内存池以及下面的压缩缓冲区 */
+
+static uint8_t zbuf[MAX_STORE];          /* 压缩输出缓冲区 */
+static uint16_t lz_table[1 << LZ_HASH_BITS]; /* 每个4字节序列最近一次出现的位置 */
+
+/* 统计数据 */
+static long long stores;      /* 存入的页面数 */
+static long long loads;       /* 取出的页面数 */
+static long long rejects;     /* 因压缩效果不好而拒绝的页面数 */
+static long long full;        /* 因内存池已满而拒绝的页面数 */
+static long long bytes_in;    /* 存入页面的原始字节数 */
+static long long bytes_out;   /* 存入页面压缩后的字节数 */
+
+static size_t lz_compress(const uint8_t* src, uint8_t* dst, size_t cap);
+static void lz_decompress(const uint8_t* src, size_t len, uint8_t* dst);
+static bool chunk_alloc(size_t chunk_cnt, size_t* page_idx, size_t* first);
+
+/**
+ * @brief 初始化压缩内存池
+ *
+ * @param limit 内存池的最大页数，为0时禁用压缩缓存
+ */
+void zswap_init(size_t limit) {
+  lock_init(&zswap_lock);
+  page_limit = limit;
+  page_cnt = 0;
+  if (limit == 0)
+    return;
+  pool = calloc(limit, sizeof *pool);
+  if (pool == NULL)
+    PANIC("zswap: pool allocation failed");
+}
+
+/**
+ * @brief 压缩KPAGE处的一页并存入内存池
+ *
+ * @return size_t 句柄，内存池已满、页面压缩效果不好或者禁用了压缩缓存时返回SWAP_ERROR
+ */
+size_t zswap_store(const void* kpage) {
+  size_t len, chunk_cnt, page_idx, first;
+  uint8_t* dst;
+
+  if (page_limit == 0)
+    return SWAP_ERROR;
+
+  lock_acquire(&zswap_lock);
+  len = lz_compress(kpage, zbuf, sizeof zbuf);
+  if (len == 0) {
+    rejects++;
+    lock_release(&zswap_lock);
+    return SWAP_ERROR;
+  }
+
+  chunk_cnt = DIV_ROUND_UP(len + sizeof(uint16_t), CHUNK_SIZE);
+  if (!chunk_alloc(chunk_cnt, &page_idx, &first)) {
+    full++;
+    lock_release(&zswap_lock);
+    return SWAP_ERROR;
+  }
+
+  dst = pool[page_idx].kpage + first * CHUNK_SIZE;
+  *(uint16_t*)dst = len;
+  memcpy(dst + sizeof(uint16_t), zbuf, len);
+  stores++;
+  bytes_in += PGSIZE;
+  bytes_out += len;
+  lock_release(&zswap_lock);
+  return page_idx * CHUNK_CNT + first;
+}
+
+/**
+ * @brief 将句柄HANDLE对应的页面解压到KPAGE
+ *
+ * @details 页面仍然保留在内存池中，调用者确认页面已经就绪之后再调用zswap_free()
+ */
+void zswap_load(size_t handle, void* kpage) {
+  const uint8_t* src;
+
+  lock_acquire(&zswap_lock);
+  src = pool[handle / CHUNK_CNT].kpage + handle % CHUNK_CNT * CHUNK_SIZE;
+  lz_decompress(src + sizeof(uint16_t), *(const uint16_t*)src, kpage);
+  loads++;
+  lock_release(&zswap_lock);
+}
+
+/**
+ * @brief 从内存池中删除句柄HANDLE对应的页面，所在的内存池页完全空闲时归还给palloc
+ */
+void zswap_free(size_t handle) {
+  struct zpage* zp = &pool[handle / CHUNK_CNT];
+  size_t first = handle % CHUNK_CNT;
+  size_t chunk_cnt, i;
+
+  lock_acquire(&zswap_lock);
+  ASSERT(zp->kpage != NULL);
+  chunk_cnt = DIV_ROUND_UP(*(uint16_t*)(zp->kpage + first * CHUNK_SIZE) + sizeof(uint16_t),
+                           CHUNK_SIZE);
+  for (i = first; i < first + chunk_cnt; i++) {
+    ASSERT(zp->used & ((uint64_t)1 << i));
+    zp->used &= ~((uint64_t)1 << i);
+  }
+  zp->free_cnt += chunk_cnt;
+  if (zp->free_cnt == CHUNK_CNT) {
+    palloc_free_page(zp->kpage);
+    zp->kpage = NULL;
+    page_cnt--;
+  }
+  lock_release(&zswap_lock);
+}
+
+/* 打印压缩缓存的统计数据 */
+void zswap_print_stats(void) {
+  if (page_limit == 0)
+    return;
+  printf("Zswap: %lld pages stored, %lld loaded, %lld incompressible, %lld rejected when full\n",
+         stores, loads, rejects, full);
+  printf("Zswap: compression ratio %lld%%, %zu of %zu pool pages in use\n",
+         bytes_out > 0 ? bytes_in * 100 / bytes_out : 0, page_cnt, page_limit);
+}
+
+/**
+ * @brief 在内存池中找出CHUNK_CNT个连续的空闲块，必要时分配新的内存池页
+ *
+ * @details 调用者必须持有zswap_lock
+ */
+static bool chunk_alloc(size_t chunk_cnt, size_t* page_idx, size_t* first) {
+  uint64_t mask = chunk_cnt == CHUNK_CNT ? ~(uint64_t)0 : ((uint64_t)1 << chunk_cnt) - 1;
+  struct zpage* empty = NULL;
+  size_t i, j;
+
+  ASSERT(chunk_cnt > 0 && chunk_cnt <= CHUNK_CNT);
+  for (i = 0; i < page_limit; i++) {
+    struct zpage* zp = &pool[i];
+
+    if (zp->kpage == NULL) {
+      if (empty == NULL)
+        empty = zp;
+      continue;
+    }
+    if (zp->free_cnt < chunk_cnt)
+      continue;
+    for (j = 0; j + chunk_cnt <= CHUNK_CNT; j++)
+      if ((zp->used & (mask << j)) == 0)
+        goto found;
+  }
+
+  /* 换出发生在物理内存不足时，这里的分配失败了也没有关系
+   * 本函数在换出路径上持有zswap_lock，不能让palloc再调用回收函数换出页面，
+   * 否则会递归进入zswap_store() */
+  if (empty == NULL || (empty->kpage = palloc_get_page(PAL_NORECLAIM)) == NULL)
+    return false;
+  page_cnt++;
+  empty->used = 0;
+  empty->free_cnt = CHUNK_CNT;
+  i = empty - pool;
+  j = 0;
+
+found:
+  pool[i].used |= mask << j;
+  pool[i].free_cnt -= chunk_cnt;
+  *page_idx = i;
+  *first = j;
+  return true;
+}
+
+/* 读取P处未对齐的4个字节 */
+static inline uint32_t read32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof v);
+  return v;
+}
+
+/* 4字节序列V在lz_table中的位置 */
+static inline unsigned lz_hash(uint32_t v) { return (v * 2654435761u) >> (32 - LZ_HASH_BITS); }
+
+/* 写出长度扩展字节：若干个255，以一个小于255的字节结尾 */
+static uint8_t* put_ext(uint8_t* op, size_t n) {
+  for (; n >= 255; n -= 255)
+    *op++ = 255;
+  *op++ = n;
+  return op;
+}
+
+/* 读取长度扩展字节 */
+static size_t get_ext(const uint8_t** ip) {
+  size_t n = 0;
+  uint8_t b;
+
+  do {
+    b = *(*ip)++;
+    n += b;
+  } while (b == 255);
+  return n;
+}
+
+/**
+ * @brief 写出一个序列：LIT_LEN字节的字面量LIT，之后是距离为OFFSET、长度为MATCH_LEN的匹配
+ *
+ * @details 序列的格式为：
+ * 1字节标记，高4位为字面量长度，低4位为匹配长度减LZ_MIN_MATCH，为15时后跟扩展字节
+ * 字面量长度扩展字节、字面量、2字节小端匹配距离、匹配长度扩展字节
+ * 最后一个序列只有字面量部分（MATCH_LEN为0）
+ *
+ * @return uint8_t* 输出缓冲区的新位置，剩余空间不足时返回NULL
+ */
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* oend, const uint8_t* lit,
+                             size_t lit_len, size_t offset, size_t match_len) {
+  size_t need = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+  uint8_t* token;
+
+  if (need > (size_t)(oend - op))
+    return NULL;
+
+  token = op++;
+  *token = (lit_len >= 15 ? 15 : lit_len) << 4;
+  if (lit_len >= 15)
+    op = put_ext(op, lit_len - 15);
+  memcpy(op, lit, lit_len);
+  op += lit_len;
+
+  if (match_len > 0) {
+    size_t ml = match_len - LZ_MIN_MATCH;
+
+    *op++ = offset & 0xff;
+    *op++ = offset >> 8;
+    *token |= ml >= 15 ? 15 : ml;
+    if (ml >= 15)
+      op = put_ext(op, ml - 15);
+  }
+  return op;
+}
+
+/**
+ * @brief 压缩SRC处的一页，写入DST
+ *
+ * @param cap DST的大小
+ * @return size_t 压缩后的长度，超过CAP时返回0
+ */
+static size_t lz_compress(const uint8_t* src, uint8_t* dst, size_t cap) {
+  const uint8_t* end = src + PGSIZE;
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  const uint8_t* oend = dst + cap;
+  uint8_t* op = dst;
+
+  memset(lz_table, 0, sizeof lz_table);
+  while (ip + LZ_MIN_MATCH <= end) {
+    uint32_t seq = read32(ip);
+    unsigned h = lz_hash(seq);
+    const uint8_t* cand = src + lz_table[h];
+    const uint8_t* m;
+
+    lz_table[h] = ip - src;
+    if (cand >= ip || read32(cand) != seq) {
+      ip++;
+      continue;
+    }
+
+    for (m = ip + LZ_MIN_MATCH; m < end && *m == cand[m - ip]; m++)
+      continue;
+    op = put_sequence(op, oend, anchor, ip - anchor, ip - cand, m - ip);
+    if (op == NULL)
+      return 0;
+    ip = anchor = m;
+  }
+
+  op = put_sequence(op, oend, anchor, end - anchor, 0, 0);
+  return op != NULL ? (size_t)(op - dst) : 0;
+}
+
+/* 将SRC处长度为LEN的压缩数据解压到DST处的一页 */
+static void lz_decompress(const uint8_t* src, size_t len, uint8_t* dst) {
+  const uint8_t* ip = src;
+  const uint8_t* iend = src + len;
+  uint8_t* op = dst;
+
+  for (;;) {
+    uint8_t token = *ip++;
+    size_t lit_len = token >> 4;
+    size_t match_len, offset;
+    const uint8_t* m;
+
+    if (lit_len == 15)
+      lit_len += get_ext(&ip);
+    memcpy(op, ip, lit_len);
+    op += lit_len;
+    ip += lit_len;
+    if (ip >= iend)
+      break;
+
+    offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    match_len = token & 15;
+    if (match_len == 15)
+      match_len += get_ext(&ip);
+    match_len += LZ_MIN_MATCH;
+
+    /* 匹配可能与输出重叠，必须逐字节复制 */
+    for (m = op - offset; match_len-- > 0;)
+      *op++ = *m++;
+  }
+  ASSERT(op == dst + PGSIZE);
+}
@@ -0,0 +1,15 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stddef.h>
+
+/* 未指定-zswap选项时压缩内存池的最大页数 */
+#define ZSWAP_DEFAULT_PAGES 256
+
+void zswap_init(size_t page_limit);
+size_t zswap_store(const void* kpage);
+void zswap_load(size_t handle, void* kpage);
+void zswap_free(size_t handle);
+void zswap_print_stats(void);
+
+#endif /* vm/zswap.h */